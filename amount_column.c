@@ -0,0 +1,752 @@
+/*
+ *
+ * Name:       amount_column.c
+ *
+ * Purpose:    Contains functions for adding up the amounts of the whole
+ *             budget many at a time.
+ *
+ *             The store keeps each transaction's fields together, so
+ *             adding up the amounts reads the dates, descriptions, and
+ *             IDs along with them. The column keeps a second copy of
+ *             just the amounts, side by side in order of ID, with one
+ *             bit for each ID that is in use and one for each credit.
+ *             On x86 processors 2 (SSE4.2) or 4 (AVX2) amounts are
+ *             counted, added, and compared at once, with the bits as
+ *             masks.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The vector versions need GCC or Clang, which can build them for
+ * SSE4.2 and AVX2 no matter what the rest of the program is built for.
+ * A CENTS is always 64 bits, so it fills a 64-bit lane.
+ *
+ */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HAVE_X86_VECTORS
+#include <immintrin.h>
+#endif
+
+#include <limits.h>
+#include <time.h>
+#include "amount_column.h"
+#include "balance.h"
+
+/* One word of bits covers this many IDs */
+#define COLUMN_WORD_BITS 32
+
+/* The column starts with room for this many IDs, and doubles */
+#define MIN_COLUMN_SLOTS 1024
+
+/*
+ * IDs typed into the file by hand could be far apart, so the column is
+ * only kept while it has no more than this many slots per transaction
+ */
+#define MAX_COLUMN_SPREAD 4
+
+/* How many times the benchmark adds up the budget each way */
+#define BENCHMARK_PASSES 20
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+BOOL make_room_for_id(long id, long number_of_transactions);
+void start_summary(struct amount_summary *summary);
+void add_to_summary(struct amount_summary *summary, CENTS amount);
+void finish_summary(struct amount_summary *summary);
+void summarize_store(const struct transaction_store *store,
+   struct amount_summary *credits, struct amount_summary *debits);
+int count_bits(unsigned int word);
+void summarize_column_scalar(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits);
+
+#ifdef HAVE_X86_VECTORS
+void summarize_column_sse42(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits)
+   __attribute__((target("sse4.2")));
+void summarize_column_avx2(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits)
+   __attribute__((target("avx2")));
+#endif
+
+static void (*summarize_column)(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits) =
+   summarize_column_scalar;
+
+/*
+ * amounts[id] is the amount of the transaction with that ID. Bit
+ * id % 32 of live_bits[id / 32] is set if the ID is in use, and the
+ * same bit of credit_bits if it is a credit. The slots of IDs not in
+ * use hold 0.
+ */
+static CENTS *amounts = NULL;
+static unsigned int *live_bits = NULL;
+static unsigned int *credit_bits = NULL;
+static long number_of_slots = 0;
+static long highest_id = 0;
+static long number_in_column = 0;
+static BOOL column_built = FALSE;
+
+/* Set when the column was dropped because it would have been too big */
+static BOOL ids_too_far_apart = FALSE;
+
+#ifdef HAVE_X86_VECTORS
+/* Row n has every bit of n spread out into a mask of one lane each */
+static const CENTS lane_masks[16][4] =
+{
+   {  0,  0,  0,  0 }, { -1,  0,  0,  0 }, {  0, -1,  0,  0 },
+   { -1, -1,  0,  0 }, {  0,  0, -1,  0 }, { -1,  0, -1,  0 },
+   {  0, -1, -1,  0 }, { -1, -1, -1,  0 }, {  0,  0,  0, -1 },
+   { -1,  0,  0, -1 }, {  0, -1,  0, -1 }, { -1, -1,  0, -1 },
+   {  0,  0, -1, -1 }, { -1,  0, -1, -1 }, {  0, -1, -1, -1 },
+   { -1, -1, -1, -1 }
+};
+#endif
+
+
+
+void choose_amount_kernels(void)
+{
+#ifdef HAVE_X86_VECTORS
+   __builtin_cpu_init();
+
+   if(__builtin_cpu_supports("avx2"))
+   {
+      summarize_column = summarize_column_avx2;
+   }
+   else if(__builtin_cpu_supports("sse4.2"))
+   {
+      summarize_column = summarize_column_sse42;
+   }
+#endif
+}
+
+
+
+int build_amount_column(const struct transaction_store *store)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+   long largest_id = 0;
+
+   if(column_built)
+   {
+      return 0;
+   }
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      if(p->id > largest_id)
+      {
+         largest_id = p->id;
+      }
+   }
+
+   ids_too_far_apart = FALSE;
+
+   if(!make_room_for_id(largest_id, store->number_of_transactions))
+   {
+      free_amount_column();
+      return FILE_OPS_ERROR;
+   }
+
+   column_built = TRUE;
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      add_to_amount_column(p);
+   }
+
+   return 0;
+}
+
+
+
+void add_to_amount_column(const struct transaction *node)
+{
+   unsigned int bit = 1U << (node->id % COLUMN_WORD_BITS);
+   long word = node->id / COLUMN_WORD_BITS;
+
+   if(!column_built)
+   {
+      return;
+   }
+
+   if(!make_room_for_id(node->id, number_in_column + 1))
+   {
+      free_amount_column();
+      return;
+   }
+
+   amounts[node->id] = node->amount;
+   live_bits[word] |= bit;
+
+   if(node->type == CREDIT_TYPE)
+   {
+      credit_bits[word] |= bit;
+   }
+   else
+   {
+      credit_bits[word] &= ~bit;
+   }
+
+   if(node->id > highest_id)
+   {
+      highest_id = node->id;
+   }
+
+   number_in_column++;
+}
+
+
+
+void remove_from_amount_column(const struct transaction *node)
+{
+   unsigned int bit = 1U << (node->id % COLUMN_WORD_BITS);
+   long word = node->id / COLUMN_WORD_BITS;
+
+   if(!column_built)
+   {
+      return;
+   }
+
+   amounts[node->id] = 0;
+   live_bits[word] &= ~bit;
+   credit_bits[word] &= ~bit;
+
+   number_in_column--;
+}
+
+
+
+int summarize_amounts(const struct transaction_store *store,
+   struct amount_summary *credits, struct amount_summary *debits)
+{
+   if(build_amount_column(store) == FILE_OPS_ERROR)
+   {
+      if(!ids_too_far_apart)
+      {
+         printf("\nMemory allocation error.\n");
+         return FILE_OPS_ERROR;
+      }
+
+      summarize_store(store, credits, debits);
+      return 0;
+   }
+
+   summarize_column(highest_id / COLUMN_WORD_BITS + 1, credits, debits);
+   finish_summary(credits);
+   finish_summary(debits);
+
+   return 0;
+}
+
+
+
+int print_amount_benchmark(const struct transaction_store *store)
+{
+   struct amount_summary summaries[3][2];
+   void (*chosen)(long number_of_words, struct amount_summary *credits,
+      struct amount_summary *debits) = summarize_column;
+   double seconds[3];
+   clock_t start;
+   int way;
+   int pass;
+
+   start = clock();
+   if(summarize_amounts(store, &summaries[0][0], &summaries[0][1])
+      == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   if(!column_built)
+   {
+      printf("\nThe IDs in the budget are too far apart for a column.\n");
+      return 0;
+   }
+
+   printf("\nAdding up %ld transactions, %d times each way:\n\n",
+      store->number_of_transactions, BENCHMARK_PASSES);
+   printf("   Building the column: %.3f ms\n",
+      (double) (clock() - start) * 1000 / CLOCKS_PER_SEC);
+
+   /* The column with this processor's vectors, then with plain C */
+   for(way = 0; way < 2; way++)
+   {
+      summarize_column = way == 0 ? chosen : summarize_column_scalar;
+
+      start = clock();
+      for(pass = 0; pass < BENCHMARK_PASSES; pass++)
+      {
+         (void) summarize_amounts(store, &summaries[way][0],
+            &summaries[way][1]);
+      }
+      seconds[way] = (double) (clock() - start) / CLOCKS_PER_SEC;
+   }
+
+   summarize_column = chosen;
+
+   /* And the store, the way it was done before the column */
+   start = clock();
+   for(pass = 0; pass < BENCHMARK_PASSES; pass++)
+   {
+      summarize_store(store, &summaries[2][0], &summaries[2][1]);
+   }
+   seconds[2] = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   for(way = 0; way < 2; way++)
+   {
+      if(memcmp(summaries[way], summaries[2], sizeof(summaries[2])) != 0)
+      {
+         printf("\nThe amount column doesn't match the budget.\n");
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   printf("   The column (%s): %.3f ms per pass\n",
+#ifdef HAVE_X86_VECTORS
+      chosen == summarize_column_avx2 ? "AVX2"
+         : chosen == summarize_column_sse42 ? "SSE4.2" : "plain C",
+#else
+      "plain C",
+#endif
+      seconds[0] * 1000 / BENCHMARK_PASSES);
+   printf("   The column (plain C): %.3f ms per pass\n",
+      seconds[1] * 1000 / BENCHMARK_PASSES);
+   printf("   Reading the store: %.3f ms per pass\n",
+      seconds[2] * 1000 / BENCHMARK_PASSES);
+
+   return 0;
+}
+
+
+
+void free_amount_column(void)
+{
+   free(amounts);
+   free(live_bits);
+   free(credit_bits);
+   amounts = NULL;
+   live_bits = NULL;
+   credit_bits = NULL;
+   number_of_slots = 0;
+   highest_id = 0;
+   number_in_column = 0;
+   column_built = FALSE;
+}
+
+
+
+/*
+ *
+ * Doubles the column until it has a slot for id. Returns FALSE if we
+ * run out of memory, or if the column would have too many slots for
+ * number_of_transactions.
+ *
+ */
+BOOL make_room_for_id(long id, long number_of_transactions)
+{
+   CENTS *new_amounts;
+   unsigned int *new_live_bits;
+   unsigned int *new_credit_bits;
+   long new_number_of_slots = number_of_slots;
+
+   if(id < number_of_slots)
+   {
+      return TRUE;
+   }
+
+   if(new_number_of_slots == 0)
+   {
+      new_number_of_slots = MIN_COLUMN_SLOTS;
+   }
+
+   while(new_number_of_slots <= id)
+   {
+      new_number_of_slots *= 2;
+   }
+
+   if(new_number_of_slots > MIN_COLUMN_SLOTS
+      && new_number_of_slots / MAX_COLUMN_SPREAD > number_of_transactions)
+   {
+      ids_too_far_apart = TRUE;
+      return FALSE;
+   }
+
+   /*
+    * Each array is kept as soon as it has grown, since realloc() may
+    * have freed the old one. An array that grew before a later one
+    * failed just has room that isn't used yet: number_of_slots only
+    * changes once all three have grown.
+    */
+   new_amounts = realloc(amounts, sizeof(CENTS) * (size_t) new_number_of_slots);
+   if(new_amounts == NULL)
+   {
+      return FALSE;
+   }
+   amounts = new_amounts;
+
+   new_live_bits = realloc(live_bits, sizeof(unsigned int)
+      * (size_t) (new_number_of_slots / COLUMN_WORD_BITS));
+   if(new_live_bits == NULL)
+   {
+      return FALSE;
+   }
+   live_bits = new_live_bits;
+
+   new_credit_bits = realloc(credit_bits, sizeof(unsigned int)
+      * (size_t) (new_number_of_slots / COLUMN_WORD_BITS));
+   if(new_credit_bits == NULL)
+   {
+      return FALSE;
+   }
+   credit_bits = new_credit_bits;
+
+   memset(amounts + number_of_slots, 0,
+      sizeof(CENTS) * (size_t) (new_number_of_slots - number_of_slots));
+   memset(live_bits + number_of_slots / COLUMN_WORD_BITS, 0,
+      sizeof(unsigned int) * (size_t) ((new_number_of_slots
+         - number_of_slots) / COLUMN_WORD_BITS));
+   memset(credit_bits + number_of_slots / COLUMN_WORD_BITS, 0,
+      sizeof(unsigned int) * (size_t) ((new_number_of_slots
+         - number_of_slots) / COLUMN_WORD_BITS));
+
+   number_of_slots = new_number_of_slots;
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * A summary starts with nothing in it, and a smallest and largest
+ * that any amount will replace
+ *
+ */
+void start_summary(struct amount_summary *summary)
+{
+   summary->count = 0;
+   summary->total = 0;
+   summary->smallest = CENTS_MAX;
+   summary->largest = CENTS_MIN;
+}
+
+
+
+void add_to_summary(struct amount_summary *summary, CENTS amount)
+{
+   summary->count++;
+   summary->total += amount;
+
+   if(amount < summary->smallest)
+   {
+      summary->smallest = amount;
+   }
+
+   if(amount > summary->largest)
+   {
+      summary->largest = amount;
+   }
+}
+
+
+
+void finish_summary(struct amount_summary *summary)
+{
+   if(summary->count == 0)
+   {
+      summary->smallest = 0;
+      summary->largest = 0;
+   }
+}
+
+
+
+void summarize_store(const struct transaction_store *store,
+   struct amount_summary *credits, struct amount_summary *debits)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+
+   start_summary(credits);
+   start_summary(debits);
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      add_to_summary(p->type == CREDIT_TYPE ? credits : debits, p->amount);
+   }
+
+   finish_summary(credits);
+   finish_summary(debits);
+}
+
+
+
+int count_bits(unsigned int word)
+{
+#ifdef __GNUC__
+   return __builtin_popcount(word);
+#else
+   int bits = 0;
+
+   while(word != 0)
+   {
+      word &= word - 1;
+      bits++;
+   }
+
+   return bits;
+#endif
+}
+
+
+
+/*
+ *
+ * Looks at one ID at a time. Words with no IDs in use are skipped.
+ *
+ */
+void summarize_column_scalar(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits)
+{
+   unsigned int live;
+   long word;
+   int bit;
+
+   start_summary(credits);
+   start_summary(debits);
+
+   for(word = 0; word < number_of_words; word++)
+   {
+      live = live_bits[word];
+
+      for(bit = 0; live != 0; bit++, live >>= 1)
+      {
+         if(live & 1)
+         {
+            add_to_summary(credit_bits[word] & (1U << bit) ? credits : debits,
+               amounts[word * COLUMN_WORD_BITS + bit]);
+         }
+      }
+   }
+}
+
+
+
+#ifdef HAVE_X86_VECTORS
+/*
+ *
+ * Two amounts at a time. Each lane keeps its own totals, smallest,
+ * and largest, which are put together at the end. The counts are
+ * just the bits of each mask.
+ *
+ */
+void summarize_column_sse42(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits)
+{
+   const __m128i none_smaller = _mm_set1_epi64x(CENTS_MAX);
+   const __m128i none_larger = _mm_set1_epi64x(CENTS_MIN);
+   __m128i totals[2];
+   __m128i smallest[2];
+   __m128i largest[2];
+   __m128i masks[2];
+   __m128i values;
+   __m128i candidates;
+   CENTS lanes[2][3][2];
+   unsigned int words[2];
+   long word;
+   int shift;
+   int kind;
+   int lane;
+
+   for(kind = 0; kind < 2; kind++)
+   {
+      totals[kind] = _mm_setzero_si128();
+      smallest[kind] = none_smaller;
+      largest[kind] = none_larger;
+   }
+
+   start_summary(credits);
+   start_summary(debits);
+
+   for(word = 0; word < number_of_words; word++)
+   {
+      if(live_bits[word] == 0)
+      {
+         continue;
+      }
+
+      words[0] = live_bits[word] & credit_bits[word];
+      words[1] = live_bits[word] & ~credit_bits[word];
+      credits->count += count_bits(words[0]);
+      debits->count += count_bits(words[1]);
+
+      for(shift = 0; shift < COLUMN_WORD_BITS; shift += 2)
+      {
+         values = _mm_loadu_si128((const __m128i *)
+            (amounts + word * COLUMN_WORD_BITS + shift));
+
+         for(kind = 0; kind < 2; kind++)
+         {
+            masks[kind] = _mm_loadu_si128((const __m128i *)
+               lane_masks[(words[kind] >> shift) & 3]);
+
+            totals[kind] = _mm_add_epi64(totals[kind],
+               _mm_and_si128(values, masks[kind]));
+
+            candidates = _mm_blendv_epi8(none_smaller, values, masks[kind]);
+            smallest[kind] = _mm_blendv_epi8(smallest[kind], candidates,
+               _mm_cmpgt_epi64(smallest[kind], candidates));
+
+            candidates = _mm_blendv_epi8(none_larger, values, masks[kind]);
+            largest[kind] = _mm_blendv_epi8(largest[kind], candidates,
+               _mm_cmpgt_epi64(candidates, largest[kind]));
+         }
+      }
+   }
+
+   for(kind = 0; kind < 2; kind++)
+   {
+      _mm_storeu_si128((__m128i *) lanes[kind][0], totals[kind]);
+      _mm_storeu_si128((__m128i *) lanes[kind][1], smallest[kind]);
+      _mm_storeu_si128((__m128i *) lanes[kind][2], largest[kind]);
+   }
+
+   for(lane = 0; lane < 2; lane++)
+   {
+      credits->total += lanes[0][0][lane];
+      credits->smallest = lanes[0][1][lane] < credits->smallest
+         ? lanes[0][1][lane] : credits->smallest;
+      credits->largest = lanes[0][2][lane] > credits->largest
+         ? lanes[0][2][lane] : credits->largest;
+
+      debits->total += lanes[1][0][lane];
+      debits->smallest = lanes[1][1][lane] < debits->smallest
+         ? lanes[1][1][lane] : debits->smallest;
+      debits->largest = lanes[1][2][lane] > debits->largest
+         ? lanes[1][2][lane] : debits->largest;
+   }
+}
+
+
+
+/*
+ *
+ * The same, four amounts at a time
+ *
+ */
+void summarize_column_avx2(long number_of_words,
+   struct amount_summary *credits, struct amount_summary *debits)
+{
+   const __m256i none_smaller = _mm256_set1_epi64x(CENTS_MAX);
+   const __m256i none_larger = _mm256_set1_epi64x(CENTS_MIN);
+   __m256i totals[2];
+   __m256i smallest[2];
+   __m256i largest[2];
+   __m256i masks[2];
+   __m256i values;
+   __m256i candidates;
+   CENTS lanes[2][3][4];
+   unsigned int words[2];
+   long word;
+   int shift;
+   int kind;
+   int lane;
+
+   for(kind = 0; kind < 2; kind++)
+   {
+      totals[kind] = _mm256_setzero_si256();
+      smallest[kind] = none_smaller;
+      largest[kind] = none_larger;
+   }
+
+   start_summary(credits);
+   start_summary(debits);
+
+   for(word = 0; word < number_of_words; word++)
+   {
+      if(live_bits[word] == 0)
+      {
+         continue;
+      }
+
+      words[0] = live_bits[word] & credit_bits[word];
+      words[1] = live_bits[word] & ~credit_bits[word];
+      credits->count += count_bits(words[0]);
+      debits->count += count_bits(words[1]);
+
+      for(shift = 0; shift < COLUMN_WORD_BITS; shift += 4)
+      {
+         values = _mm256_loadu_si256((const __m256i *)
+            (amounts + word * COLUMN_WORD_BITS + shift));
+
+         for(kind = 0; kind < 2; kind++)
+         {
+            masks[kind] = _mm256_loadu_si256((const __m256i *)
+               lane_masks[(words[kind] >> shift) & 15]);
+
+            totals[kind] = _mm256_add_epi64(totals[kind],
+               _mm256_and_si256(values, masks[kind]));
+
+            candidates = _mm256_blendv_epi8(none_smaller, values,
+               masks[kind]);
+            smallest[kind] = _mm256_blendv_epi8(smallest[kind], candidates,
+               _mm256_cmpgt_epi64(smallest[kind], candidates));
+
+            candidates = _mm256_blendv_epi8(none_larger, values,
+               masks[kind]);
+            largest[kind] = _mm256_blendv_epi8(largest[kind], candidates,
+               _mm256_cmpgt_epi64(candidates, largest[kind]));
+         }
+      }
+   }
+
+   for(kind = 0; kind < 2; kind++)
+   {
+      _mm256_storeu_si256((__m256i *) lanes[kind][0], totals[kind]);
+      _mm256_storeu_si256((__m256i *) lanes[kind][1], smallest[kind]);
+      _mm256_storeu_si256((__m256i *) lanes[kind][2], largest[kind]);
+   }
+
+   for(lane = 0; lane < 4; lane++)
+   {
+      credits->total += lanes[0][0][lane];
+      credits->smallest = lanes[0][1][lane] < credits->smallest
+         ? lanes[0][1][lane] : credits->smallest;
+      credits->largest = lanes[0][2][lane] > credits->largest
+         ? lanes[0][2][lane] : credits->largest;
+
+      debits->total += lanes[1][0][lane];
+      debits->smallest = lanes[1][1][lane] < debits->smallest
+         ? lanes[1][1][lane] : debits->smallest;
+      debits->largest = lanes[1][2][lane] > debits->largest
+         ? lanes[1][2][lane] : debits->largest;
+   }
+}
+#endif
+
+
+
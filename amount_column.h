@@ -0,0 +1,83 @@
+/*
+ *
+ * Name:       amount_column.h
+ *
+ * Purpose:    Contains function prototypes for adding up the amounts
+ *             of the whole budget many at a time.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef AMOUNT_COLUMN_H
+#define AMOUNT_COLUMN_H
+#include "transaction_store.h"
+#include "conversions.h"
+#include "read_input.h"
+
+/* What summarize_amounts() finds for the credits, or for the debits */
+struct amount_summary
+{
+   long count;
+   CENTS total;
+
+   /* 0 when count is 0 */
+   CENTS smallest;
+   CENTS largest;
+};
+
+/*
+ * Picks the fastest way to add up the column that this processor
+ * supports. Until this is called, plain C is used.
+ */
+void choose_amount_kernels(void);
+
+/*
+ * Builds the column from every transaction in the store, unless it is
+ * already built. Like the date index, it is only built the first time
+ * it is needed. Returns FILE_OPS_ERROR if we run out of memory.
+ */
+int build_amount_column(const struct transaction_store *store);
+
+/*
+ * Keep a built column up to date as transactions are added and
+ * removed. They do nothing before the column is built. If we run out
+ * of memory, the column is dropped, to be built again the next time
+ * it is needed.
+ */
+void add_to_amount_column(const struct transaction *node);
+void remove_from_amount_column(const struct transaction *node);
+
+/*
+ * Counts and adds up the credits and the debits of the whole budget,
+ * and finds the smallest and largest of each. Uses the column, which
+ * is built first if it has to be, or reads the store if its IDs are
+ * too far apart for one. Returns FILE_OPS_ERROR if we run out of
+ * memory.
+ */
+int summarize_amounts(const struct transaction_store *store,
+   struct amount_summary *credits, struct amount_summary *debits);
+
+/*
+ * Times summarize_amounts() with the vector instructions, with plain
+ * C, and by reading the store, checks that they agree, and prints all
+ * three
+ */
+int print_amount_benchmark(const struct transaction_store *store);
+
+void free_amount_column(void);
+
+#endif
+
+
+
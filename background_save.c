@@ -0,0 +1,330 @@
+/*
+ *
+ * Name:       background_save.c
+ *
+ * Purpose:    Contains functions for saving the budget on a
+ *             background thread, so the menus don't wait for it.
+ *
+ *             A change just marks the budget as needing a save and
+ *             wakes the thread. The thread waits a moment for more
+ *             changes, then writes them all out with one save.
+ *
+ *             This needs POSIX threads. Everywhere else, the budget
+ *             is saved as each change is made, like before.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The POSIX headers need this before any other #include.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_PTHREADS
+#endif
+
+#include "background_save.h"
+#include "file_operations.h"
+#include "read_input.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+
+
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void *save_in_background(void *unused);
+void *wait_for_signals(void *unused);
+void block_quit_signals(int how);
+
+/*
+ * budget_mutex guards the store and the flags below it. stop_mutex
+ * guards running, and makes sure only one thread stops the save
+ * thread, since both the menu and the signal thread may try.
+ */
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t stop_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t budget_changed = PTHREAD_COND_INITIALIZER;
+static pthread_t save_thread;
+static pthread_t signal_thread;
+static struct transaction_store *saved_budget = NULL;
+static BOOL running = FALSE;
+static BOOL save_pending = FALSE;
+static BOOL stop_requested = FALSE;
+static BOOL save_failed = FALSE;
+#endif
+
+
+
+BOOL start_background_saves(struct transaction_store *budget)
+{
+#ifdef HAVE_PTHREADS
+   saved_budget = budget;
+
+   /*
+    * Both threads inherit this signal mask, so quit signals only reach
+    * the signal thread, which saves before the program ends.
+    */
+   block_quit_signals(SIG_BLOCK);
+
+   if(pthread_create(&save_thread, NULL, save_in_background, NULL) != 0)
+   {
+      block_quit_signals(SIG_UNBLOCK);
+      return FALSE;
+   }
+
+   pthread_mutex_lock(&stop_mutex);
+   running = TRUE;
+   pthread_mutex_unlock(&stop_mutex);
+
+   if(pthread_create(&signal_thread, NULL, wait_for_signals, NULL) != 0)
+   {
+      (void) stop_background_saves();
+      block_quit_signals(SIG_UNBLOCK);
+      return FALSE;
+   }
+
+   pthread_detach(signal_thread);
+
+   return TRUE;
+#else
+   (void) budget;
+
+   return FALSE;
+#endif
+}
+
+
+
+int stop_background_saves(void)
+{
+#ifdef HAVE_PTHREADS
+   int result;
+
+   pthread_mutex_lock(&stop_mutex);
+
+   if(running)
+   {
+      pthread_mutex_lock(&budget_mutex);
+      stop_requested = TRUE;
+      pthread_cond_signal(&budget_changed);
+      pthread_mutex_unlock(&budget_mutex);
+
+      pthread_join(save_thread, NULL);
+      running = FALSE;
+   }
+
+   result = save_failed ? FILE_OPS_ERROR : 0;
+
+   pthread_mutex_unlock(&stop_mutex);
+
+   return result;
+#else
+   return 0;
+#endif
+}
+
+
+
+BOOL background_saves_running(void)
+{
+#ifdef HAVE_PTHREADS
+   BOOL result;
+
+   pthread_mutex_lock(&stop_mutex);
+   result = running;
+   pthread_mutex_unlock(&stop_mutex);
+
+   return result;
+#else
+   return FALSE;
+#endif
+}
+
+
+
+int request_background_save(void)
+{
+#ifdef HAVE_PTHREADS
+   int result;
+
+   pthread_mutex_lock(&budget_mutex);
+   save_pending = TRUE;
+   pthread_cond_signal(&budget_changed);
+   result = save_failed ? FILE_OPS_ERROR : 0;
+   pthread_mutex_unlock(&budget_mutex);
+
+   return result;
+#else
+   return 0;
+#endif
+}
+
+
+
+/*
+ * These lock whether or not the save thread is running, so a lock
+ * taken before it stops is still let go after, and a quit signal
+ * can't save while the menu writes.
+ */
+void lock_budget(void)
+{
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&budget_mutex);
+#endif
+}
+
+
+
+void unlock_budget(void)
+{
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&budget_mutex);
+#endif
+}
+
+
+
+#ifdef HAVE_PTHREADS
+/*
+ *
+ * The save thread
+ *
+ * It sleeps until a change comes in, then keeps collecting changes
+ * until SAVE_COALESCE_MILLISECONDS have passed, and saves once.
+ * When it is told to stop, it saves anything still waiting first.
+ *
+ * The list is locked while it is written, so a change made during
+ * a save waits for the save to finish.
+ *
+ */
+void *save_in_background(void *unused)
+{
+   struct timespec deadline;
+
+   (void) unused;
+
+   pthread_mutex_lock(&budget_mutex);
+
+   for( ;; )
+   {
+      while(!save_pending && !stop_requested)
+      {
+         pthread_cond_wait(&budget_changed, &budget_mutex);
+      }
+
+      if(!save_pending)
+      {
+         break;
+      }
+
+      if(!stop_requested)
+      {
+         clock_gettime(CLOCK_REALTIME, &deadline);
+         deadline.tv_nsec += (SAVE_COALESCE_MILLISECONDS % 1000) * 1000000L;
+         deadline.tv_sec += SAVE_COALESCE_MILLISECONDS / 1000
+            + deadline.tv_nsec / 1000000000L;
+         deadline.tv_nsec %= 1000000000L;
+
+         while(!stop_requested && pthread_cond_timedwait(&budget_changed,
+            &budget_mutex, &deadline) != ETIMEDOUT)
+         {
+            /* Another change came in; keep waiting for the deadline */
+         }
+      }
+
+      save_pending = FALSE;
+
+      if(save_transactions(saved_budget) == FILE_OPS_ERROR)
+      {
+         save_failed = TRUE;
+      }
+   }
+
+   pthread_mutex_unlock(&budget_mutex);
+
+   return NULL;
+}
+
+
+
+/*
+ *
+ * The signal thread
+ *
+ * Waits for Ctrl-C, a terminal hangup, or a request to terminate,
+ * and saves everything the way Save and Quit does before we exit.
+ *
+ * save_and_quit() stops the save thread, then keeps the budget
+ * locked until we exit, so the menu can't change or write it while
+ * we save. If the menu is already saving and quitting, we wait for
+ * it instead.
+ *
+ */
+void *wait_for_signals(void *unused)
+{
+   sigset_t signals;
+   int signal_number;
+
+   (void) unused;
+
+   sigemptyset(&signals);
+   sigaddset(&signals, SIGINT);
+   sigaddset(&signals, SIGTERM);
+   sigaddset(&signals, SIGHUP);
+
+   if(sigwait(&signals, &signal_number) == 0)
+   {
+      printf("\n\nSaving your changes before quitting.\n\n");
+
+      if(save_and_quit(saved_budget) == FILE_OPS_ERROR)
+      {
+         exit(EXIT_FAILURE);
+      }
+
+      exit(EXIT_SUCCESS);
+   }
+
+   return NULL;
+}
+
+
+
+void block_quit_signals(int how)
+{
+   sigset_t signals;
+
+   sigemptyset(&signals);
+   sigaddset(&signals, SIGINT);
+   sigaddset(&signals, SIGTERM);
+   sigaddset(&signals, SIGHUP);
+
+   pthread_sigmask(how, &signals, NULL);
+}
+#endif
+
+
+
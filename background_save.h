@@ -0,0 +1,60 @@
+/*
+ *
+ * Name:       background_save.h
+ *
+ * Purpose:    Contains function prototypes for saving the budget on
+ *             a background thread, so the menus don't wait for it.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef BACKGROUND_SAVE_H
+#define BACKGROUND_SAVE_H
+#include "crud_operations.h"
+#include "boolean.h"
+
+/*
+ * After a change, the background thread waits this long for more
+ * changes before it saves, so a burst of edits costs one save.
+ */
+#define SAVE_COALESCE_MILLISECONDS 500
+
+/*
+ * Starts the thread that saves budget. Returns FALSE if threads
+ * aren't available here; the program then saves as each change is made.
+ */
+BOOL start_background_saves(struct transaction_store *budget);
+
+/* Saves any change that is still waiting, and stops the thread */
+int stop_background_saves(void);
+
+BOOL background_saves_running(void);
+
+/*
+ * Marks the budget as changed. Returns FILE_OPS_ERROR if an
+ * earlier background save failed.
+ */
+int request_background_save(void);
+
+/*
+ * The store must be locked while it is changed or written, since the
+ * background thread or the signal thread may be reading it.
+ */
+void lock_budget(void);
+void unlock_budget(void);
+
+#endif
+
+
+
@@ -0,0 +1,81 @@
+/*
+ *
+ * Name:       balance.c
+ *
+ * Purpose:    Contains functions for keeping the totals of the credits
+ *             and debits in the budget.
+ *
+ *             Each transaction is added to its total when it goes into
+ *             the budget and taken back out when it leaves, so the
+ *             balance costs O(1) per change, and showing it never has
+ *             to read the budget.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include "balance.h"
+
+/* Whole cents, so the totals are exact however many there are */
+static CENTS total_credits = 0;
+static CENTS total_debits = 0;
+
+
+
+void add_to_balance(const struct transaction *node)
+{
+   if(node->type == CREDIT_TYPE)
+   {
+      total_credits += node->amount;
+   }
+   else
+   {
+      total_debits += node->amount;
+   }
+}
+
+
+
+void remove_from_balance(const struct transaction *node)
+{
+   if(node->type == CREDIT_TYPE)
+   {
+      total_credits -= node->amount;
+   }
+   else
+   {
+      total_debits -= node->amount;
+   }
+}
+
+
+
+CENTS get_total_credits(void)
+{
+   return total_credits;
+}
+
+
+
+CENTS get_total_debits(void)
+{
+   return total_debits;
+}
+
+
+
@@ -0,0 +1,52 @@
+/*
+ *
+ * Name:       balance.h
+ *
+ * Purpose:    Contains function prototypes for keeping the totals of
+ *             the credits and debits in the budget.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef BALANCE_H
+#define BALANCE_H
+#include "transaction_store.h"
+#include "conversions.h"
+
+/* Type 1 transactions are credits, and type 0 are debits */
+#define CREDIT_TYPE 1
+#define DEBIT_TYPE 0
+
+/*
+ * A total can be much bigger than one amount, so it needs room for
+ * every digit of a CENTS, a sign, a decimal point, and a '\0'
+ */
+#define BALANCE_LENGTH 24
+
+/*
+ * The ID index calls these as transactions are added and removed, so
+ * the totals are ready as soon as the budget is loaded, and never
+ * need the budget to be read again
+ */
+void add_to_balance(const struct transaction *node);
+void remove_from_balance(const struct transaction *node);
+
+/* The totals of every transaction in memory */
+CENTS get_total_credits(void);
+CENTS get_total_debits(void);
+
+#endif
+
+
+
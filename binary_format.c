@@ -0,0 +1,416 @@
+/*
+ *
+ * Name:       binary_format.c
+ *
+ * Purpose:    Contains functions for keeping the budget in a file
+ *             of fixed-width binary records.
+ *
+ *             Loading budget.bin needs no tokenizing. The file is
+ *             mapped into memory and each record is read in place
+ *             at a fixed offset.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include "binary_format.h"
+#include "file_operations.h"
+#include "conversions.h"
+#include "read_input.h"
+#include "transaction_index.h"
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+unsigned long read_little_endian(const unsigned char *bytes, int count);
+void write_little_endian(unsigned char *bytes, int count, unsigned long value);
+
+
+
+/*
+ *
+ * Reads budget.bin into a store of transactions
+ *
+ * Like the text loader, we check the whole file before trusting it,
+ * and return FILE_OPS_ERROR instead of loading part of it.
+ *
+ */
+int load_binary_transactions(const char *file_name,
+   struct transaction_store *budget)
+{
+   struct mapped_file file;
+   const unsigned char *data;
+   const unsigned char *record;
+   const unsigned char *heap;
+
+   char description_string[DESCRIPTION_LENGTH + 1];
+
+   unsigned long number_of_records;
+   unsigned long heap_size;
+   unsigned long description_offset;
+   unsigned long i;
+   unsigned long id;
+   long day_number;
+   long first_day = date_to_day_number("1/1/0001");
+   long last_day = date_to_day_number("12/31/2999");
+   CENTS cents;
+   int description_length;
+   int type;
+
+   struct transaction *current_node;
+
+   BOOL load_error = FALSE;
+
+   init_store(budget);
+
+   if(map_file(file_name, &file) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   data = (const unsigned char *) file.data;
+
+   if(file.size < BINARY_HEADER_SIZE
+      || memcmp(data, BINARY_MAGIC, 8) != 0)
+   {
+      printf("\n%s is not a budget file.\n", file_name);
+      printf("\nThe program will exit so no data is lost.\n\n");
+      unmap_file(&file);
+      return FILE_OPS_ERROR;
+   }
+
+   number_of_records = read_little_endian(data + 8, 8);
+   heap_size = read_little_endian(data + 16, 8);
+
+   if(number_of_records > (file.size - BINARY_HEADER_SIZE) / BINARY_RECORD_SIZE
+      || file.size != BINARY_HEADER_SIZE
+         + number_of_records * BINARY_RECORD_SIZE + heap_size)
+   {
+      printf("\n%s is the wrong size for the records it holds.\n", file_name);
+      printf("\nThe program will exit so no data is lost.\n\n");
+      unmap_file(&file);
+      return FILE_OPS_ERROR;
+   }
+
+   record = data + BINARY_HEADER_SIZE;
+   heap = record + number_of_records * BINARY_RECORD_SIZE;
+
+   for(i = 0; i < number_of_records && !load_error;
+      i++, record += BINARY_RECORD_SIZE)
+   {
+      cents = (CENTS) read_little_endian(record, 4);
+      day_number = (long) read_little_endian(record + 8, 4);
+      description_offset = read_little_endian(record + 12, 4);
+      description_length = record[16];
+      type = record[17];
+      id = read_little_endian(record + 20, 4);
+
+      /* The day number is a signed 32-bit number */
+      if(day_number > 2147483647L)
+      {
+         day_number = -(long) (4294967295UL - (unsigned long) day_number) - 1;
+      }
+
+      if(read_little_endian(record + 4, 4) != 0 || cents > MAX_CENTS
+         || day_number < first_day || day_number > last_day
+         || description_offset > heap_size
+         || description_length > DESCRIPTION_LENGTH
+         || description_length > (long) (heap_size - description_offset)
+         || (type != 0 && type != 1) || id > MAX_TRANSACTION_ID)
+      {
+         printf("\nRecord %lu of %s is not a valid transaction.\n",
+            i + 1, file_name);
+         load_error = TRUE;
+         break;
+      }
+
+      memcpy(description_string, heap + description_offset,
+         description_length);
+      description_string[description_length] = '\0';
+
+      current_node = new_transaction(budget, day_number, cents, type,
+         description_string);
+
+      if(current_node == NULL)
+      {
+         printf("\nMemory allocation error.\n");
+         load_error = TRUE;
+         break;
+      }
+
+      current_node->id = (int) id;
+   }
+
+   unmap_file(&file);
+
+   if(load_error)
+   {
+      printf("\nThe program will exit so no data is lost.\n\n");
+      free_store(budget);
+      return FILE_OPS_ERROR;
+   }
+
+   return (int) number_of_records;
+}
+
+
+
+/*
+ *
+ * Writes every transaction in the store to budget.bin
+ *
+ * The records and the heap are staged in a block of memory and
+ * written SAVE_BLOCK_SIZE bytes at a time.
+ *
+ */
+int write_binary_transactions(const char *file_name,
+   const struct transaction_store *budget)
+{
+   FILE *fp;
+   unsigned char header[BINARY_HEADER_SIZE];
+   unsigned char *block;
+   unsigned char *record;
+   size_t used = 0;
+   size_t description_length;
+   unsigned long number_of_records = 0;
+   unsigned long heap_size = 0;
+
+   struct store_cursor cursor;
+   struct transaction *p;
+
+   BOOL write_error = FALSE;
+
+   /* The header needs the number of records and size of the heap */
+   for(p = first_transaction(budget, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      number_of_records++;
+      heap_size += strlen(p->description);
+   }
+
+   if(heap_size > 4294967295UL)
+   {
+      printf("\nThe descriptions are too large to store in %s.\n\n",
+         file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   block = malloc(SAVE_BLOCK_SIZE);
+   if(block == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   fp = fopen(file_name, "wb");
+   if(fp == NULL)
+   {
+      free(block);
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for writing..\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   memcpy(header, BINARY_MAGIC, 8);
+   write_little_endian(header + 8, 8, number_of_records);
+   write_little_endian(header + 16, 8, heap_size);
+   write_error = !write_block(fp, header, BINARY_HEADER_SIZE);
+
+   /* Records, with each description's place in the heap */
+   heap_size = 0;
+   for(p = first_transaction(budget, &cursor); p != NULL && !write_error;
+      p = next_transaction(&cursor))
+   {
+      if(used + BINARY_RECORD_SIZE > SAVE_BLOCK_SIZE)
+      {
+         write_error = !write_block(fp, block, used);
+         used = 0;
+      }
+
+      description_length = strlen(p->description);
+
+      record = block + used;
+      memset(record, 0, BINARY_RECORD_SIZE);
+      write_little_endian(record, 8, (unsigned long) p->amount);
+      write_little_endian(record + 8, 4, (unsigned long) (long) p->day);
+      write_little_endian(record + 12, 4, heap_size);
+      record[16] = (unsigned char) description_length;
+      record[17] = p->type;
+      write_little_endian(record + 20, 4, (unsigned long) p->id);
+
+      heap_size += description_length;
+      used += BINARY_RECORD_SIZE;
+   }
+
+   /* The heap, which is just the descriptions back to back */
+   for(p = first_transaction(budget, &cursor); p != NULL && !write_error;
+      p = next_transaction(&cursor))
+   {
+      description_length = strlen(p->description);
+
+      if(used + description_length > SAVE_BLOCK_SIZE)
+      {
+         write_error = !write_block(fp, block, used);
+         used = 0;
+      }
+
+      memcpy(block + used, p->description, description_length);
+      used += description_length;
+   }
+
+   if(!write_error)
+   {
+      write_error = !write_block(fp, block, used) || !sync_file(fp);
+   }
+
+   free(block);
+
+   if(fclose(fp) == EOF || write_error)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not write %s.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Converts budget.txt to budget.bin, or the other way around
+ *
+ * Dates are written back as m/d/yyyy and amounts with two decimal
+ * places, so a file in that form comes back byte for byte. We won't
+ * convert while there is a journal, since its changes belong to
+ * whichever file was being used.
+ *
+ */
+int convert_budget_file(BOOL to_binary)
+{
+   struct transaction_store budget;
+   const char *from_file_name = to_binary ? FILE_NAME : BINARY_FILE_NAME;
+   const char *to_file_name = to_binary ? BINARY_FILE_NAME : FILE_NAME;
+   int number_of_transactions;
+   int result;
+
+   if(file_exists(JOURNAL_FILE_NAME))
+   {
+      printf("\n%s has changes that haven't been saved.\n\n",
+         JOURNAL_FILE_NAME);
+      printf("Please run the program and choose Save and Quit first.\n\n");
+      return FILE_OPS_ERROR;
+   }
+
+   if(to_binary)
+   {
+      number_of_transactions = load_transactions(from_file_name, &budget);
+   }
+   else
+   {
+      number_of_transactions = load_binary_transactions(from_file_name,
+         &budget);
+   }
+
+   if(number_of_transactions == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   /* Rows saved before there were IDs get them now */
+   if(index_transactions(&budget, from_file_name) == FILE_OPS_ERROR)
+   {
+      free_store(&budget);
+      return FILE_OPS_ERROR;
+   }
+
+   if(to_binary)
+   {
+      result = write_binary_transactions(TEMP_FILE_NAME, &budget);
+   }
+   else
+   {
+      result = write_transactions(TEMP_FILE_NAME, &budget);
+   }
+
+   free_store(&budget);
+   free_transaction_index();
+
+   if(result == FILE_OPS_ERROR)
+   {
+      remove(TEMP_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   if(replace_file(TEMP_FILE_NAME, to_file_name) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   printf("\nConverted %d transactions from %s to %s.\n\n",
+      number_of_transactions, from_file_name, to_file_name);
+
+   return number_of_transactions;
+}
+
+
+
+unsigned long read_little_endian(const unsigned char *bytes, int count)
+{
+   unsigned long value = 0;
+
+   while(count-- > 0)
+   {
+      value = (value << 8) | bytes[count];
+   }
+
+   return value;
+}
+
+
+
+/*
+ *
+ * Bytes past the width of an unsigned long are written as 0,
+ * or as 0xff for the sign of a negative number
+ *
+ */
+void write_little_endian(unsigned char *bytes, int count, unsigned long value)
+{
+   int i;
+   unsigned char fill = (value >> (sizeof(value) * 8 - 1)) ? 0xff : 0;
+
+   for(i = 0; i < count; i++)
+   {
+      if((size_t) i < sizeof(value))
+      {
+         bytes[i] = (unsigned char) (value >> (i * 8));
+      }
+      else
+      {
+         bytes[i] = fill;
+      }
+   }
+}
+
+
+
@@ -0,0 +1,62 @@
+/*
+ *
+ * Name:       binary_format.h
+ *
+ * Purpose:    Contains function prototypes for keeping the budget
+ *             in a file of fixed-width binary records.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+#include "crud_operations.h"
+#include "boolean.h"
+
+/*
+ * The binary file is a header, then one record per transaction, then
+ * a heap holding the text of every description. All numbers are
+ * stored little-endian.
+ *
+ * Header:   bytes 0-7    BINARY_MAGIC
+ *           bytes 8-15   number of records
+ *           bytes 16-23  size of the description heap
+ *
+ * Record:   bytes 0-7    amount, in cents
+ *           bytes 8-11   date, as days since 1/1/1970 (signed)
+ *           bytes 12-15  offset of the description in the heap
+ *           byte  16     length of the description
+ *           byte  17     type (0 or 1)
+ *           bytes 18-19  reserved, always 0
+ *           bytes 20-23  ID, or 0 in files saved before there were IDs
+ */
+#define BINARY_MAGIC "CBUDBIN1"
+#define BINARY_HEADER_SIZE 24
+#define BINARY_RECORD_SIZE 24
+
+int load_binary_transactions(const char *file_name,
+   struct transaction_store *budget);
+int write_binary_transactions(const char *file_name,
+   const struct transaction_store *budget);
+
+/*
+ * Converts budget.txt to budget.bin, or the other way around.
+ * Returns the number of transactions converted, or FILE_OPS_ERROR.
+ */
+int convert_budget_file(BOOL to_binary);
+
+#endif
+
+
+
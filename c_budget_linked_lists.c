@@ -34,8 +34,23 @@
 #include "validation.h"
 #include "read_input.h"
 #include "crud_operations.h"
-
-char *parse_transaction_string(char *transaction_field, char *complete_transaction_string);
+#include "file_operations.h"
+#include "binary_format.h"
+#include "background_save.h"
+#include "shard_storage.h"
+#include "parallel_load.h"
+#include "delimiter_scan.h"
+#include "transaction_index.h"
+#include "date_index.h"
+#include "search_index.h"
+#include "balance.h"
+#include "rollups.h"
+#include "date_totals.h"
+#include "amount_column.h"
+#include "transaction_sort.h"
+#include "top_amounts.h"
+#include "transaction_filter.h"
+#include "transaction_pool.h"
 
 
 
@@ -44,131 +59,269 @@ char *parse_transaction_string(char *transaction_field, char *complete_transacti
  * Main function
  *
  */
-int main(void)
+int main(int argc, char *argv[])
 {
-   FILE *fp;
-   char *transaction_string_index;
-   
-   char date_string[DATE_LENGTH + 1];
-   char amount_string[AMOUNT_LENGTH + 1];
-   char type_string[TYPE_LENGTH + 1];
-   char description_string[DESCRIPTION_LENGTH + 1];
-   
-   char *date;
-   char *amount;
-   char *type;
-   char *description;
-   
-   /* This will be our first node in the unordered list */
-   /* This node begins the list of all transactions in our budget */
-   struct transaction *budget = NULL;
-   struct transaction *previous_node = NULL;
-   struct transaction *current_node;
-   
-   char complete_transaction_string[MAX_TRANSACTION_LENGTH + 1] = {0};
    char main_menu_input_string[MENU_INPUT_LENGTH + 1];
    
+   /* Every transaction in our budget, in the order they were added */
+   struct transaction_store budget;
+   
    int number_of_transactions = 0;
    int menu_option_to_int;
    int read_input_return_code;
+   CENTS credits;
+   CENTS debits;
+   int i;
+   long sync_setting;
+   long load_threads;
+   char *end;
    
-   /*
-    * Check for the existence of budget.txt
-    * Terminate if can't open for reading.
-    * Otherwise, open the file and get the number of transactions in it.
-    */
-   fp = fopen(FILE_NAME, "r");
-   if(fp == NULL)
-   {
-      printf("\nFile error.\n\n");
-      printf("Please ensure %s exists, and try again.\n\n", FILE_NAME);
-      return EXIT_FAILURE;
-   }
-
-   printf("\n");
+   BOOL save_in_background = FALSE;
+   BOOL unsharded_format = FALSE;
+   BOOL show_memory_statistics = FALSE;
+   BOOL benchmark_date_totals = FALSE;
+   BOOL benchmark_amounts = FALSE;
+   BOOL benchmark_reports = FALSE;
+   BOOL benchmark_top = FALSE;
+   BOOL benchmark_filter = FALSE;
+   BOOL benchmark_scan = FALSE;
+   long sort_benchmark_records = 0;
+   long sort_setting;
+   
+   /* Use this processor's vector instructions to split lines */
+   choose_delimiter_scanner();
+   choose_amount_kernels();
    
    /*
-    * Read the transactions from file. Stop filling the list after we
-    * reach the max number of transactions. If we can read another transaction,
-    * above the max, the file is too large, and we will exit.
+    * -j or --journal appends each change to the journal instead
+    * of rewriting budget.txt every time.
+    *
+    * -b or --binary keeps the budget in budget.bin instead of
+    * budget.txt. --to-binary and --to-text convert between the
+    * two files and quit.
+    *
+    * -z or --zero-copy maps budget.txt into memory and loads it
+    * without copying each field.
+    *
+    * -a or --async saves changes on a background thread, so the
+    * menu comes back right away.
+    *
+    * --sync-every=N and --sync-interval=MS let journal entries go
+    * to the disk together, once every N changes or MS milliseconds,
+    * instead of one at a time.
+    *
+    * -s or --sharded saves the budget in one file per month, and
+    * only loads the months that are needed.
+    *
+    * --threads=N parses budget.txt, and adds up the reports, on N
+    * threads at once.
+    *
+    * --sort-memory=MB lets a sort hold MB megabytes of transactions
+    * before it sorts the rest through temporary files.
+    *
+    * --memory-stats prints how much memory the budget took to load,
+    * and how many times we had to ask the system for it.
     */
-   while(fgets(complete_transaction_string,
-      MAX_TRANSACTION_LENGTH + 1, fp) != NULL
-      && number_of_transactions < MAX_TRANSACTIONS + 1)
+   for(i = 1; i < argc; i++)
    {
-      /*
-       * If we are able to read one transaction above the max, then the file
-       * is too big. I'm defining this as a critical error since the program
-       * deletes the original file in the Create(), Delete(), and Update()
-       * functions and replaces the file's data up to (only) the maximum number
-       * of transactions defined in THIS application. I don't want to allow
-       * the possibility for the user to run this program on a large budget
-       * file and possibly lose their data.
-       */
-      if(number_of_transactions > MAX_TRANSACTIONS - 1)
+      if(strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--journal") == 0)
       {
-         printf("\nThere is too much data in the file to read.\n\n");
-         printf("The program will exit.\n\n");
-         return EXIT_FAILURE;
+         set_journal_mode(TRUE);
+         unsharded_format = TRUE;
       }
-      
-      /* Keep track of our position as we read from the 
-       *complete_transaction_string array */
-      transaction_string_index = complete_transaction_string;
-   
-      transaction_string_index = parse_transaction_string(date_string,
-         transaction_string_index);
-      transaction_string_index = parse_transaction_string(amount_string,
-         transaction_string_index);
-      transaction_string_index = parse_transaction_string(type_string,
-         transaction_string_index);
-      transaction_string_index = parse_transaction_string(description_string,
-         transaction_string_index);
-      
-      /* Allocate memory for new transaction structure coming from
-       * the file */
-      current_node = malloc(sizeof(struct transaction));
-      
-      if(current_node == NULL)
+      else if(strcmp(argv[i], "-b") == 0 || strcmp(argv[i], "--binary") == 0)
       {
-         printf("\nMemory allocation error.\n");
-         return EXIT_FAILURE;
+         set_binary_mode(TRUE);
+         unsharded_format = TRUE;
       }
-      
-      date = malloc(strlen(date_string));
-      amount = malloc(strlen(amount_string));
-      type = malloc(strlen(type_string));
-      description= malloc(strlen(description_string));
-      
-      strcpy(date, date_string);
-      strcpy(amount, amount_string);
-      strcpy(type, type_string);
-      strcpy(description, description_string);
-      
-      current_node->date = date;
-      current_node->amount = amount;
-      current_node->type = type;
-      current_node->description = description;
-      
-      if(number_of_transactions == 0)
+      else if(strcmp(argv[i], "-z") == 0
+         || strcmp(argv[i], "--zero-copy") == 0)
       {
-         previous_node = current_node;
-         current_node->next = NULL;
-         budget = current_node;
+         set_zero_copy_mode(TRUE);
+         unsharded_format = TRUE;
       }
-      
-      previous_node->next = current_node;
-      previous_node = current_node;
-      current_node->next = NULL;
-      
-      number_of_transactions++;
+      else if(strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--async") == 0)
+      {
+         save_in_background = TRUE;
+      }
+      else if(strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--sharded") == 0)
+      {
+         set_sharded_mode(TRUE);
+      }
+      else if(strncmp(argv[i], "--sync-every=", 13) == 0
+         && (sync_setting = strtol(argv[i] + 13, &end, 10)) > 0
+         && *end == '\0')
+      {
+         set_sync_policy(SYNC_EVERY_N_CHANGES, sync_setting);
+      }
+      else if(strncmp(argv[i], "--sync-interval=", 16) == 0
+         && (sync_setting = strtol(argv[i] + 16, &end, 10)) > 0
+         && *end == '\0')
+      {
+         set_sync_policy(SYNC_EVERY_INTERVAL, sync_setting);
+      }
+      else if(strncmp(argv[i], "--threads=", 10) == 0
+         && (load_threads = strtol(argv[i] + 10, &end, 10)) > 0
+         && *end == '\0')
+      {
+         set_load_threads(load_threads > MAX_LOAD_THREADS
+            ? MAX_LOAD_THREADS : (int) load_threads);
+         set_rollup_threads(load_threads > MAX_LOAD_THREADS
+            ? MAX_LOAD_THREADS : (int) load_threads);
+      }
+      else if(strncmp(argv[i], "--sort-memory=", 14) == 0
+         && (sort_setting = strtol(argv[i] + 14, &end, 10)) > 0
+         && sort_setting <= MAX_SORT_MEGABYTES && *end == '\0')
+      {
+         set_sort_memory(sort_setting * 1024 * 1024);
+      }
+      else if(strcmp(argv[i], "--memory-stats") == 0)
+      {
+         show_memory_statistics = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-date-totals") == 0)
+      {
+         benchmark_date_totals = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-amounts") == 0)
+      {
+         benchmark_amounts = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-reports") == 0)
+      {
+         benchmark_reports = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-top") == 0)
+      {
+         benchmark_top = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-filter") == 0)
+      {
+         benchmark_filter = TRUE;
+      }
+      else if(strcmp(argv[i], "--benchmark-scan") == 0)
+      {
+         benchmark_scan = TRUE;
+      }
+      else if(strncmp(argv[i], "--benchmark-sort=", 17) == 0
+         && (sort_setting = strtol(argv[i] + 17, &end, 10)) > 0
+         && *end == '\0')
+      {
+         sort_benchmark_records = sort_setting;
+      }
+      else if(strcmp(argv[i], "--to-binary") == 0
+         || strcmp(argv[i], "--to-text") == 0)
+      {
+         if(convert_budget_file(strcmp(argv[i], "--to-binary") == 0)
+            == FILE_OPS_ERROR)
+         {
+            return EXIT_FAILURE;
+         }
+         
+         return EXIT_SUCCESS;
+      }
+      else
+      {
+         printf("\nUnknown option: %s\n\n", argv[i]);
+         printf("Usage: %s [-j | --journal] [-b | --binary]", argv[0]);
+         printf(" [-z | --zero-copy] [-a | --async]\n");
+         printf("       [--sync-every=N | --sync-interval=MS]");
+         printf(" [-s | --sharded]\n");
+         printf("       [--threads=N] [--sort-memory=MB] [--memory-stats]\n");
+         printf("       [--benchmark-date-totals] [--benchmark-amounts]\n");
+         printf("       [--benchmark-reports] [--benchmark-top]");
+         printf(" [--benchmark-filter]\n");
+         printf("       [--benchmark-sort=N] [--benchmark-scan]\n");
+         printf("       %s --to-binary | --to-text\n\n", argv[0]);
+         return EXIT_FAILURE;
+      }
+   }
+   
+   /* The months are always saved as text, one change at a time */
+   if(sharded_mode_enabled() && unsharded_format)
+   {
+      printf("\n-s can't be used with -j, -b, or -z.\n\n");
+      return EXIT_FAILURE;
    }
    
-   fclose(fp);
+   /*
+    * Read every transaction in budget.txt, and any changes in the
+    * journal, into our store. Terminate if the file can't be opened,
+    * or if any part of it can't be read.
+    */
+   number_of_transactions = load_budget(&budget);
+   if(number_of_transactions == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(show_memory_statistics)
+   {
+      print_memory_statistics();
+   }
+   
+   /* The benchmarks need every month, even in sharded mode */
+   if((benchmark_date_totals || benchmark_amounts || benchmark_reports
+      || benchmark_top || benchmark_filter)
+      && load_all_shards(&budget, &number_of_transactions) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_date_totals
+      && print_date_totals_benchmark(&budget) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_amounts && print_amount_benchmark(&budget) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_reports && print_rollup_benchmark(&budget) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_top && print_top_benchmark(&budget) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_filter
+      && print_filter_benchmark(&budget) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(benchmark_scan && print_scan_benchmark(FILE_NAME) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(sort_benchmark_records > 0
+      && print_sort_benchmark(sort_benchmark_records) == FILE_OPS_ERROR)
+   {
+      return EXIT_FAILURE;
+   }
+   
+   if(save_in_background && !start_background_saves(&budget))
+   {
+      printf("\nSaving in the background isn't available on this system.\n");
+      printf("Changes will be saved as they are made.\n");
+   }
+
+   printf("\n");
    
    for( ;; )
    {
-      display_main_menu();
+      /* The months that aren't loaded are added from their saved totals */
+      credits = get_total_credits();
+      debits = get_total_debits();
+      add_unloaded_shard_totals(&credits, &debits);
+      
+      display_main_menu(credits, debits);
       
       read_input_return_code = read_menu_input(main_menu_input_string);
       
@@ -177,6 +330,7 @@ int main(void)
       {
          printf("\nThere was an error reading your input.\n\n");
          printf("Please try again.\n\n");
+         (void) stop_background_saves();
          return EXIT_FAILURE;
       }
       
@@ -187,28 +341,24 @@ int main(void)
       {
          menu_option_to_int = atoi(main_menu_input_string);
          
+         /* In sharded mode, these need every month to be loaded */
+         if(menu_option_to_int >= 2 && menu_option_to_int <= 7
+            && load_all_shards(&budget, &number_of_transactions)
+               == FILE_OPS_ERROR)
+         {
+            (void) stop_background_saves();
+            return EXIT_FAILURE;
+         }
+         
          if(menu_option_to_int == 1)
          {
-            /* 
-             * Make sure the number of transactions in our file is LESS
-             * than the total number of allowed transactions; otherwise,
-             * we can't add a transaction if the file is maxed out.
-             */
-            if(number_of_transactions < MAX_TRANSACTIONS)
-            {
-               number_of_transactions =
-                  create_transaction(&number_of_transactions, &budget);
-            }
-            else
-            {
-               printf("\n\nThe file contains the max number of transactions.\n");
-               printf("\nWe cannot add any more transactions.\n");
-            }
+            number_of_transactions =
+               create_transaction(&number_of_transactions, &budget);
          }
          else if(menu_option_to_int == 2)
          {
             number_of_transactions =
-               read_transactions(&number_of_transactions, budget);
+               display_transactions(&number_of_transactions, &budget);
          }
          else if(menu_option_to_int == 3)
          {
@@ -221,7 +371,7 @@ int main(void)
             else
             {
                number_of_transactions =
-                  update_transaction(&number_of_transactions, budget);
+                  update_transaction(&number_of_transactions, &budget);
             }
          }
          else if(menu_option_to_int == 4)
@@ -240,7 +390,37 @@ int main(void)
          }
          else if(menu_option_to_int == 5)
          {
-            printf("\nOption 5: Save and Quit\n\n");
+            number_of_transactions =
+               find_transactions_by_date(&number_of_transactions, &budget);
+         }
+         else if(menu_option_to_int == 6)
+         {
+            number_of_transactions =
+               find_transactions_by_description(&number_of_transactions,
+                  &budget);
+         }
+         else if(menu_option_to_int == 7)
+         {
+            number_of_transactions =
+               show_reports(&number_of_transactions, &budget);
+         }
+         else if(menu_option_to_int == 8)
+         {
+            printf("\nOption 8: Save and Quit\n\n");
+            
+            if(save_and_quit(&budget) == FILE_OPS_ERROR)
+            {
+               return EXIT_FAILURE;
+            }
+            
+            free_date_index();
+            free_search_index();
+            free_rollups();
+            free_date_totals();
+            free_amount_column();
+            free_transaction_index();
+            free_memory_pools();
+            
             return EXIT_SUCCESS;
          }
          else
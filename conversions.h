@@ -0,0 +1,96 @@
+/*
+ *
+ * Name:       conversions.h
+ *
+ * Purpose:    Contains function prototypes for converting dates
+ *             and amounts between their text form and numbers.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef CONVERSIONS_H
+#define CONVERSIONS_H
+#include <limits.h>
+#include "boolean.h"
+
+/*
+ * Amounts are kept as a whole number of cents, in 64 bits. c89 has no
+ * 64-bit integer type, so we pick one here: long where it is 64 bits,
+ * as on most Unix systems, __int64 with Microsoft's compiler, where
+ * long is only 32 bits, and long long with GCC or Clang elsewhere.
+ */
+#if (LONG_MAX >> 31 >> 31) != 0
+typedef long CENTS;
+#define CENTS_MAX LONG_MAX
+#elif defined(_MSC_VER)
+typedef __int64 CENTS;
+#define CENTS_MAX _I64_MAX
+#elif defined(__GNUC__)
+__extension__ typedef long long CENTS;
+#define CENTS_MAX (__extension__ __LONG_LONG_MAX__)
+#else
+#error "c_budget_linked_lists needs a 64-bit integer type for CENTS"
+#endif
+
+#define CENTS_MIN (-CENTS_MAX - 1)
+
+/* The largest amount that fits in AMOUNT_LENGTH characters */
+#define MAX_CENTS 999999999L
+
+/*
+ * Every total we keep adds up at most one amount for each of the
+ * 999,999,999 transaction IDs, so none of them can overflow a CENTS.
+ * This won't compile if CENTS is ever too small for that.
+ */
+typedef char CENTS_TOTALS_FIT[CENTS_MAX / MAX_CENTS / 999999999L >= 2
+   ? 1 : -1];
+
+/* Dates are kept as the number of days since 1/1/1970 */
+#define INVALID_DAY_NUMBER -2147483647L
+
+long date_to_day_number(const char *date_string);
+void day_number_to_date(long day_number, char *date_string);
+
+/* The month a day is in, counted as year * 12 + month - 1 */
+int day_number_to_month(long day_number);
+
+BOOL amount_to_cents(const char *amount_string, CENTS *cents);
+void cents_to_amount(CENTS cents, char *amount_string);
+
+/*
+ * Writes whole cents as digits, with a '-' if they are negative, and
+ * returns a pointer to the character after them. The files that keep
+ * totals use these, since printf() can only print a CENTS that is a
+ * long. CENTS_TEXT_LENGTH is the most characters it writes.
+ */
+#define CENTS_TEXT_LENGTH 20
+char *write_cents(char *p, CENTS cents);
+
+/*
+ * Reads what write_cents() wrote into *cents, and returns a pointer
+ * to the character after it, or NULL if there was no number there
+ */
+const char *read_cents(const char *p, CENTS *cents);
+
+/*
+ * Converts the text of a transaction's date, amount, and type into the
+ * numbers we keep in memory. Returns FALSE if any of them isn't valid.
+ */
+BOOL fields_to_values(const char *date_string, const char *amount_string,
+   const char *type_string, long *day_number, CENTS *cents, int *type);
+
+#endif
+
+
+
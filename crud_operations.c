@@ -29,42 +29,58 @@
 #include "read_input.h"
 #include "validation.h"
 #include "menus.h"
+#include "file_operations.h"
+#include "background_save.h"
+#include "description_pool.h"
+#include "transaction_index.h"
+#include "date_index.h"
+#include "search_index.h"
+#include "balance.h"
+#include "rollups.h"
+#include "date_totals.h"
+#include "amount_column.h"
+#include "transaction_sort.h"
+#include "transaction_view.h"
+#include "top_amounts.h"
+#include "transaction_filter.h"
+#include "conversions.h"
 
 char *build_transaction_string(const char *input, char *completed_transaction);
-char *parse_transaction_string(char *transaction_field, char *complete_transaction_string);
+struct transaction *allocate_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description, BOOL borrow);
+int print_sorted_transactions(const struct transaction_store *budget,
+   int key);
+int print_filtered_transactions(const struct transaction_store *budget);
+BOOL read_date_range(char *first_date_string, char *last_date_string);
+void print_amount_summaries(const struct transaction_store *budget);
+void print_top_transactions(const struct transaction_store *budget);
+char read_report_choice(const char *prompt, char last_option);
 
 
 
-int create_transaction(int *number_of_transactions, struct transaction **ptr_budget)
+int create_transaction(int *number_of_transactions,
+   struct transaction_store *budget)
 {
-   FILE *fp;
-   FILE* temp_pointer;
-   char complete_transaction_string[MAX_TRANSACTION_LENGTH + 1] = {0};
    char date_string[DATE_LENGTH + 1];
    char amount_string[AMOUNT_LENGTH + 1];
    char type_string[TYPE_LENGTH + 1];
    char description_string[DESCRIPTION_LENGTH + 1];
    
-   char *date;
-   char *amount;
-   char *type;
-   char *description;
-   
    struct transaction *new_node;
-   struct transaction *p;
    
+   long day;
+   CENTS cents;
+   int type;
+   
+   BOOL valid_date = FALSE;
    BOOL valid_amount = FALSE, valid_description = FALSE;
    
-   /*
-    * Check for the existence of budget.txt
-    * Terminate if can't open for appending.
-    */
-   fp = fopen(FILE_NAME, "a+");
-   if(fp == NULL)
+   /* A new ID past the highest one could never be loaded again */
+   if(get_next_transaction_id() > MAX_TRANSACTION_ID)
    {
-      printf("\nFile error.\n\n");
-      printf("Please ensure %s exists, and try again.\n\n", FILE_NAME);
-      exit(EXIT_FAILURE);
+      printf("\nThere are no more transaction IDs to give out, so no new\n");
+      printf("records can be added.\n");
+      return *number_of_transactions;
    }
    
    /* Prompt for and validate date */
@@ -79,11 +95,14 @@ int create_transaction(int *number_of_transactions, struct transaction **ptr_bud
          return *number_of_transactions;
       }
       
-      if(!is_valid_date(date_string))
+      valid_date = is_valid_date(date_string)
+         && date_to_day_number(date_string) != INVALID_DAY_NUMBER;
+      
+      if(!valid_date)
       {
          printf("\nThe date you entered was invalid. Please try again.\n");
       }
-   } while(!is_valid_date(date_string));
+   } while(!valid_date);
    
    /* Prompt for and validate amount */
    do
@@ -98,7 +117,8 @@ int create_transaction(int *number_of_transactions, struct transaction **ptr_bud
          return *number_of_transactions;
       }
 
-      valid_amount = is_valid_amount(amount_string);
+      valid_amount = is_valid_amount(amount_string)
+         && amount_to_cents(amount_string, &cents);
       
       if(!valid_amount)
       {
@@ -144,99 +164,644 @@ int create_transaction(int *number_of_transactions, struct transaction **ptr_bud
       }
    } while(!valid_description);
    
-   /* Allocate memory for our new transaction node */
-   new_node = malloc(sizeof(struct transaction));
-      
-   if(new_node == NULL)
+   /* Add our new transaction to the end of the store, and give it an ID */
+   (void) fields_to_values(date_string, amount_string, type_string, &day,
+      &cents, &type);
+   
+   lock_budget();
+   
+   new_node = new_transaction(budget, day, cents, type, description_string);
+   
+   if(new_node == NULL || !index_transaction(new_node))
    {
       printf("\nMemory allocation error.\n");
-      return EXIT_FAILURE;
+      exit(EXIT_FAILURE);
    }
    
-   /* Put our new transaction into our unordered list */
-   date = malloc(strlen(date_string));
-   amount = malloc(strlen(amount_string));
-   type = malloc(strlen(type_string));
-   description= malloc(strlen(description_string));
+   unlock_budget();
    
-   strcpy(date, date_string);
-   strcpy(amount, amount_string);
-   strcpy(type, type_string);
-   strcpy(description, description_string);
+   /* Write record to budget.txt, or to the journal */
+   if(save_created_transaction(budget, new_node) == FILE_OPS_ERROR)
+   {
+      exit(EXIT_FAILURE);
+   }
    
-   new_node->date = date;
-   new_node->amount = amount;
-   new_node->type = type;
-   new_node->description = description;
+   printf("\nRecord was successfully added.\n");
+   
+   (*number_of_transactions)++;
+   return *number_of_transactions;
+}
+
+
+
+int read_transactions(int *number_of_transactions,
+   const struct transaction_store *budget)
+{
+   /* Show the transactions in the order they are stored, a page at a time */
+   view_transactions(budget);
+   
+   return *number_of_transactions;
+}
+
+
+
+int display_transactions(int *number_of_transactions,
+   const struct transaction_store *budget)
+{
+   char menu_string[MENU_INPUT_LENGTH + 1];
+   
+   BOOL valid_option = FALSE;
+   
+   /* Prompt for and validate the order */
+   do
+   {
+      printf("Show the transactions (1) as they are stored, (2) by date,\n");
+      printf("(3) by amount, (4) by description, or (5) that match a filter.\n");
+      printf("Enter \"b\" to go back: ");
+      read_menu_input(menu_string);
       
-   new_node->next = *ptr_budget;
-   *ptr_budget = new_node;
+      if(*menu_string == 'b' || *menu_string == 'B')
+      {
+         return *number_of_transactions;
+      }
+      
+      valid_option = *menu_string >= '1' && *menu_string <= '5'
+         && menu_string[1] == '\0';
+      
+      if(!valid_option)
+      {
+         printf("\nYou entered an invalid option. Please try again.\n\n");
+      }
+   } while(!valid_option);
    
-   temp_pointer = fopen(TEMP_FILE_NAME, "w");
-   if(temp_pointer == NULL)
+   if(*menu_string == '1')
    {
-      printf("\nFile error.\n\n");
-      printf("Could not open %s for writing..\n\n", TEMP_FILE_NAME);
-      exit(EXIT_FAILURE);
+      return read_transactions(number_of_transactions, budget);
    }
    
-   /* Write record to budget.txt */
-   p = *ptr_budget;
-   while(p != NULL)
+   printf("\n");
+   
+   if(*menu_string == '5')
    {
-      strcpy(complete_transaction_string, p->date);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->amount);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->type);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->description);
-      strcat(complete_transaction_string, "|");
-      fprintf(temp_pointer, "%s\n", complete_transaction_string);
-      p = p->next;
+      (void) print_filtered_transactions(budget);
+      return *number_of_transactions;
    }
    
-   fclose(temp_pointer);
-   remove(FILE_NAME);
-   rename(TEMP_FILE_NAME, FILE_NAME);
-   fclose(fp);
+   /* Options 2 to 4 are SORT_BY_DATE to SORT_BY_DESCRIPTION */
+   (void) print_sorted_transactions(budget, *menu_string - '1');
    
-   printf("\nRecord was successfully added.\n");
+   return *number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Prints every transaction sorted by key, a page at a time. A budget
+ * too big to sort in the memory set for sorts is sorted through
+ * temporary files.
+ *
+ */
+int print_sorted_transactions(const struct transaction_store *budget,
+   int key)
+{
+   struct transaction_sort sort;
+   struct store_cursor cursor;
+   struct row_pager pager;
+   const struct transaction *temp;
+   
+   if(start_sort(&sort, key) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+   
+   for(temp = first_transaction(budget, &cursor); temp != NULL;
+      temp = next_transaction(&cursor))
+   {
+      if(add_to_sort(&sort, temp) == FILE_OPS_ERROR)
+      {
+         free_sort(&sort);
+         return FILE_OPS_ERROR;
+      }
+   }
+   
+   if(finish_sort(&sort) == FILE_OPS_ERROR)
+   {
+      free_sort(&sort);
+      return FILE_OPS_ERROR;
+   }
+   
+   start_pages(&pager);
+   
+   for(temp = next_sorted(&sort); temp != NULL && page_row(&pager, temp);
+      temp = next_sorted(&sort))
+   {
+      /* page_row() shows it */
+   }
+   
+   flush_rows();
+   free_sort(&sort);
+   
+   return sort.failed ? FILE_OPS_ERROR : 0;
+}
+
+
+
+/*
+ *
+ * Prompts for a filter, and shows every transaction that matches it,
+ * a page at a time.
+ * The filter is compiled once, instead of being read again for every
+ * transaction.
+ *
+ */
+int print_filtered_transactions(const struct transaction_store *budget)
+{
+   char filter_string[DESCRIPTION_LENGTH + 1];
+   
+   struct transaction_filter filter;
+   struct transaction **matches;
+   struct row_pager pager;
+   
+   long number_found;
+   long i;
+   
+   printf("Enter a filter like: type=0 AND amount>50.00 AND date>=9/1/2022 AND desc~\"Eat\"\n");
+   printf("The fields are id, type, amount, date, and desc, and they can be compared\n");
+   printf("with =, !=, <, <=, >, or >=. Use desc~ for text in the description, desc:\n");
+   printf("for its words, and AND, OR, NOT, and parentheses to join the tests.\n");
+   printf("Enter \"b\" to go back: ");
+   read_description_input(filter_string);
+   
+   if(strcmp(filter_string, "b") == 0 || strcmp(filter_string, "B") == 0)
+   {
+      return 0;
+   }
+   
+   if(compile_filter(filter_string, budget, &filter) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+   
+   number_found = filter_transactions(&filter, budget, &matches);
+   free_filter(&filter);
+   
+   if(number_found == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+   
+   printf("\n");
+   start_pages(&pager);
+   
+   /* Print out the matches in order of their IDs, a page at a time */
+   for(i = 0; i < number_found && page_row(&pager, matches[i]); i++)
+   {
+      /* page_row() shows it */
+   }
+   
+   flush_rows();
+   free(matches);
+   
+   printf("\n%ld transactions matched the filter.\n", number_found);
+   
+   return 0;
+}
+
+
+
+int find_transactions_by_date(int *number_of_transactions,
+   const struct transaction_store *budget)
+{
+   char first_date_string[DATE_LENGTH + 1];
+   char last_date_string[DATE_LENGTH + 1];
+   
+   struct date_cursor cursor;
+   struct row_pager pager;
+   struct transaction *temp;
+   
+   int first_day = 0;
+   int last_day = 0;
+   long number_found = 0;
+   
+   if(!read_date_range(first_date_string, last_date_string))
+   {
+      return *number_of_transactions;
+   }
+   
+   first_day = (int) date_to_day_number(first_date_string);
+   last_day = (int) date_to_day_number(last_date_string);
+   
+   if(build_date_index(budget) == FILE_OPS_ERROR)
+   {
+      return *number_of_transactions;
+   }
+   
+   start_pages(&pager);
+   
+   /*
+    * Print out the transactions in the range in order of their dates, a
+    * page at a time. Once the user goes back, the rest aren't read.
+    */
+   for(temp = first_in_date_range(first_day, last_day, &cursor);
+      temp != NULL && page_row(&pager, temp);
+      temp = next_in_date_range(&cursor))
+   {
+      number_found++;
+   }
+   
+   flush_rows();
+   
+   if(pager.stopped)
+   {
+      printf("\n%ld transactions from %s to %s were shown so far.\n",
+         number_found, first_date_string, last_date_string);
+   }
+   else
+   {
+      printf("\n%ld transactions were found from %s to %s.\n",
+         number_found, first_date_string, last_date_string);
+   }
    
-   (*number_of_transactions)++;
    return *number_of_transactions;
 }
 
 
 
-int read_transactions(int *number_of_transactions, struct transaction *budget)
+/*
+ *
+ * Prompts for the first and last dates of a range, until the last one
+ * isn't before the first. Returns FALSE if the user goes back.
+ *
+ */
+BOOL read_date_range(char *first_date_string, char *last_date_string)
 {
-   struct transaction *temp = budget;
-   int i = 1;
+   BOOL valid_date = FALSE;
    
-   printf("%-10s\t%-11s\t%-10s\t%-5s\t%-50s\n", "Id", "Date", "Amount", "Type", "Description");
-   printf("%10s\t%-11s\t%-10s\t%-5s\t%-50s\n", "----------", "-----------", "----------", "-----",
-          "--------------------------------------------------");
+   /* Prompt for and validate the first date of the range */
+   do
+   {
+      printf("\nEnter the first date to show (mm/dd/yyyy). Enter \"b\" to go back: ");
+      read_date_input(first_date_string);
+      
+      if(*first_date_string == 'b' || *first_date_string == 'B')
+      {
+         return FALSE;
+      }
+      
+      valid_date = is_valid_date(first_date_string)
+         && date_to_day_number(first_date_string) != INVALID_DAY_NUMBER;
+      
+      if(!valid_date)
+      {
+         printf("\nThe date you entered was invalid. Please try again.\n");
+      }
+   } while(!valid_date);
    
-   /* Print out the transactions from the 2d array */
-   while(temp != NULL)
+   /* Prompt for and validate the last date of the range */
+   do
    {
-      printf("%10d\t%-11s\t%10s\t%5s\t%-50s\n", i, temp->date,
-         temp->amount, temp->type, temp->description);
-      temp = temp->next;
-      i++;
+      printf("\nEnter the last date to show (mm/dd/yyyy). Enter \"b\" to go back: ");
+      read_date_input(last_date_string);
+      
+      if(*last_date_string == 'b' || *last_date_string == 'B')
+      {
+         return FALSE;
+      }
+      
+      valid_date = is_valid_date(last_date_string)
+         && date_to_day_number(last_date_string) != INVALID_DAY_NUMBER;
+      
+      if(!valid_date)
+      {
+         printf("\nThe date you entered was invalid. Please try again.\n");
+      }
+      else if(date_to_day_number(last_date_string)
+         < date_to_day_number(first_date_string))
+      {
+         printf("\nThe last date can't be before the first date. Please try again.\n");
+         valid_date = FALSE;
+      }
+   } while(!valid_date);
+   
+   return TRUE;
+}
+
+
+
+int find_transactions_by_description(int *number_of_transactions,
+   const struct transaction_store *budget)
+{
+   char query_string[DESCRIPTION_LENGTH + 1];
+   
+   struct row_pager pager;
+   
+   int *ids;
+   long number_found;
+   long i;
+   
+   /* A query can start with b, so only a lone "b" goes back */
+   printf("\nEnter the words to search for. End a word with * to match any word\n");
+   printf("starting with it. Enter \"b\" to go back: ");
+   read_description_input(query_string);
+   
+   if(strcmp(query_string, "b") == 0 || strcmp(query_string, "B") == 0)
+   {
+      return *number_of_transactions;
    }
    
+   if(build_search_index(budget) == FILE_OPS_ERROR)
+   {
+      return *number_of_transactions;
+   }
+   
+   number_found = search_transactions(query_string, &ids);
+   if(number_found == FILE_OPS_ERROR)
+   {
+      return *number_of_transactions;
+   }
+   
+   start_pages(&pager);
+   
+   /* Print out the transactions that matched, in order of their IDs */
+   for(i = 0; i < number_found && page_row(&pager, find_transaction(ids[i]));
+      i++)
+   {
+      /* page_row() shows it */
+   }
+   
+   flush_rows();
+   free(ids);
+   
+   printf("\n%ld transactions were found.\n", number_found);
+   
    return *number_of_transactions;
 }
 
 
 
-int update_transaction(int *number_of_transactions, struct transaction *budget)
+int show_reports(int *number_of_transactions,
+   const struct transaction_store *budget)
 {
-   FILE* temp_pointer;
-   char complete_transaction_string[MAX_TRANSACTION_LENGTH + 1];
-   char id_string[MENU_INPUT_LENGTH + 1];
+   char menu_string[MENU_INPUT_LENGTH + 1];
+   char first_date_string[DATE_LENGTH + 1];
+   char last_date_string[DATE_LENGTH + 1];
+   char credits_string[BALANCE_LENGTH];
+   char debits_string[BALANCE_LENGTH];
+   char balance_string[BALANCE_LENGTH];
+   
+   CENTS credits;
+   CENTS debits;
+   
+   BOOL valid_option = FALSE;
+   
+   /* Prompt for and validate the kind of report */
+   do
+   {
+      printf("\nShow totals (1) by month, (2) by description, (3) between two dates,\n");
+      printf("or (4) of the whole budget, or (5) the largest or smallest amounts.\n");
+      printf("Enter \"b\" to go back: ");
+      read_menu_input(menu_string);
+      
+      if(*menu_string == 'b' || *menu_string == 'B')
+      {
+         return *number_of_transactions;
+      }
+      
+      valid_option = *menu_string >= '1' && *menu_string <= '5'
+         && menu_string[1] == '\0';
+      
+      if(!valid_option)
+      {
+         printf("\nYou entered an invalid option. Please try again.\n");
+      }
+   } while(!valid_option);
+   
+   if(*menu_string == '3'
+      && !read_date_range(first_date_string, last_date_string))
+   {
+      return *number_of_transactions;
+   }
+   
+   if(*menu_string == '5')
+   {
+      print_top_transactions(budget);
+      return *number_of_transactions;
+   }
+   
+   printf("\n");
+   
+   /*
+    * Building or fixing the totals changes them, so the save thread
+    * has to wait
+    */
+   lock_budget();
+   
+   if(*menu_string == '1')
+   {
+      (void) print_month_rollups(budget);
+   }
+   else if(*menu_string == '2')
+   {
+      (void) print_description_rollups(budget);
+   }
+   else if(*menu_string == '4')
+   {
+      print_amount_summaries(budget);
+   }
+   else if(build_date_totals(budget) != FILE_OPS_ERROR)
+   {
+      get_date_range_totals(date_to_day_number(first_date_string),
+         date_to_day_number(last_date_string), &credits, &debits);
+      
+      cents_to_amount(credits, credits_string);
+      cents_to_amount(debits, debits_string);
+      cents_to_amount(credits - debits, balance_string);
+      
+      printf("From %s to %s:\n\n", first_date_string, last_date_string);
+      printf("   Credits: %s\n", credits_string);
+      printf("   Debits:  %s\n", debits_string);
+      printf("   Balance: %s\n", balance_string);
+   }
+   
+   unlock_budget();
+   
+   return *number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Asks whether to find the largest or smallest amounts, of which type,
+ * how many of them, and between which dates, and shows them
+ *
+ */
+void print_top_transactions(const struct transaction_store *budget)
+{
+   char count_string[ID_INPUT_LENGTH + 1];
+   char first_date_string[DATE_LENGTH + 1];
+   char last_date_string[DATE_LENGTH + 1];
+   const char *type_names[3] = {"debits", "credits", "transactions"};
+   const int types[3] = {DEBIT_TYPE, CREDIT_TYPE, ANY_TYPE};
+   
+   struct transaction **top;
+   struct top_query query;
+   
+   long number_found;
+   long i;
+   char order;
+   char type;
+   
+   BOOL valid_count = FALSE;
+   
+   order = read_report_choice("Show the (1) largest or (2) smallest amounts.", '2');
+   if(order == 'b')
+   {
+      return;
+   }
+   
+   type = read_report_choice("Of (1) debits, (2) credits, or (3) both.", '3');
+   if(type == 'b')
+   {
+      return;
+   }
+   
+   /* Prompt for and validate how many to show */
+   do
+   {
+      printf("\nHow many would you like to see (1 to %d)? Enter \"b\" to go back: ",
+         MAX_TOP_COUNT);
+      (void) read_id_input(count_string);
+      
+      if(*count_string == 'b' || *count_string == 'B')
+      {
+         return;
+      }
+      
+      query.count = atoi(count_string);
+      valid_count = query.count >= 1 && query.count <= MAX_TOP_COUNT;
+      
+      if(!valid_count)
+      {
+         printf("\nThe number you entered was invalid. Please try again.\n");
+      }
+   } while(!valid_count);
+   
+   if(!read_date_range(first_date_string, last_date_string))
+   {
+      return;
+   }
+   
+   query.largest = order == '1';
+   query.type = types[type - '1'];
+   query.first_day = date_to_day_number(first_date_string);
+   query.last_day = date_to_day_number(last_date_string);
+   
+   top = malloc(sizeof(struct transaction *) * (size_t) query.count);
+   if(top == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return;
+   }
+   
+   number_found = find_top_transactions(budget, &query, top);
+   if(number_found != FILE_OPS_ERROR)
+   {
+      printf("\nThe %ld %s %s from %s to %s:\n\n", number_found,
+         query.largest ? "largest" : "smallest", type_names[type - '1'],
+         first_date_string, last_date_string);
+      
+      buffer_row_heading();
+      
+      for(i = 0; i < number_found; i++)
+      {
+         buffer_transaction_row(top[i]);
+      }
+      
+      flush_rows();
+   }
+   
+   free(top);
+}
+
+
+
+/*
+ *
+ * Prompts until one of the options from 1 to last_option is chosen.
+ * Returns the option, or 'b' if the user goes back.
+ *
+ */
+char read_report_choice(const char *prompt, char last_option)
+{
+   char menu_string[MENU_INPUT_LENGTH + 1];
+   
+   for( ;; )
+   {
+      printf("\n%s Enter \"b\" to go back: ", prompt);
+      read_menu_input(menu_string);
+      
+      if(*menu_string == 'b' || *menu_string == 'B')
+      {
+         return 'b';
+      }
+      
+      if(*menu_string >= '1' && *menu_string <= last_option
+         && menu_string[1] == '\0')
+      {
+         return *menu_string;
+      }
+      
+      printf("\nYou entered an invalid option. Please try again.\n");
+   }
+}
+
+
+
+/*
+ *
+ * Prints the count, total, smallest, and largest of the credits and
+ * of the debits in the whole budget
+ *
+ */
+void print_amount_summaries(const struct transaction_store *budget)
+{
+   struct amount_summary summaries[2];
+   char total_string[BALANCE_LENGTH];
+   char smallest_string[BALANCE_LENGTH];
+   char largest_string[BALANCE_LENGTH];
+   int kind;
+   
+   if(summarize_amounts(budget, &summaries[0], &summaries[1])
+      == FILE_OPS_ERROR)
+   {
+      return;
+   }
+   
+   printf("%-7s\t%8s\t%14s\t%10s\t%10s\n", "", "Count", "Total",
+      "Smallest", "Largest");
+   printf("%-7s\t%8s\t%14s\t%10s\t%10s\n", "-------", "--------",
+      "--------------", "----------", "----------");
+   
+   for(kind = 0; kind < 2; kind++)
+   {
+      cents_to_amount(summaries[kind].total, total_string);
+      cents_to_amount(summaries[kind].smallest, smallest_string);
+      cents_to_amount(summaries[kind].largest, largest_string);
+      
+      printf("%-7s\t%8ld\t%14s\t%10s\t%10s\n",
+         kind == 0 ? "Credits" : "Debits", summaries[kind].count,
+         total_string, smallest_string, largest_string);
+   }
+}
+
+
+
+int update_transaction(int *number_of_transactions,
+   struct transaction_store *budget)
+{
+   char id_string[ID_INPUT_LENGTH + 1];
    char menu_string[MENU_INPUT_LENGTH + 1];
    char date_string[DATE_LENGTH + 1];
    char amount_string[AMOUNT_LENGTH + 1];
@@ -244,20 +809,24 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
    char description_string[DESCRIPTION_LENGTH + 1];
    
    struct transaction *p;
-   struct transaction *prev;
+   
+   long day;
+   CENTS cents;
+   int type;
    
    BOOL valid_id = FALSE;
    BOOL valid_date= FALSE;
    BOOL valid_amount = FALSE;
    BOOL valid_description = FALSE;
    
-   int i, id = 0;
+   int id = 0;
    
-   (void) read_transactions(number_of_transactions, budget);
+   print_first_page(budget);
    
    do
    {
-      printf("\nType the ID of the transaction you would like to edit. Enter \"b\" to go back: ");
+      printf("\nType the ID of the transaction you would like to edit, or \"v\" to view\n");
+      printf("the budget a page at a time. Enter \"b\" to go back: ");
       
       (void) read_id_input(id_string);
       
@@ -267,11 +836,19 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
          return *number_of_transactions;
       }
       
+      if(*id_string == 'v' || *id_string == 'V')
+      {
+         view_transactions(budget);
+         continue;
+      }
+      
       /* Convert the character id entered by the user to int */
       id = atoi(id_string);
       printf("\nYou entered: %d\n", id);
    
-      if(id > *number_of_transactions || id < 1)
+      p = find_transaction(id);
+      
+      if(p == NULL)
       {
          printf("\nThe id you entered is invalid. Please try again.\n\n");
       }
@@ -281,26 +858,9 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
       }
    } while(!valid_id);
    
-   /* Go through the list until we get to the transaction line
-    * of the ID that the user gave. We will store this lilne
-    * in the complete_transaction_string
-    */
-   p = budget;
-   prev = budget;
-   i = 1;
-   while(p != NULL && i <= id)
-   {
-      if(i == id)
-      {
-         strcpy(date_string, p->date);
-         strcpy(amount_string, p->amount);
-         strcpy(type_string, p->type);
-         strcpy(description_string, p->description);
-      }
-      prev = p;
-      p = p->next;
-      i++;
-   }
+   /* Copy the fields of the transaction the user chose */
+   transaction_to_text(p, date_string, amount_string, type_string);
+   strcpy(description_string, p->description);
    
    /* Let the user choose which field they want to update */
    do
@@ -323,7 +883,8 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
          printf("\nEnter the date of the transaction (mm/dd/yyyy). Enter \"b\" to go back: ");
          read_date_input(date_string);
       
-         valid_date = is_valid_date(date_string);
+         valid_date = is_valid_date(date_string)
+            && date_to_day_number(date_string) != INVALID_DAY_NUMBER;
       
          if(*date_string == 'b' || *date_string == 'B')
          {
@@ -352,7 +913,8 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
             return *number_of_transactions;
          }
          
-         valid_amount = is_valid_amount(amount_string);
+         valid_amount = is_valid_amount(amount_string)
+            && amount_to_cents(amount_string, &cents);
       
          if(!valid_amount)
          {
@@ -417,41 +979,25 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
     * Rebuild the node with any new data given
     * by the user
     */
-   strcpy(prev->date, date_string);
-   strcpy(prev->amount, amount_string);
-   strcpy(prev->type, type_string);
-   strcpy(prev->description, description_string);
-   
-   /* Move the new data to a temp file
-    * Remove the original file, and rename the temp file
-    * containing the new data
-    */
-   temp_pointer = fopen(TEMP_FILE_NAME, "w");
-   if(temp_pointer == NULL)
+   (void) fields_to_values(date_string, amount_string, type_string, &day,
+      &cents, &type);
+   
+   lock_budget();
+   
+   if(!set_transaction(p, day, cents, type, description_string))
    {
-      printf("\nFile error.\n\n");
-      printf("Could not open %s for writing..\n\n", TEMP_FILE_NAME);
+      printf("\nMemory allocation error.\n");
       exit(EXIT_FAILURE);
    }
    
-   p = budget;
-   while(p != NULL)
+   unlock_budget();
+   
+   /* Write the new data to budget.txt, or to the journal */
+   if(save_updated_transaction(budget, id, p) == FILE_OPS_ERROR)
    {
-      strcpy(complete_transaction_string, p->date);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->amount);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->type);
-      strcat(complete_transaction_string, "|");
-      strcat(complete_transaction_string, p->description);
-      strcat(complete_transaction_string, "|");
-      fprintf(temp_pointer, "%s\n", complete_transaction_string);
-      p = p->next;
+      exit(EXIT_FAILURE);
    }
    
-   fclose(temp_pointer);
-   remove(FILE_NAME);
-   rename(TEMP_FILE_NAME, FILE_NAME);
    printf("\nRecord %d successfully updated!\n", id);
    
    return *number_of_transactions;
@@ -459,27 +1005,26 @@ int update_transaction(int *number_of_transactions, struct transaction *budget)
 
 
 
-int delete_transaction(int *number_of_transactions, struct transaction **ptr_budget)
+int delete_transaction(int *number_of_transactions,
+   struct transaction_store *budget)
 {
-   FILE* temp_pointer;
-   char id_string[MENU_INPUT_LENGTH + 1];
+   char id_string[ID_INPUT_LENGTH + 1];
    char menu_string[MENU_INPUT_LENGTH + 1];
-   char complete_transaction_string[MAX_TRANSACTION_LENGTH + 1];
    
-   struct transaction *p;
-   struct transaction *prev;
-   struct transaction *free_mem;
+   struct transaction *node;
+   int shard;
    
    BOOL valid_id = FALSE;
    BOOL valid_yes_no = FALSE;
    
-   int i, id = 0;
+   int id = 0;
    
-   (void) read_transactions(number_of_transactions, *ptr_budget);
+   print_first_page(budget);
    
    do
    {
-      printf("\nType the ID of the transaction you would like to delete. Enter \"b\" to go back: ");
+      printf("\nType the ID of the transaction you would like to delete, or \"v\" to view\n");
+      printf("the budget a page at a time. Enter \"b\" to go back: ");
       
       (void) read_id_input(id_string);
       
@@ -489,11 +1034,19 @@ int delete_transaction(int *number_of_transactions, struct transaction **ptr_bud
          return *number_of_transactions;
       }
       
+      if(*id_string == 'v' || *id_string == 'V')
+      {
+         view_transactions(budget);
+         continue;
+      }
+      
       /* Convert the character id entered by the user to int */
       id = atoi(id_string);
       printf("\nYou entered: %d\n", id);
    
-      if(id > *number_of_transactions || id < 1)
+      node = find_transaction(id);
+      
+      if(node == NULL)
       {
          printf("\nThe id you entered is invalid. Please try again.\n\n");
       }
@@ -526,70 +1079,22 @@ int delete_transaction(int *number_of_transactions, struct transaction **ptr_bud
    
    if(*menu_string == 'y' || *menu_string == 'Y')
    {
-      /* Move the new data to a temp file
-       * Remove the original file, and rename the temp file
-       * containing the new data
+      /*
+       * Remove the deleted transaction from the store. The store may
+       * reuse its place right away, so keep its shard for the save.
        */
-    
-      /* Open temp file stream for budget data text file */
-      temp_pointer = fopen(TEMP_FILE_NAME, "w");
-      if(temp_pointer == NULL)
-      {
-         fclose(temp_pointer);
-         printf("Can't open %s\n", TEMP_FILE_NAME);
-         exit(EXIT_FAILURE);
-      }
+      lock_budget();
+      shard = node->shard;
+      remove_transaction(budget, node);
+      unlock_budget();
       
-      /* Remove the deleted transaction from list */
-      p = *ptr_budget;
-      prev = *ptr_budget;
-      i = 1;
-      while(p != NULL)
+      /* Write the remaining data to budget.txt, or to the journal */
+      if(save_deleted_transaction(budget, id, shard)
+         == FILE_OPS_ERROR)
       {
-         /* Skip the transaction we want to delete */
-         /* Set the previous node's "next pointer" to skip
-          * over the node to be deleted and point to the node
-          * after that one */
-         if(i == id)
-         {
-            /* Deleting the first transaction is a special case */
-            if(id == 1)
-            {
-               *ptr_budget = (*ptr_budget)->next;
-               free(prev);
-               prev->next = p->next;
-               p = p->next;
-               i++;
-               continue;
-            }
-            
-            free_mem = prev->next;
-            prev->next = p->next;
-            p = p->next;
-            free(free_mem);
-            i++;
-            continue;
-         }
-         
-         strcpy(complete_transaction_string, p->date);
-         strcat(complete_transaction_string, "|");
-         strcat(complete_transaction_string, p->amount);
-         strcat(complete_transaction_string, "|");
-         strcat(complete_transaction_string, p->type);
-         strcat(complete_transaction_string, "|");
-         strcat(complete_transaction_string, p->description);
-         strcat(complete_transaction_string, "|");
-         
-         fprintf(temp_pointer, "%s\n", complete_transaction_string);
-         
-         i++;
-         prev = p;
-         p = p->next;
+         exit(EXIT_FAILURE);
       }
       
-      fclose(temp_pointer);
-      remove(FILE_NAME);
-      rename(TEMP_FILE_NAME, FILE_NAME);
       printf("\nRecord %d successfully deleted!\n", id);
    }
    else
@@ -604,25 +1109,146 @@ int delete_transaction(int *number_of_transactions, struct transaction **ptr_bud
 
 
 
-/* Separate a full transaction line from the budget file
- * into its component parts (i.e., date, amount, type,
- * and descirption
+/*
+ *
+ * Takes a transaction out of the ID index, and marks its place in
+ * the store as deleted
+ *
  */
-char *parse_transaction_string(char *transaction_field, char *complete_transaction_string)
+void remove_transaction(struct transaction_store *budget,
+   struct transaction *node)
 {
-   char *p;
-   p = transaction_field;
+   unindex_transaction(node);
+   release_description(node->description);
+   delete_from_store(budget, node);
+}
+
+
+
+/*
+ *
+ * Gives a node new values for all of its fields
+ *
+ */
+BOOL set_transaction(struct transaction *node, long day, CENTS amount,
+   int type, const char *description)
+{
+   const char *pooled_description;
+   const char *old_description = node->description;
    
-   while((*complete_transaction_string != '|') && (*complete_transaction_string))
+   pooled_description = intern_description(description, FALSE);
+   if(pooled_description == NULL)
    {
-      *p = *complete_transaction_string++;
-      p++;
+      return FALSE;
    }
    
-   *p = '\0';
-   p = ++complete_transaction_string;
+   /* Take the old values out of the totals, and put the new ones in */
+   remove_from_balance(node);
+   remove_from_rollups(node);
+   remove_from_date_totals(node);
+   remove_from_amount_column(node);
+   
+   /* The date index is sorted by day, so it has to move */
+   if(node->day != (int) day)
+   {
+      remove_from_date_index(node);
+      node->day = (int) day;
+      add_to_date_index(node);
+   }
+
+   node->amount = amount;
+   node->type = (unsigned char) type;
+   
+   /* Descriptions are pooled, so a new one has a new pointer */
+   if(node->description != pooled_description)
+   {
+      remove_from_search_index(node);
+      node->description = pooled_description;
+      add_to_search_index(node);
+   }
+   
+   add_to_balance(node);
+   add_to_rollups(node);
+   add_to_date_totals(node);
+   add_to_amount_column(node);
+   
+   /* Evens out with the count taken above if it didn't change */
+   release_description(old_description);
+   
+   return TRUE;
+}
+
+
+
+void transaction_to_text(const struct transaction *node, char *date_string,
+   char *amount_string, char *type_string)
+{
+   day_number_to_date(node->day, date_string);
+   cents_to_amount(node->amount, amount_string);
+   type_string[0] = (char) ('0' + node->type);
+   type_string[1] = '\0';
+}
+
+
+
+struct transaction *new_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description)
+{
+   return allocate_transaction(budget, day, amount, type, description,
+      FALSE);
+}
+
+
+
+/*
+ *
+ * Adds a new transaction whose description may point at a string
+ * we don't own, like a line of a mapped budget file, if the pool
+ * doesn't have that description yet
+ *
+ */
+struct transaction *new_borrowed_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description)
+{
+   return allocate_transaction(budget, day, amount, type, description,
+      TRUE);
+}
+
+
+
+/*
+ *
+ * Finds the description in the description pool, and fills in a new
+ * record at the end of the store
+ *
+ * Returns NULL if we run out of memory.
+ *
+ */
+struct transaction *allocate_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description, BOOL borrow)
+{
+   const char *pooled_description;
+   struct transaction *new_node;
+   
+   pooled_description = intern_description(description, borrow);
+   if(pooled_description == NULL)
+   {
+      return NULL;
+   }
+   
+   new_node = add_to_store(budget);
+   if(new_node == NULL)
+   {
+      release_description(pooled_description);
+      return NULL;
+   }
+   
+   new_node->description = pooled_description;
+   new_node->day = (int) day;
+   new_node->amount = amount;
+   new_node->type = (unsigned char) type;
    
-   return p;
+   return new_node;
 }
 
 
@@ -24,26 +24,64 @@
 #define CRUD_OPERATIONS_H
 #include <stdio.h>
 #include "read_input.h"
+#include "conversions.h"
+#include "transaction_store.h"
+#include "boolean.h"
 
-struct transaction
-{
-   char *date;
-   char *amount;
-   char *type;
-   char *description;
-      
-   struct transaction *next;
-};
-
-/* For the Create function, we are using a pointer to a pointer to a budget
- * transaction node. This is because we need to modify the address of the
- * first node in the list when we create a new node.
+int create_transaction(int *number_of_transactions,
+   struct transaction_store *budget);
+int read_transactions(int *number_of_transactions,
+   const struct transaction_store *budget);
+
+/*
+ * Asks whether to show the transactions as they are stored, or sorted
+ * by date, amount, or description, and shows them
+ */
+int display_transactions(int *number_of_transactions,
+   const struct transaction_store *budget);
+
+/* Shows the transactions between two dates, in order of their dates */
+int find_transactions_by_date(int *number_of_transactions,
+   const struct transaction_store *budget);
+
+/* Shows the transactions whose descriptions contain some words */
+int find_transactions_by_description(int *number_of_transactions,
+   const struct transaction_store *budget);
+
+/*
+ * Shows totals by month, by description, between two dates, or of the
+ * whole budget
+ */
+int show_reports(int *number_of_transactions,
+   const struct transaction_store *budget);
+int update_transaction(int *number_of_transactions,
+   struct transaction_store *budget);
+int delete_transaction(int *number_of_transactions,
+   struct transaction_store *budget);
+
+/*
+ * Adds a transaction to the end of the store. A borrowed description
+ * is kept in the pool without being copied, for descriptions in a
+ * mapped budget file. Returns NULL if we run out of memory.
+ */
+struct transaction *new_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description);
+struct transaction *new_borrowed_transaction(struct transaction_store *budget,
+   long day, CENTS amount, int type, const char *description);
+
+/*
+ * Store operations shared by the menu options and by the journal
+ * replay. The transaction is taken out of the ID index as well, so
+ * find_transaction() doesn't find it anymore.
  */
-int create_transaction(int *number_of_transactions, struct transaction **ptr_budget);
+void remove_transaction(struct transaction_store *budget,
+   struct transaction *node);
+BOOL set_transaction(struct transaction *node, long day, CENTS amount,
+   int type, const char *description);
 
-int read_transactions(int *number_of_transactions, struct transaction *budget);
-int update_transaction(int *number_of_transactions, struct transaction *budget);
-int delete_transaction(int *number_of_transactions, struct transaction **ptr_budget);
+/* Turns a transaction's date, amount, and type back into text */
+void transaction_to_text(const struct transaction *node, char *date_string,
+   char *amount_string, char *type_string);
 
 #endif
 
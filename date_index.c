@@ -0,0 +1,431 @@
+/*
+ *
+ * Name:       date_index.c
+ *
+ * Purpose:    Contains functions for finding the transactions between
+ *             two dates without walking the store.
+ *
+ *             The store keeps transactions in the order they were
+ *             added, not by date, so a range of dates used to mean
+ *             reading every transaction. The index is a skip list of
+ *             (day, ID) pairs in order, so a range costs O(log n) to
+ *             find its first transaction and O(1) for each one after.
+ *
+ *             It holds IDs rather than pointers, and finds each
+ *             transaction through the ID index, so it doesn't care
+ *             when the store moves transactions around.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include "date_index.h"
+#include "transaction_index.h"
+
+/*
+ * forward[i] is the next node with at least i + 1 levels. It points
+ * just past the node itself, in the same allocation.
+ */
+struct date_node
+{
+   int day;
+   int id;
+   int level;
+   struct date_node **forward;
+};
+
+/* What the index is sorted by, while it is built */
+struct date_key
+{
+   int day;
+   int id;
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+BOOL date_node_before(const struct date_node *node, int day, int id);
+void find_date_predecessors(int day, int id, struct date_node **update);
+struct date_node *new_date_node(int day, int id);
+int random_date_level(void);
+int compare_date_keys(const void *a, const void *b);
+struct transaction *current_in_date_range(struct date_cursor *cursor);
+
+/*
+ * head comes before every node, with all of the levels. level is the
+ * most levels any node has now.
+ */
+static struct date_node *head_forward[MAX_DATE_INDEX_LEVEL];
+static struct date_node head = { 0, 0, MAX_DATE_INDEX_LEVEL, head_forward };
+static int level = 1;
+static BOOL index_built = FALSE;
+
+/* Only has to be random enough to keep the levels balanced */
+static unsigned long level_seed = 1;
+
+
+
+int build_date_index(const struct transaction_store *store)
+{
+   struct date_node *last[MAX_DATE_INDEX_LEVEL];
+   struct date_key *keys;
+   struct date_node *node;
+   struct store_cursor cursor;
+   struct transaction *p;
+   long number_of_keys = 0;
+   long i;
+   int j;
+
+   if(index_built)
+   {
+      return 0;
+   }
+
+   keys = malloc(sizeof(struct date_key)
+      * (size_t) (store->number_of_transactions + 1));
+   if(keys == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      keys[number_of_keys].day = p->day;
+      keys[number_of_keys].id = p->id;
+      number_of_keys++;
+   }
+
+   qsort(keys, (size_t) number_of_keys, sizeof(struct date_key),
+      compare_date_keys);
+
+   /* Sorted keys go on the end of every level they reach, in turn */
+   for(j = 0; j < MAX_DATE_INDEX_LEVEL; j++)
+   {
+      head_forward[j] = NULL;
+      last[j] = &head;
+   }
+
+   index_built = TRUE;
+   level = 1;
+
+   for(i = 0; i < number_of_keys; i++)
+   {
+      node = new_date_node(keys[i].day, keys[i].id);
+      if(node == NULL)
+      {
+         free(keys);
+         free_date_index();
+         printf("\nMemory allocation error.\n");
+         return FILE_OPS_ERROR;
+      }
+
+      for(j = 0; j < node->level; j++)
+      {
+         last[j]->forward[j] = node;
+         last[j] = node;
+      }
+
+      if(node->level > level)
+      {
+         level = node->level;
+      }
+   }
+
+   free(keys);
+
+   return 0;
+}
+
+
+
+void add_to_date_index(const struct transaction *node)
+{
+   struct date_node *update[MAX_DATE_INDEX_LEVEL];
+   struct date_node *new_node;
+   int i;
+
+   if(!index_built)
+   {
+      return;
+   }
+
+   new_node = new_date_node(node->day, node->id);
+   if(new_node == NULL)
+   {
+      free_date_index();
+      return;
+   }
+
+   find_date_predecessors(node->day, node->id, update);
+
+   for(i = level; i < new_node->level; i++)
+   {
+      update[i] = &head;
+   }
+
+   if(new_node->level > level)
+   {
+      level = new_node->level;
+   }
+
+   for(i = 0; i < new_node->level; i++)
+   {
+      new_node->forward[i] = update[i]->forward[i];
+      update[i]->forward[i] = new_node;
+   }
+}
+
+
+
+void remove_from_date_index(const struct transaction *node)
+{
+   struct date_node *update[MAX_DATE_INDEX_LEVEL];
+   struct date_node *p;
+   int i;
+
+   if(!index_built)
+   {
+      return;
+   }
+
+   find_date_predecessors(node->day, node->id, update);
+
+   p = update[0]->forward[0];
+   if(p == NULL || p->day != node->day || p->id != node->id)
+   {
+      return;
+   }
+
+   for(i = 0; i < p->level; i++)
+   {
+      update[i]->forward[i] = p->forward[i];
+   }
+
+   free(p);
+
+   while(level > 1 && head_forward[level - 1] == NULL)
+   {
+      level--;
+   }
+}
+
+
+
+struct transaction *first_in_date_range(int first_day, int last_day,
+   struct date_cursor *cursor)
+{
+   struct date_node *update[MAX_DATE_INDEX_LEVEL];
+
+   /* Every ID is above NO_TRANSACTION_ID */
+   find_date_predecessors(first_day, NO_TRANSACTION_ID, update);
+
+   cursor->node = update[0]->forward[0];
+   cursor->last_day = last_day;
+
+   return current_in_date_range(cursor);
+}
+
+
+
+struct transaction *next_in_date_range(struct date_cursor *cursor)
+{
+   if(cursor->node == NULL)
+   {
+      return NULL;
+   }
+
+   cursor->node = cursor->node->forward[0];
+
+   return current_in_date_range(cursor);
+}
+
+
+
+void free_date_index(void)
+{
+   struct date_node *p = head_forward[0];
+   struct date_node *next;
+   int i;
+
+   while(p != NULL)
+   {
+      next = p->forward[0];
+      free(p);
+      p = next;
+   }
+
+   for(i = 0; i < MAX_DATE_INDEX_LEVEL; i++)
+   {
+      head_forward[i] = NULL;
+   }
+
+   level = 1;
+   index_built = FALSE;
+}
+
+
+
+BOOL date_index_is_built(void)
+{
+   return index_built;
+}
+
+
+
+/*
+ *
+ * Returns TRUE if the node sorts before (day, id)
+ *
+ */
+BOOL date_node_before(const struct date_node *node, int day, int id)
+{
+   return node->day < day || (node->day == day && node->id < id);
+}
+
+
+
+/*
+ *
+ * Sets update[i] to the last node on level i that sorts before
+ * (day, id), for every level in use
+ *
+ */
+void find_date_predecessors(int day, int id, struct date_node **update)
+{
+   struct date_node *p = &head;
+   int i;
+
+   for(i = level - 1; i >= 0; i--)
+   {
+      while(p->forward[i] != NULL && date_node_before(p->forward[i], day, id))
+      {
+         p = p->forward[i];
+      }
+
+      update[i] = p;
+   }
+}
+
+
+
+/*
+ *
+ * Returns a node with a random number of levels, and its forward
+ * pointers not set yet, or NULL if we run out of memory
+ *
+ */
+struct date_node *new_date_node(int day, int id)
+{
+   struct date_node *node;
+   int node_level = random_date_level();
+
+   node = malloc(sizeof(struct date_node)
+      + sizeof(struct date_node *) * (size_t) node_level);
+   if(node == NULL)
+   {
+      return NULL;
+   }
+
+   node->day = day;
+   node->id = id;
+   node->level = node_level;
+   node->forward = (struct date_node **) (node + 1);
+
+   return node;
+}
+
+
+
+/*
+ *
+ * Each level after the first is kept with a chance of one in four,
+ * so a node has 1.33 levels on average
+ *
+ */
+int random_date_level(void)
+{
+   int node_level = 1;
+
+   for( ;; )
+   {
+      level_seed = (level_seed * 1103515245UL + 12345UL) & 0xffffffffUL;
+
+      if(node_level == MAX_DATE_INDEX_LEVEL || ((level_seed >> 16) & 3) != 0)
+      {
+         return node_level;
+      }
+
+      node_level++;
+   }
+}
+
+
+
+int compare_date_keys(const void *a, const void *b)
+{
+   const struct date_key *key_a = a;
+   const struct date_key *key_b = b;
+
+   if(key_a->day != key_b->day)
+   {
+      return key_a->day < key_b->day ? -1 : 1;
+   }
+
+   if(key_a->id != key_b->id)
+   {
+      return key_a->id < key_b->id ? -1 : 1;
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Returns the transaction the cursor is on, or NULL once it is
+ * past the last day
+ *
+ */
+struct transaction *current_in_date_range(struct date_cursor *cursor)
+{
+   struct transaction *p;
+
+   while(cursor->node != NULL && cursor->node->day <= cursor->last_day)
+   {
+      p = find_transaction(cursor->node->id);
+      if(p != NULL)
+      {
+         return p;
+      }
+
+      cursor->node = cursor->node->forward[0];
+   }
+
+   cursor->node = NULL;
+
+   return NULL;
+}
+
+
+
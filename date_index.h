@@ -0,0 +1,80 @@
+/*
+ *
+ * Name:       date_index.h
+ *
+ * Purpose:    Contains function prototypes for finding the transactions
+ *             between two dates without walking the store.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef DATE_INDEX_H
+#define DATE_INDEX_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/*
+ * The index is a skip list, which has room for more than 4^24
+ * transactions before its searches get any slower than O(log n)
+ */
+#define MAX_DATE_INDEX_LEVEL 24
+
+/* Where a walk through a range of dates is */
+struct date_cursor
+{
+   struct date_node *node;
+   int last_day;
+};
+
+/*
+ * Builds the index from every transaction in the store, unless it is
+ * already built. It is only built the first time a range is asked for,
+ * so loading the budget doesn't pay for it. Returns FILE_OPS_ERROR if
+ * we run out of memory.
+ */
+int build_date_index(const struct transaction_store *store);
+
+/*
+ * Keep a built index up to date as transactions are added, removed,
+ * or given a new date. They do nothing before the index is built. If
+ * we run out of memory, the index is dropped, to be built again the
+ * next time it is needed.
+ */
+void add_to_date_index(const struct transaction *node);
+void remove_from_date_index(const struct transaction *node);
+
+/*
+ * Walk the transactions from first_day to last_day, in order of their
+ * dates (and IDs, on the same date). The index must be built.
+ *
+ *    for(p = first_in_date_range(first_day, last_day, &cursor);
+ *       p != NULL; p = next_in_date_range(&cursor))
+ */
+struct transaction *first_in_date_range(int first_day, int last_day,
+   struct date_cursor *cursor);
+struct transaction *next_in_date_range(struct date_cursor *cursor);
+
+/*
+ * Returns TRUE if the index is built, for callers that would rather
+ * read the store than pay for building it
+ */
+BOOL date_index_is_built(void);
+
+void free_date_index(void);
+
+#endif
+
+
+
@@ -0,0 +1,435 @@
+/*
+ *
+ * Name:       date_totals.c
+ *
+ * Purpose:    Contains functions for adding up the credits and debits
+ *             between two dates without walking the store.
+ *
+ *             The totals are kept in a Fenwick tree (a binary indexed
+ *             tree) with a slot for each day. Slot i holds the totals
+ *             of the days from i - (i & -i) + 1 to i, so the totals up
+ *             to any day are the sum of O(log D) slots, and a range is
+ *             the totals up to its last day minus the totals before
+ *             its first. Adding or removing a transaction changes
+ *             O(log D) slots the same way.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <time.h>
+#include "date_totals.h"
+#include "balance.h"
+
+/* The tree has room for at least this many days when it is built */
+#define MIN_DATE_TOTALS_DAYS 1024
+
+/* How many ranges the benchmark asks for each way */
+#define BENCHMARK_SCANS 100
+#define BENCHMARK_QUERIES 1000000L
+
+/* One slot of the tree */
+struct day_totals
+{
+   CENTS credits;
+   CENTS debits;
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+BOOL make_room_for_day(long day);
+void change_date_totals(long day, CENTS credits, CENTS debits);
+void get_totals_through(long day, CENTS *credits, CENTS *debits);
+void scan_date_range_totals(const struct transaction_store *store,
+   long from_day, long to_day, CENTS *credits, CENTS *debits);
+long random_day(long from_day, long to_day);
+
+/*
+ * slots[1] is the first day, first_day, and there are number_of_days
+ * slots after slots[0], which isn't used. number_of_days is always a
+ * power of 2, so the tree can double without being built again.
+ */
+static struct day_totals *slots = NULL;
+static long number_of_days = 0;
+static long first_day = 0;
+static BOOL totals_built = FALSE;
+
+
+
+int build_date_totals(const struct transaction_store *store)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+   long last_day;
+   long i;
+   long j;
+
+   if(totals_built)
+   {
+      return 0;
+   }
+
+   /* Room for every day from the first transaction to the last */
+   p = first_transaction(store, &cursor);
+   first_day = p == NULL ? 0 : p->day;
+   last_day = first_day;
+
+   for( ; p != NULL; p = next_transaction(&cursor))
+   {
+      if(p->day < first_day)
+      {
+         first_day = p->day;
+      }
+
+      if(p->day > last_day)
+      {
+         last_day = p->day;
+      }
+   }
+
+   number_of_days = MIN_DATE_TOTALS_DAYS;
+   while(number_of_days < last_day - first_day + 1)
+   {
+      number_of_days *= 2;
+   }
+
+   slots = calloc((size_t) number_of_days + 1, sizeof(struct day_totals));
+   if(slots == NULL)
+   {
+      number_of_days = 0;
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   /* Each day's own totals first */
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      i = p->day - first_day + 1;
+
+      if(p->type == CREDIT_TYPE)
+      {
+         slots[i].credits += p->amount;
+      }
+      else
+      {
+         slots[i].debits += p->amount;
+      }
+   }
+
+   /*
+    * Then each slot adds its range into the next slot whose range
+    * covers it, which builds the whole tree in O(D)
+    */
+   for(i = 1; i <= number_of_days; i++)
+   {
+      j = i + (i & -i);
+      if(j <= number_of_days)
+      {
+         slots[j].credits += slots[i].credits;
+         slots[j].debits += slots[i].debits;
+      }
+   }
+
+   totals_built = TRUE;
+
+   return 0;
+}
+
+
+
+void add_to_date_totals(const struct transaction *node)
+{
+   if(!totals_built)
+   {
+      return;
+   }
+
+   if(!make_room_for_day(node->day))
+   {
+      free_date_totals();
+      return;
+   }
+
+   if(node->type == CREDIT_TYPE)
+   {
+      change_date_totals(node->day, node->amount, 0);
+   }
+   else
+   {
+      change_date_totals(node->day, 0, node->amount);
+   }
+}
+
+
+
+void remove_from_date_totals(const struct transaction *node)
+{
+   if(!totals_built)
+   {
+      return;
+   }
+
+   if(node->type == CREDIT_TYPE)
+   {
+      change_date_totals(node->day, -node->amount, 0);
+   }
+   else
+   {
+      change_date_totals(node->day, 0, -node->amount);
+   }
+}
+
+
+
+void get_date_range_totals(long from_day, long to_day, CENTS *credits,
+   CENTS *debits)
+{
+   CENTS credits_before;
+   CENTS debits_before;
+
+   get_totals_through(to_day, credits, debits);
+   get_totals_through(from_day - 1, &credits_before, &debits_before);
+
+   *credits -= credits_before;
+   *debits -= debits_before;
+}
+
+
+
+int print_date_totals_benchmark(const struct transaction_store *store)
+{
+   long ranges[BENCHMARK_SCANS][2];
+   CENTS credits;
+   CENTS debits;
+   CENTS scanned[BENCHMARK_SCANS][2];
+   CENTS checksum = 0;
+   char checksum_string[BALANCE_LENGTH];
+   clock_t start;
+   double build_seconds;
+   double scan_seconds;
+   double tree_seconds;
+   long last_day;
+   long from_day;
+   long to_day;
+   long i;
+
+   start = clock();
+   if(build_date_totals(store) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+   build_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   last_day = first_day + number_of_days - 1;
+
+   /* The same random ranges are added up both ways */
+   srand(1);
+   for(i = 0; i < BENCHMARK_SCANS; i++)
+   {
+      from_day = random_day(first_day, last_day);
+      to_day = random_day(first_day, last_day);
+      ranges[i][0] = from_day < to_day ? from_day : to_day;
+      ranges[i][1] = from_day < to_day ? to_day : from_day;
+   }
+
+   start = clock();
+   for(i = 0; i < BENCHMARK_SCANS; i++)
+   {
+      scan_date_range_totals(store, ranges[i][0], ranges[i][1],
+         &scanned[i][0], &scanned[i][1]);
+   }
+   scan_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   for(i = 0; i < BENCHMARK_SCANS; i++)
+   {
+      get_date_range_totals(ranges[i][0], ranges[i][1], &credits, &debits);
+      if(credits != scanned[i][0] || debits != scanned[i][1])
+      {
+         printf("\nThe date totals don't match the budget.\n");
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   start = clock();
+   for(i = 0; i < BENCHMARK_QUERIES; i++)
+   {
+      get_date_range_totals(ranges[i % BENCHMARK_SCANS][0],
+         ranges[i % BENCHMARK_SCANS][1], &credits, &debits);
+      checksum += credits - debits;
+   }
+   tree_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   printf("\nTotals between two dates, %ld transactions over %ld days:\n\n",
+      store->number_of_transactions, number_of_days);
+   printf("   Building the tree: %.3f ms\n", build_seconds * 1000);
+   printf("   Reading the store: %.3f ms per range (%d ranges)\n",
+      scan_seconds * 1000 / BENCHMARK_SCANS, BENCHMARK_SCANS);
+   printf("   Using the tree:    %.3f us per range (%ld ranges)\n",
+      tree_seconds * 1000000 / BENCHMARK_QUERIES, BENCHMARK_QUERIES);
+   cents_to_amount(checksum, checksum_string);
+   printf("   (sum of every balance: %s)\n", checksum_string);
+
+   return 0;
+}
+
+
+
+void free_date_totals(void)
+{
+   free(slots);
+   slots = NULL;
+   number_of_days = 0;
+   first_day = 0;
+   totals_built = FALSE;
+}
+
+
+
+/*
+ *
+ * Doubles the tree until it has room for day. Slots past the old end
+ * hold nothing yet, except the new last slot, which covers every day,
+ * and so has the totals of the old last slot. Returns FALSE if day is
+ * before the first day, or if we run out of memory.
+ *
+ */
+BOOL make_room_for_day(long day)
+{
+   struct day_totals *new_slots;
+   long i;
+
+   if(day < first_day)
+   {
+      return FALSE;
+   }
+
+   while(day - first_day >= number_of_days)
+   {
+      new_slots = realloc(slots,
+         sizeof(struct day_totals) * (size_t) (number_of_days * 2 + 1));
+      if(new_slots == NULL)
+      {
+         return FALSE;
+      }
+
+      slots = new_slots;
+
+      for(i = number_of_days + 1; i < number_of_days * 2; i++)
+      {
+         slots[i].credits = 0;
+         slots[i].debits = 0;
+      }
+
+      slots[number_of_days * 2] = slots[number_of_days];
+      number_of_days *= 2;
+   }
+
+   return TRUE;
+}
+
+
+
+void change_date_totals(long day, CENTS credits, CENTS debits)
+{
+   long i;
+
+   for(i = day - first_day + 1; i <= number_of_days; i += i & -i)
+   {
+      slots[i].credits += credits;
+      slots[i].debits += debits;
+   }
+}
+
+
+
+/*
+ *
+ * The totals of every day up to and including day, which may be
+ * before or after the days the tree has room for
+ *
+ */
+void get_totals_through(long day, CENTS *credits, CENTS *debits)
+{
+   long i = day - first_day + 1;
+
+   *credits = 0;
+   *debits = 0;
+
+   if(i > number_of_days)
+   {
+      i = number_of_days;
+   }
+
+   for( ; i > 0; i -= i & -i)
+   {
+      *credits += slots[i].credits;
+      *debits += slots[i].debits;
+   }
+}
+
+
+
+/*
+ *
+ * Adds up a range by reading every transaction, the way it was done
+ * before the tree, for the benchmark to compare against
+ *
+ */
+void scan_date_range_totals(const struct transaction_store *store,
+   long from_day, long to_day, CENTS *credits, CENTS *debits)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+
+   *credits = 0;
+   *debits = 0;
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      if(p->day >= from_day && p->day <= to_day)
+      {
+         if(p->type == CREDIT_TYPE)
+         {
+            *credits += p->amount;
+         }
+         else
+         {
+            *debits += p->amount;
+         }
+      }
+   }
+}
+
+
+
+/* rand() may only go up to 32767, so two of them make enough days */
+long random_day(long from_day, long to_day)
+{
+   long r = (long) rand() * ((long) RAND_MAX + 1) + rand();
+
+   return from_day + r % (to_day - from_day + 1);
+}
+
+
+
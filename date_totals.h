@@ -0,0 +1,64 @@
+/*
+ *
+ * Name:       date_totals.h
+ *
+ * Purpose:    Contains function prototypes for adding up the credits
+ *             and debits between two dates.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef DATE_TOTALS_H
+#define DATE_TOTALS_H
+#include "transaction_store.h"
+#include "conversions.h"
+#include "read_input.h"
+
+/*
+ * Builds the totals from every transaction in the store, unless they
+ * are already built. Like the date index, they are only built the
+ * first time a range is asked for. Returns FILE_OPS_ERROR if we run
+ * out of memory.
+ */
+int build_date_totals(const struct transaction_store *store);
+
+/*
+ * Keep built totals up to date as transactions are added and removed.
+ * They do nothing before the totals are built. A date before the first
+ * day the totals have room for, or running out of memory, drops them,
+ * to be built again the next time they are needed.
+ */
+void add_to_date_totals(const struct transaction *node);
+void remove_from_date_totals(const struct transaction *node);
+
+/*
+ * Gets the total credits and debits from from_day to to_day, both
+ * included, in O(log D) for D days, without reading the store. The
+ * totals must be built.
+ */
+void get_date_range_totals(long from_day, long to_day, CENTS *credits,
+   CENTS *debits);
+
+/*
+ * Times get_date_range_totals() against adding up each range by
+ * reading the whole store, checks that they agree, and prints both
+ */
+int print_date_totals_benchmark(const struct transaction_store *store);
+
+void free_date_totals(void);
+
+#endif
+
+
+
@@ -0,0 +1,518 @@
+/*
+ *
+ * Name:       delimiter_scan.c
+ *
+ * Purpose:    Contains functions for finding the lines of the budget
+ *             file, and the '|' between their fields, many bytes at
+ *             a time.
+ *
+ *             First a window of the data is marked, with one bit for
+ *             each '|', new line, or null character. On x86 processors
+ *             16 bytes (SSE2) or 32 bytes (AVX2) are compared at once,
+ *             and the matches come back as the bits of a mask. Then the
+ *             lines are read from the marks, jumping from one set bit
+ *             to the next instead of looking at every byte.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The vector versions need GCC or Clang, which can build them for
+ * SSE2 and AVX2 no matter what the rest of the program is built for.
+ *
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_VECTORS
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#include <time.h>
+#include "delimiter_scan.h"
+#include "read_input.h"
+
+/* How many times the benchmark finds the lines of the file each way */
+#define BENCHMARK_PASSES 5
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void mark_delimiters_scalar(const char *data, size_t length,
+   unsigned int *marks);
+BOOL scan_line_memchr(struct delimiter_scan *scan,
+   struct scanned_line *line);
+size_t next_delimiter(struct delimiter_scan *scan);
+int lowest_bit(unsigned int word);
+unsigned long time_scan(const char *data, size_t length, double *seconds);
+
+#ifdef HAVE_X86_VECTORS
+void mark_delimiters_sse2(const char *data, size_t length,
+   unsigned int *marks) __attribute__((target("sse2")));
+void mark_delimiters_avx2(const char *data, size_t length,
+   unsigned int *marks) __attribute__((target("avx2")));
+#endif
+
+/*
+ * Marking the bytes one at a time is slower than finding each new
+ * line with memchr(), so without vector instructions this stays NULL,
+ * and scan_line() uses memchr() instead of marks
+ */
+static void (*mark_delimiters)(const char *data, size_t length,
+   unsigned int *marks) = NULL;
+
+
+
+void choose_delimiter_scanner(void)
+{
+#ifdef HAVE_X86_VECTORS
+   __builtin_cpu_init();
+
+   if(__builtin_cpu_supports("avx2"))
+   {
+      mark_delimiters = mark_delimiters_avx2;
+   }
+   else if(__builtin_cpu_supports("sse2"))
+   {
+      mark_delimiters = mark_delimiters_sse2;
+   }
+#endif
+}
+
+
+
+void start_delimiter_scan(struct delimiter_scan *scan, const char *data,
+   size_t length)
+{
+   scan->data = data;
+   scan->length = length;
+   scan->line_start = 0;
+   scan->window_start = 0;
+   scan->word_index = 0;
+   scan->word = 0;
+
+   if(length > 0 && mark_delimiters != NULL)
+   {
+      mark_delimiters(data, length < SCAN_WINDOW_SIZE
+         ? length : SCAN_WINDOW_SIZE, scan->marks);
+      scan->word = scan->marks[0];
+   }
+}
+
+
+
+/*
+ *
+ * Finds where the next line ends, and the first few '|' in it
+ *
+ * The line isn't changed, so the caller may put a '\0' over the new
+ * line or the '|' afterward. Only bytes we have already marked are
+ * written that way, so the marks stay right.
+ *
+ */
+BOOL scan_line(struct delimiter_scan *scan, struct scanned_line *line)
+{
+   size_t offset;
+
+   if(mark_delimiters == NULL)
+   {
+      return scan_line_memchr(scan, line);
+   }
+
+   if(scan->line_start >= scan->length)
+   {
+      return FALSE;
+   }
+
+   line->start = scan->line_start;
+   line->number_of_delimiters = 0;
+
+   for( ;; )
+   {
+      offset = next_delimiter(scan);
+
+      if(offset >= scan->length)
+      {
+         line->length = scan->length - line->start;
+         line->has_new_line = FALSE;
+         scan->line_start = scan->length;
+         return TRUE;
+      }
+
+      if(scan->data[offset] == '\n')
+      {
+         line->length = offset - line->start;
+         line->has_new_line = TRUE;
+         scan->line_start = offset + 1;
+         return TRUE;
+      }
+
+      if(line->number_of_delimiters < MAX_LINE_DELIMITERS)
+      {
+         line->delimiters[line->number_of_delimiters++] =
+            offset - line->start;
+      }
+   }
+}
+
+
+
+/*
+ *
+ * Finds the same line with memchr(), and then looks at each byte of
+ * it for the '|' and null characters, the way we did before there
+ * were marks
+ *
+ */
+BOOL scan_line_memchr(struct delimiter_scan *scan, struct scanned_line *line)
+{
+   const char *start = scan->data + scan->line_start;
+   const char *end_of_line;
+   size_t i;
+
+   if(scan->line_start >= scan->length)
+   {
+      return FALSE;
+   }
+
+   line->start = scan->line_start;
+   line->number_of_delimiters = 0;
+
+   end_of_line = memchr(start, '\n', scan->length - scan->line_start);
+   line->has_new_line = end_of_line != NULL;
+   line->length = end_of_line != NULL ? (size_t) (end_of_line - start)
+      : scan->length - scan->line_start;
+
+   for(i = 0; i < line->length
+      && line->number_of_delimiters < MAX_LINE_DELIMITERS; i++)
+   {
+      if(start[i] == '|' || start[i] == '\0')
+      {
+         line->delimiters[line->number_of_delimiters++] = i;
+      }
+   }
+
+   scan->line_start += line->length + (line->has_new_line ? 1 : 0);
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Returns the offset of the next marked byte, or the length of the
+ * data if there are no more. The next window is marked when we reach
+ * the end of this one.
+ *
+ */
+size_t next_delimiter(struct delimiter_scan *scan)
+{
+   size_t window_length;
+   int bit;
+
+   while(scan->word == 0)
+   {
+      scan->word_index++;
+
+      if(scan->word_index == SCAN_WINDOW_SIZE / SCAN_WORD_BITS)
+      {
+         if(scan->window_start + SCAN_WINDOW_SIZE >= scan->length)
+         {
+            return scan->length;
+         }
+
+         scan->window_start += SCAN_WINDOW_SIZE;
+         scan->word_index = 0;
+
+         window_length = scan->length - scan->window_start;
+         mark_delimiters(scan->data + scan->window_start,
+            window_length < SCAN_WINDOW_SIZE ? window_length
+               : SCAN_WINDOW_SIZE, scan->marks);
+      }
+      else if(scan->window_start + scan->word_index * SCAN_WORD_BITS
+         >= scan->length)
+      {
+         return scan->length;
+      }
+
+      scan->word = scan->marks[scan->word_index];
+   }
+
+   bit = lowest_bit(scan->word);
+   scan->word &= scan->word - 1;
+
+   return scan->window_start + scan->word_index * SCAN_WORD_BITS + bit;
+}
+
+
+
+int lowest_bit(unsigned int word)
+{
+#ifdef __GNUC__
+   return __builtin_ctz(word);
+#else
+   int bit = 0;
+
+   while(!(word & 1))
+   {
+      word >>= 1;
+      bit++;
+   }
+
+   return bit;
+#endif
+}
+
+
+
+/*
+ *
+ * Marks up to SCAN_WINDOW_SIZE bytes one at a time. The vector
+ * versions use this for the last few bytes, which always start a
+ * new word of marks. On its own, it is slower than memchr(), so
+ * only the benchmark marks a whole file with it.
+ *
+ */
+void mark_delimiters_scalar(const char *data, size_t length,
+   unsigned int *marks)
+{
+   size_t i;
+
+   for(i = 0; i < length; i++)
+   {
+      if(i % SCAN_WORD_BITS == 0)
+      {
+         marks[i / SCAN_WORD_BITS] = 0;
+      }
+
+      if(data[i] == '|' || data[i] == '\n' || data[i] == '\0')
+      {
+         marks[i / SCAN_WORD_BITS] |= 1U << (i % SCAN_WORD_BITS);
+      }
+   }
+}
+
+
+
+#ifdef HAVE_X86_VECTORS
+/*
+ *
+ * Two 16 byte compares make each word of marks
+ *
+ */
+void mark_delimiters_sse2(const char *data, size_t length,
+   unsigned int *marks)
+{
+   const __m128i bars = _mm_set1_epi8('|');
+   const __m128i new_lines = _mm_set1_epi8('\n');
+   const __m128i nulls = _mm_setzero_si128();
+   __m128i low;
+   __m128i high;
+   size_t i;
+
+   for(i = 0; i + 32 <= length; i += 32)
+   {
+      low = _mm_loadu_si128((const __m128i *) (data + i));
+      high = _mm_loadu_si128((const __m128i *) (data + i + 16));
+
+      low = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(low, bars),
+         _mm_cmpeq_epi8(low, new_lines)), _mm_cmpeq_epi8(low, nulls));
+      high = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(high, bars),
+         _mm_cmpeq_epi8(high, new_lines)), _mm_cmpeq_epi8(high, nulls));
+
+      marks[i / SCAN_WORD_BITS] = (unsigned int) _mm_movemask_epi8(low)
+         | (unsigned int) _mm_movemask_epi8(high) << 16;
+   }
+
+   mark_delimiters_scalar(data + i, length - i, marks + i / SCAN_WORD_BITS);
+}
+
+
+
+/*
+ *
+ * One 32 byte compare makes each word of marks
+ *
+ */
+void mark_delimiters_avx2(const char *data, size_t length,
+   unsigned int *marks)
+{
+   const __m256i bars = _mm256_set1_epi8('|');
+   const __m256i new_lines = _mm256_set1_epi8('\n');
+   const __m256i nulls = _mm256_setzero_si256();
+   __m256i bytes;
+   size_t i;
+
+   for(i = 0; i + 32 <= length; i += 32)
+   {
+      bytes = _mm256_loadu_si256((const __m256i *) (data + i));
+      bytes = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, bars),
+         _mm256_cmpeq_epi8(bytes, new_lines)),
+         _mm256_cmpeq_epi8(bytes, nulls));
+
+      marks[i / SCAN_WORD_BITS] = (unsigned int) _mm256_movemask_epi8(bytes);
+   }
+
+   mark_delimiters_scalar(data + i, length - i, marks + i / SCAN_WORD_BITS);
+}
+#endif
+
+
+
+int print_scan_benchmark(const char *file_name)
+{
+   void (*chosen)(const char *data, size_t length, unsigned int *marks) =
+      mark_delimiters;
+   void (*ways[4])(const char *data, size_t length, unsigned int *marks);
+   const char *names[4];
+   unsigned long checksums[4];
+   double seconds[4];
+   int number_of_ways = 0;
+   char *data;
+   long length;
+   FILE *fp;
+   int way;
+
+   fp = fopen(file_name, "rb");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for reading..\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   if(fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) < 0
+      || fseek(fp, 0, SEEK_SET) != 0)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   data = malloc(length > 0 ? length : 1);
+   if(data == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   if(fread(data, 1, length, fp) != (size_t) length)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      free(data);
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   fclose(fp);
+
+   ways[number_of_ways] = NULL;
+   names[number_of_ways++] = "memchr()";
+   ways[number_of_ways] = mark_delimiters_scalar;
+   names[number_of_ways++] = "plain C marks";
+#ifdef HAVE_X86_VECTORS
+   if(__builtin_cpu_supports("sse2"))
+   {
+      ways[number_of_ways] = mark_delimiters_sse2;
+      names[number_of_ways++] = "SSE2 marks";
+   }
+
+   if(__builtin_cpu_supports("avx2"))
+   {
+      ways[number_of_ways] = mark_delimiters_avx2;
+      names[number_of_ways++] = "AVX2 marks";
+   }
+#endif
+
+   for(way = 0; way < number_of_ways; way++)
+   {
+      mark_delimiters = ways[way];
+      checksums[way] = time_scan(data, length, &seconds[way]);
+   }
+
+   mark_delimiters = chosen;
+   free(data);
+
+   for(way = 1; way < number_of_ways; way++)
+   {
+      if(checksums[way] != checksums[0])
+      {
+         printf("\nThe lines found with %s don't match.\n", names[way]);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   printf("\nFinding the lines and fields of %s (%ld bytes),"
+      " %d times each way:\n\n", file_name, length, BENCHMARK_PASSES);
+
+   for(way = 0; way < number_of_ways; way++)
+   {
+      printf("   %-14s %.3f ms per pass%s\n", names[way],
+         seconds[way] * 1000 / BENCHMARK_PASSES,
+         ways[way] == chosen ? " (used)" : "");
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Finds every line and field of the data BENCHMARK_PASSES times, and
+ * returns a sum of where they are, so the ways can be checked against
+ * each other
+ *
+ */
+unsigned long time_scan(const char *data, size_t length, double *seconds)
+{
+   struct delimiter_scan scan;
+   struct scanned_line line;
+   unsigned long checksum = 0;
+   clock_t start = clock();
+   int pass;
+   int i;
+
+   for(pass = 0; pass < BENCHMARK_PASSES; pass++)
+   {
+      checksum = 0;
+      start_delimiter_scan(&scan, data, length);
+
+      while(scan_line(&scan, &line))
+      {
+         checksum += line.start + line.length + line.has_new_line;
+
+         for(i = 0; i < line.number_of_delimiters; i++)
+         {
+            checksum += line.delimiters[i] * (i + 1);
+         }
+      }
+   }
+
+   *seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   return checksum;
+}
+
+
+
@@ -0,0 +1,88 @@
+/*
+ *
+ * Name:       delimiter_scan.h
+ *
+ * Purpose:    Contains function prototypes for finding the lines of
+ *             the budget file, and the '|' between their fields, many
+ *             bytes at a time.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef DELIMITER_SCAN_H
+#define DELIMITER_SCAN_H
+#include <stddef.h>
+#include "boolean.h"
+
+/*
+ * The data is marked SCAN_WINDOW_SIZE bytes at a time, with one bit
+ * for each byte that is a '|', a new line, or a null character.
+ */
+#define SCAN_WINDOW_SIZE 16384
+#define SCAN_WORD_BITS 32
+
+/* A line of the budget file has up to five fields, each ending in '|' */
+#define MAX_LINE_DELIMITERS 5
+
+struct delimiter_scan
+{
+   const char *data;
+   size_t length;
+   size_t line_start;
+
+   /* The marks for data[window_start] on, and the word we are in */
+   size_t window_start;
+   size_t word_index;
+   unsigned int word;
+   unsigned int marks[SCAN_WINDOW_SIZE / SCAN_WORD_BITS];
+};
+
+/*
+ * One line found by scan_line(). Offsets are from the start of the
+ * line. delimiters holds the first '|' or null characters in it.
+ * A line without a new line ran into the end of the data.
+ */
+struct scanned_line
+{
+   size_t start;
+   size_t length;
+   BOOL has_new_line;
+   size_t delimiters[MAX_LINE_DELIMITERS];
+   int number_of_delimiters;
+};
+
+/*
+ * Picks the fastest way to mark delimiters that this processor
+ * supports. Until this is called, or if it has no vector instructions
+ * we can use, each line is found with memchr() instead.
+ */
+void choose_delimiter_scanner(void);
+
+void start_delimiter_scan(struct delimiter_scan *scan, const char *data,
+   size_t length);
+
+/* Returns FALSE once there are no more lines */
+BOOL scan_line(struct delimiter_scan *scan, struct scanned_line *line);
+
+/*
+ * Times finding every line and field of the file with memchr(), with
+ * plain C marks, and with each kind of vector marks this processor
+ * has, checks that they agree, and prints the times
+ */
+int print_scan_benchmark(const char *file_name);
+
+#endif
+
+
+
@@ -0,0 +1,529 @@
+/*
+ *
+ * Name:       description_pool.c
+ *
+ * Purpose:    Contains functions for keeping one shared copy of each
+ *             different description.
+ *
+ *             A budget uses the same few descriptions over and over,
+ *             like "Groceries" or "Gas", so each node just points at
+ *             the pool's copy. The copies are packed into big blocks
+ *             instead of being allocated one at a time, and are found
+ *             again through a hash table.
+ *
+ *             The parallel loader adds descriptions from several
+ *             threads, so the pool is guarded by a mutex where we
+ *             have POSIX threads.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The POSIX headers need this before any other #include.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_PTHREADS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "description_pool.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * One slot of the hash table. An empty slot has no text. references
+ * counts the transactions that have the description, and borrowed is
+ * TRUE if the text isn't in one of our blocks.
+ */
+struct description_slot
+{
+   const char *text;
+   unsigned long hash;
+   long references;
+   BOOL borrowed;
+};
+
+/* A block of copies, with the text right after the header */
+struct description_block
+{
+   struct description_block *next;
+   size_t size;
+   size_t used;
+   char text[1];
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+unsigned long hash_description(const char *description);
+struct description_slot *find_description_slot(const char *description,
+   unsigned long hash);
+BOOL grow_description_slots(void);
+void empty_description_slot(struct description_slot *slot);
+const char *copy_description(const char *description);
+void free_description_blocks(struct description_block *first);
+
+/*
+ * The hash table, and the blocks of copies, newest first. Copies go
+ * into the newest block. Blocks that are full are never looked at
+ * again, but the nodes still point into them, so they are only freed
+ * when the pool is repacked, or by free_description_pool().
+ */
+static struct description_slot *slots = NULL;
+static unsigned long number_of_slots = 0;
+static unsigned long number_of_descriptions = 0;
+
+static struct description_block *blocks = NULL;
+
+/*
+ * How many bytes of the blocks hold copies, and how many of those
+ * are copies no transaction has anymore. While the pool is repacked,
+ * old_blocks holds the blocks the nodes still point into.
+ */
+static unsigned long copied_bytes = 0;
+static unsigned long unused_bytes = 0;
+static struct description_block *old_blocks = NULL;
+
+/* What the pool has done, for get_description_pool_statistics() */
+static long system_allocations = 0;
+static unsigned long pool_bytes = 0;
+
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+
+const char *intern_description(const char *description, BOOL borrow)
+{
+   struct description_slot *slot;
+   const char *text = NULL;
+   unsigned long hash;
+
+   /* Hash before taking the lock, so threads only wait on the lookup */
+   hash = hash_description(description);
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   if(number_of_slots == 0 || number_of_descriptions >= number_of_slots / 2)
+   {
+      if(!grow_description_slots())
+      {
+#ifdef HAVE_PTHREADS
+         pthread_mutex_unlock(&pool_mutex);
+#endif
+         return NULL;
+      }
+   }
+
+   slot = find_description_slot(description, hash);
+
+   if(slot->text != NULL)
+   {
+      text = slot->text;
+      slot->references++;
+   }
+   else
+   {
+      text = borrow ? description : copy_description(description);
+
+      if(text != NULL)
+      {
+         slot->text = text;
+         slot->hash = hash;
+         slot->references = 1;
+         slot->borrowed = borrow;
+         number_of_descriptions++;
+      }
+   }
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+
+   return text;
+}
+
+
+
+void release_description(const char *description)
+{
+   struct description_slot *slot;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   if(number_of_slots > 0)
+   {
+      slot = find_description_slot(description,
+         hash_description(description));
+
+      if(slot->text != NULL && --slot->references == 0)
+      {
+         if(!slot->borrowed)
+         {
+            unused_bytes += strlen(slot->text) + 1;
+         }
+
+         empty_description_slot(slot);
+      }
+   }
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+}
+
+
+
+BOOL description_pool_is_wasteful(void)
+{
+   return unused_bytes >= MIN_DESCRIPTION_BLOCK_SIZE
+      && unused_bytes * 2 >= copied_bytes;
+}
+
+
+
+/*
+ *
+ * Copies every description that is still in use into one new block,
+ * sized to fit them exactly. The old blocks are kept until
+ * finish_description_repack(), since the nodes still point into them.
+ *
+ */
+BOOL start_description_repack(void)
+{
+   struct description_block *block;
+   size_t size = copied_bytes - unused_bytes;
+   unsigned long i;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   block = malloc(sizeof(struct description_block) + size - 1);
+   if(block == NULL)
+   {
+#ifdef HAVE_PTHREADS
+      pthread_mutex_unlock(&pool_mutex);
+#endif
+      return FALSE;
+   }
+
+   system_allocations++;
+   pool_bytes += sizeof(struct description_block) + size - 1;
+
+   block->next = NULL;
+   block->size = size;
+   block->used = 0;
+
+   old_blocks = blocks;
+   blocks = block;
+   copied_bytes = 0;
+   unused_bytes = 0;
+
+   /* Everything fits in the new block, so copying can't fail */
+   for(i = 0; i < number_of_slots; i++)
+   {
+      if(slots[i].text != NULL && !slots[i].borrowed)
+      {
+         slots[i].text = copy_description(slots[i].text);
+      }
+   }
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+
+   return TRUE;
+}
+
+
+
+const char *repacked_description(const char *description)
+{
+   const char *text;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   text = find_description_slot(description,
+      hash_description(description))->text;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+
+   return text;
+}
+
+
+
+void finish_description_repack(void)
+{
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   free_description_blocks(old_blocks);
+   old_blocks = NULL;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+}
+
+
+
+/*
+ *
+ * FNV-1a, which is short and spreads out descriptions
+ * that only differ in their last few characters
+ *
+ */
+unsigned long hash_description(const char *description)
+{
+   const unsigned char *p = (const unsigned char *) description;
+   unsigned long hash = 2166136261UL;
+
+   while(*p)
+   {
+      hash ^= *p++;
+      hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+   }
+
+   return hash;
+}
+
+
+
+/*
+ *
+ * Returns the slot holding description, or the empty slot
+ * it belongs in. There is always at least one empty slot.
+ *
+ */
+struct description_slot *find_description_slot(const char *description,
+   unsigned long hash)
+{
+   unsigned long i = hash & (number_of_slots - 1);
+
+   while(slots[i].text != NULL)
+   {
+      if(slots[i].hash == hash && strcmp(slots[i].text, description) == 0)
+      {
+         break;
+      }
+
+      i = (i + 1) & (number_of_slots - 1);
+   }
+
+   return &slots[i];
+}
+
+
+
+/*
+ *
+ * Empties a slot, then moves back any description after it that
+ * can't be found past the gap anymore, like unindex_transaction()
+ *
+ */
+void empty_description_slot(struct description_slot *slot)
+{
+   unsigned long i = (unsigned long) (slot - slots);
+   unsigned long j;
+   unsigned long home;
+
+   slots[i].text = NULL;
+   number_of_descriptions--;
+
+   for(j = (i + 1) & (number_of_slots - 1); slots[j].text != NULL;
+      j = (j + 1) & (number_of_slots - 1))
+   {
+      home = slots[j].hash & (number_of_slots - 1);
+
+      /* Move it back unless its home slot is after the hole */
+      if((j > i && (home <= i || home > j))
+         || (j < i && home <= i && home > j))
+      {
+         slots[i] = slots[j];
+         slots[j].text = NULL;
+         i = j;
+      }
+   }
+}
+
+
+
+/*
+ *
+ * Doubles the hash table and puts every description back in it.
+ * The hashes are kept, so nothing has to be hashed again.
+ *
+ */
+BOOL grow_description_slots(void)
+{
+   struct description_slot *old_slots = slots;
+   unsigned long old_number_of_slots = number_of_slots;
+   unsigned long i;
+   unsigned long j;
+
+   number_of_slots = number_of_slots == 0 ? MIN_DESCRIPTION_SLOTS
+      : number_of_slots * 2;
+
+   slots = calloc(number_of_slots, sizeof(struct description_slot));
+   if(slots == NULL)
+   {
+      slots = old_slots;
+      number_of_slots = old_number_of_slots;
+      return FALSE;
+   }
+
+   system_allocations++;
+   pool_bytes += (number_of_slots - old_number_of_slots)
+      * sizeof(struct description_slot);
+
+   for(i = 0; i < old_number_of_slots; i++)
+   {
+      if(old_slots[i].text == NULL)
+      {
+         continue;
+      }
+
+      j = old_slots[i].hash & (number_of_slots - 1);
+      while(slots[j].text != NULL)
+      {
+         j = (j + 1) & (number_of_slots - 1);
+      }
+
+      slots[j] = old_slots[i];
+   }
+
+   free(old_slots);
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Copies a description to the end of the newest block, starting
+ * a new block when it doesn't fit
+ *
+ */
+const char *copy_description(const char *description)
+{
+   struct description_block *block;
+   size_t length = strlen(description) + 1;
+   size_t size = MIN_DESCRIPTION_BLOCK_SIZE;
+   char *copy;
+
+   if(blocks == NULL || blocks->size - blocks->used < length)
+   {
+      if(blocks != NULL && blocks->size < MAX_DESCRIPTION_BLOCK_SIZE)
+      {
+         size = blocks->size * 2;
+      }
+      else if(blocks != NULL)
+      {
+         size = MAX_DESCRIPTION_BLOCK_SIZE;
+      }
+
+      if(size < length)
+      {
+         size = length;
+      }
+
+      block = malloc(sizeof(struct description_block) + size - 1);
+      if(block == NULL)
+      {
+         return NULL;
+      }
+
+      block->next = blocks;
+      block->size = size;
+      block->used = 0;
+      blocks = block;
+
+      system_allocations++;
+      pool_bytes += sizeof(struct description_block) + size - 1;
+   }
+
+   copy = blocks->text + blocks->used;
+   memcpy(copy, description, length);
+   blocks->used += length;
+   copied_bytes += length;
+
+   return copy;
+}
+
+
+
+void free_description_blocks(struct description_block *first)
+{
+   struct description_block *next;
+
+   while(first != NULL)
+   {
+      next = first->next;
+      pool_bytes -= sizeof(struct description_block) + first->size - 1;
+      free(first);
+      first = next;
+   }
+}
+
+
+
+void free_description_pool(void)
+{
+   free_description_blocks(blocks);
+   blocks = NULL;
+
+   free(slots);
+   slots = NULL;
+   number_of_slots = 0;
+   number_of_descriptions = 0;
+   copied_bytes = 0;
+   unused_bytes = 0;
+}
+
+
+
+void get_description_pool_statistics(long *allocations, long *descriptions,
+   unsigned long *bytes)
+{
+   *allocations = system_allocations;
+   *descriptions = (long) number_of_descriptions;
+   *bytes = pool_bytes;
+}
+
+
+
@@ -0,0 +1,77 @@
+/*
+ *
+ * Name:       description_pool.h
+ *
+ * Purpose:    Contains function prototypes for keeping one shared
+ *             copy of each different description.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef DESCRIPTION_POOL_H
+#define DESCRIPTION_POOL_H
+#include "boolean.h"
+
+/*
+ * The copies are packed into blocks. Each block is twice the size of
+ * the last, from MIN_DESCRIPTION_BLOCK_SIZE up to the maximum.
+ */
+#define MIN_DESCRIPTION_BLOCK_SIZE 65536
+#define MAX_DESCRIPTION_BLOCK_SIZE 16777216
+
+/* The hash table starts with this many slots, and doubles when half full */
+#define MIN_DESCRIPTION_SLOTS 1024
+
+/*
+ * Returns the pool's copy of description, adding it if it isn't there,
+ * and counts one more reference to it. Equal descriptions always come
+ * back as the same pointer. Returns NULL if we run out of memory.
+ *
+ * If borrow is TRUE and the description is new, the pool keeps the
+ * pointer we were given instead of copying it, so the string must
+ * never change or go away.
+ */
+const char *intern_description(const char *description, BOOL borrow);
+
+/*
+ * Counts one less reference to a description from intern_description().
+ * Once nothing refers to it, it is taken out of the hash table, but its
+ * bytes are only given back when the pool is repacked.
+ */
+void release_description(const char *description);
+
+/* TRUE once at least half the copied bytes are no longer referred to */
+BOOL description_pool_is_wasteful(void);
+
+/*
+ * Repacking moves every description still in use into a new block.
+ * After start_description_repack() returns TRUE, every node must be
+ * pointed at repacked_description() of its description before
+ * finish_description_repack() frees the old blocks. If it returns
+ * FALSE, we ran out of memory and nothing has changed.
+ */
+BOOL start_description_repack(void);
+const char *repacked_description(const char *description);
+void finish_description_repack(void);
+
+/* Frees every copy at once. No description may be used after this. */
+void free_description_pool(void);
+
+void get_description_pool_statistics(long *system_allocations,
+   long *descriptions, unsigned long *bytes);
+
+#endif
+
+
+
@@ -0,0 +1,1604 @@
+/*
+ *
+ * Name:       file_operations.c
+ *
+ * Purpose:    Contains functions for loading the store of transactions
+ *             from the budget file and the journal, and for saving
+ *             changes to them.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * On Unix we map files with mmap, which needs the POSIX
+ * headers. This has to come before any other #include.
+ *
+ * HAVE_POSIX_FILES means rename() replaces a file in one step and
+ * fsync() puts it on the disk. On Windows, MoveFileEx() and _commit()
+ * do the same. windows.h comes before our headers, because it has its
+ * own BOOL.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_MMAP
+#define HAVE_POSIX_FILES
+#elif defined(_WIN32)
+#define HAVE_WIN32_FILES
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#endif
+
+#include "file_operations.h"
+#include "binary_format.h"
+#include "background_save.h"
+#include "shard_storage.h"
+#include "parallel_load.h"
+#include "delimiter_scan.h"
+#include "transaction_index.h"
+#include "rollups.h"
+#include "boolean.h"
+#include "read_input.h"
+#include <time.h>
+
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+ * A line holds a date, amount, type, and description, then the
+ * transaction's ID. Files saved before there were IDs don't have it.
+ */
+#define NUM_TRANSACTION_FIELDS 4
+#define ID_FIELD 4
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+int split_transaction_line(char *line, char **fields);
+int split_scanned_line(char *line, const struct scanned_line *scanned,
+   char **fields);
+int read_transaction_id(const char *id_string);
+int add_transaction_line(char *line, const struct scanned_line *scanned,
+   long line_number, const char *file_name, BOOL borrow,
+   struct transaction_store *budget);
+int append_journal_entry(char operation, int id,
+   const struct transaction *node);
+int write_change(struct transaction_store *budget, char operation, int id,
+   const struct transaction *node);
+char *append_field(char *p, const char *field);
+int write_transaction_lines(const char *file_name,
+   const struct transaction_store *budget, struct transaction **nodes,
+   long count);
+BOOL sync_directory(void);
+long current_milliseconds(void);
+
+/*
+ * The journal stays open for appending once the first entry is written.
+ * journal_has_entries tells us whether budget.txt is behind the journal
+ * and needs to be rewritten when we quit.
+ */
+static BOOL journal_mode = FALSE;
+static BOOL journal_has_entries = FALSE;
+static FILE *journal_fp = NULL;
+
+/* budget.txt, or budget.bin in binary mode */
+static BOOL binary_mode = FALSE;
+static const char *budget_file_name = FILE_NAME;
+
+/*
+ * In zero-copy mode, budget.txt stays mapped for as long as the
+ * program runs, since the nodes point into it.
+ */
+static BOOL zero_copy_mode = FALSE;
+static struct mapped_file budget_file;
+
+/* How many threads parse budget.txt */
+static int load_threads = 1;
+
+/* TRUE if budget.txt has rows that were given IDs when it was loaded */
+static BOOL ids_given = FALSE;
+
+/*
+ * When journal entries are forced out to the disk. unsynced_entries
+ * counts the entries written since the last time.
+ */
+static int sync_policy = SYNC_EVERY_CHANGE;
+static long sync_setting = 0;
+static long unsynced_entries = 0;
+static long last_sync_milliseconds = 0;
+
+
+
+/*
+ *
+ * Reads the budget file into a store of transactions
+ *
+ * The file is read in blocks of LOAD_BLOCK_SIZE bytes, and every
+ * complete line in the block is turned into a transaction. A partial line
+ * at the end of a block is moved to the front of the buffer so the
+ * next block finishes it. There is no limit on the number of
+ * transactions other than available memory.
+ *
+ * We never load part of a file. If any line is too long or malformed,
+ * we stop and return FILE_OPS_ERROR, because the Create(), Update(),
+ * and Delete() functions rewrite the file from the store, and I don't
+ * want the user to lose the data we couldn't read.
+ *
+ */
+int load_transactions(const char *file_name,
+   struct transaction_store *budget)
+{
+   FILE *fp;
+   char *buffer;
+   char *line;
+   char *end_of_data;
+
+   struct delimiter_scan scan;
+   struct scanned_line scanned;
+
+   size_t leftover = 0;
+   size_t bytes_read;
+   long line_number = 0;
+   int number_of_transactions = 0;
+   int result;
+
+   BOOL end_of_file = FALSE;
+   BOOL load_error = FALSE;
+
+   init_store(budget);
+
+   fp = fopen(file_name, "r");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Please ensure %s exists, and try again.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   /* Room for one block, plus the partial line carried over from the
+    * previous block, plus a new line we may add after the last line */
+   buffer = malloc(LOAD_BLOCK_SIZE + MAX_TRANSACTION_LENGTH + 1);
+   if(buffer == NULL)
+   {
+      fclose(fp);
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   while(!end_of_file && !load_error)
+   {
+      bytes_read = fread(buffer + leftover, 1, LOAD_BLOCK_SIZE, fp);
+
+      if(bytes_read < LOAD_BLOCK_SIZE)
+      {
+         if(ferror(fp))
+         {
+            printf("\nFile error.\n\n");
+            printf("Could not read %s.\n", file_name);
+            load_error = TRUE;
+            break;
+         }
+
+         end_of_file = TRUE;
+      }
+
+      end_of_data = buffer + leftover + bytes_read;
+
+      /* The last line of the file may not end with a new line */
+      if(end_of_file && end_of_data > buffer && *(end_of_data - 1) != '\n')
+      {
+         *end_of_data++ = '\n';
+      }
+
+      line = end_of_data;
+      start_delimiter_scan(&scan, buffer, end_of_data - buffer);
+
+      while(!load_error && scan_line(&scan, &scanned))
+      {
+         line = buffer + scanned.start;
+
+         /* The rest of a line without a new line is in the next block */
+         if(!scanned.has_new_line)
+         {
+            break;
+         }
+
+         line[scanned.length] = '\0';
+         line_number++;
+
+         result = add_transaction_line(line, &scanned, line_number,
+            file_name, FALSE, budget);
+
+         if(result == FILE_OPS_ERROR)
+         {
+            load_error = TRUE;
+         }
+         else
+         {
+            number_of_transactions += result;
+         }
+
+         line = end_of_data;
+      }
+
+      /* Carry the partial line over to the front of the buffer */
+      leftover = end_of_data - line;
+      if(!load_error && leftover > MAX_TRANSACTION_LENGTH)
+      {
+         printf("\nLine %ld of %s is too long to read.\n",
+            line_number + 1, file_name);
+         load_error = TRUE;
+      }
+
+      memmove(buffer, line, leftover);
+   }
+
+   free(buffer);
+   fclose(fp);
+
+   if(load_error)
+   {
+      printf("\nThe program will exit so no data is lost.\n\n");
+      free_store(budget);
+      return FILE_OPS_ERROR;
+   }
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Reads budget.txt into a store of transactions without copying it
+ *
+ * The file is mapped into memory once, and the description pool
+ * keeps each new description right in the mapping instead of copying
+ * it. The '|' and new line after each field are overwritten with '\0'.
+ * The mapping is private, so those changes never reach the file.
+ *
+ */
+int load_mapped_transactions(const char *file_name,
+   struct transaction_store *budget)
+{
+   char *line;
+   char last_line[MAX_TRANSACTION_LENGTH + 1];
+   long line_number = 0;
+   int number_of_transactions = 0;
+   int result = 0;
+
+   struct delimiter_scan scan;
+   struct scanned_line scanned;
+
+   init_store(budget);
+
+   if(map_file(file_name, &budget_file) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   start_delimiter_scan(&scan, budget_file.data, budget_file.size);
+
+   while(result != FILE_OPS_ERROR && scan_line(&scan, &scanned))
+   {
+      line_number++;
+      line = budget_file.data + scanned.start;
+
+      if(scanned.has_new_line)
+      {
+         line[scanned.length] = '\0';
+         result = add_transaction_line(line, &scanned, line_number,
+            file_name, TRUE, budget);
+      }
+      else
+      {
+         /* The last line has no new line to overwrite, and we can't
+          * write past the end of the mapping, so copy that one line */
+         if(scanned.length > MAX_TRANSACTION_LENGTH)
+         {
+            printf("\nLine %ld of %s is too long to read.\n", line_number,
+               file_name);
+            result = FILE_OPS_ERROR;
+            break;
+         }
+
+         memcpy(last_line, line, scanned.length);
+         last_line[scanned.length] = '\0';
+         result = add_transaction_line(last_line, &scanned, line_number,
+            file_name, FALSE, budget);
+      }
+
+      number_of_transactions += result;
+   }
+
+   if(result == FILE_OPS_ERROR)
+   {
+      printf("\nThe program will exit so no data is lost.\n\n");
+      free_store(budget);
+      unmap_file(&budget_file);
+      return FILE_OPS_ERROR;
+   }
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Turns one line of the budget file into a transaction at the end
+ * of the store
+ *
+ * A borrowed description points into the line itself, so the line has
+ * to outlive it. Returns 1 if a transaction was added, 0 for a blank
+ * line, or FILE_OPS_ERROR.
+ *
+ */
+int add_transaction_line(char *line, const struct scanned_line *scanned,
+   long line_number, const char *file_name, BOOL borrow,
+   struct transaction_store *budget)
+{
+   int status;
+
+   status = parse_transaction_line(line, scanned, borrow, budget);
+
+   if(status == LINE_BLANK)
+   {
+      return 0;
+   }
+
+   if(status != LINE_ADDED)
+   {
+      report_line_error(status, line_number, file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   return 1;
+}
+
+
+
+/*
+ *
+ * Turns one line of the budget file into a transaction at the end of
+ * the store, without printing anything, so the parallel loader can
+ * use it too. Returns one of the LINE_ codes.
+ *
+ */
+int parse_transaction_line(char *line, const struct scanned_line *scanned,
+   BOOL borrow, struct transaction_store *budget)
+{
+   char *fields[NUM_TRANSACTION_FIELDS + 1];
+   long day;
+   CENTS cents;
+   int type;
+   int number_of_fields;
+   int id = NO_TRANSACTION_ID;
+
+   struct transaction *node;
+
+   if(scanned->length > MAX_TRANSACTION_LENGTH)
+   {
+      return LINE_TOO_LONG;
+   }
+
+   /* Blank lines don't hold a transaction, so they are skipped */
+   if(*line == '\0')
+   {
+      return LINE_BLANK;
+   }
+
+   number_of_fields = split_scanned_line(line, scanned, fields);
+
+   if(number_of_fields > NUM_TRANSACTION_FIELDS)
+   {
+      id = read_transaction_id(fields[ID_FIELD]);
+   }
+
+   if(number_of_fields == 0 || id < 0
+      || !fields_to_values(fields[0], fields[1], fields[2], &day, &cents,
+         &type))
+   {
+      return LINE_INVALID;
+   }
+
+   if(borrow)
+   {
+      node = new_borrowed_transaction(budget, day, cents, type, fields[3]);
+   }
+   else
+   {
+      node = new_transaction(budget, day, cents, type, fields[3]);
+   }
+
+   if(node == NULL)
+   {
+      return LINE_NO_MEMORY;
+   }
+
+   node->id = id;
+
+   return LINE_ADDED;
+}
+
+
+
+void report_line_error(int status, long line_number, const char *file_name)
+{
+   if(status == LINE_TOO_LONG)
+   {
+      printf("\nLine %ld of %s is too long to read.\n", line_number,
+         file_name);
+   }
+   else if(status == LINE_INVALID)
+   {
+      printf("\nLine %ld of %s is not a valid transaction.\n", line_number,
+         file_name);
+   }
+   else
+   {
+      printf("\nMemory allocation error.\n");
+   }
+}
+
+
+
+/*
+ *
+ * Splits one line of the budget file into its date, amount,
+ * type, description, and ID, in place
+ *
+ */
+int split_transaction_line(char *line, char **fields)
+{
+   struct delimiter_scan scan;
+   struct scanned_line scanned;
+
+   start_delimiter_scan(&scan, line, strlen(line));
+
+   return scan_line(&scan, &scanned)
+      ? split_scanned_line(line, &scanned, fields) : 0;
+}
+
+
+
+/*
+ *
+ * Splits a line at the '|' that scan_line() found in it, and returns
+ * the number of fields, or 0 if the line is not valid
+ *
+ * Each field must end with a '|' and fit in the buffers we use
+ * when the user edits it. The ID is only there if a fifth '|' is.
+ *
+ */
+int split_scanned_line(char *line, const struct scanned_line *scanned,
+   char **fields)
+{
+   const int field_lengths[NUM_TRANSACTION_FIELDS + 1] =
+      {DATE_LENGTH, AMOUNT_LENGTH, TYPE_LENGTH, DESCRIPTION_LENGTH,
+         ID_INPUT_LENGTH};
+   char *p = line;
+   int number_of_fields = NUM_TRANSACTION_FIELDS;
+   int i;
+
+   if(scanned->number_of_delimiters < NUM_TRANSACTION_FIELDS)
+   {
+      return 0;
+   }
+
+   if(scanned->number_of_delimiters > NUM_TRANSACTION_FIELDS)
+   {
+      number_of_fields = NUM_TRANSACTION_FIELDS + 1;
+   }
+
+   for(i = 0; i < number_of_fields; i++)
+   {
+      fields[i] = p;
+      p = line + scanned->delimiters[i];
+
+      /* A null character in the line ends it early */
+      if(*p != '|' || p - fields[i] > field_lengths[i])
+      {
+         return 0;
+      }
+
+      *p++ = '\0';
+   }
+
+   return number_of_fields;
+}
+
+
+
+/*
+ *
+ * Returns the ID in an ID field, or -1 if it isn't a number
+ * from 1 to MAX_TRANSACTION_ID
+ *
+ */
+int read_transaction_id(const char *id_string)
+{
+   const char *p = id_string;
+   long id = 0;
+
+   while(*p >= '0' && *p <= '9')
+   {
+      id = id * 10 + (*p++ - '0');
+   }
+
+   if(p == id_string || *p != '\0' || id < 1 || id > MAX_TRANSACTION_ID)
+   {
+      return -1;
+   }
+
+   return (int) id;
+}
+
+
+
+/*
+ *
+ * Loads budget.txt and then replays the journal on top of it
+ *
+ * If a checkpoint file is left over from a save that was cut short,
+ * we look at the journal to decide what to do with it. While the
+ * journal exists, the checkpoint may be incomplete, so we throw it
+ * away and replay the journal. Once the journal is gone, the
+ * checkpoint was finished, and it just needs to become budget.txt.
+ *
+ */
+int load_budget(struct transaction_store *budget)
+{
+   int number_of_transactions;
+   int result;
+   BOOL rollups_read;
+
+   if(sharded_mode_enabled())
+   {
+      return load_sharded_budget(budget);
+   }
+
+   if(!file_exists(budget_file_name) && file_exists(SHARD_INDEX_FILE_NAME))
+   {
+      printf("\nYour budget is saved by month in %s.\n\n",
+         SHARD_INDEX_FILE_NAME);
+      printf("Please run the program with -s or --sharded.\n\n");
+      return FILE_OPS_ERROR;
+   }
+
+   if(file_exists(CHECKPOINT_FILE_NAME))
+   {
+      if(file_exists(JOURNAL_FILE_NAME))
+      {
+         remove(CHECKPOINT_FILE_NAME);
+      }
+      else if(replace_file(CHECKPOINT_FILE_NAME, budget_file_name)
+         == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   if(binary_mode)
+   {
+      number_of_transactions = load_binary_transactions(budget_file_name,
+         budget);
+   }
+   else if(load_threads > 1)
+   {
+      number_of_transactions = load_transactions_in_parallel(budget_file_name,
+         &budget_file, zero_copy_mode, load_threads, budget);
+   }
+   else if(zero_copy_mode)
+   {
+      number_of_transactions = load_mapped_transactions(budget_file_name,
+         budget);
+   }
+   else
+   {
+      number_of_transactions = load_transactions(budget_file_name,
+         budget);
+   }
+   if(number_of_transactions == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   /*
+    * If the saved totals were added up from this same budget file,
+    * they already count every transaction in it. If not, they are
+    * added up all at once, on every processor, instead of one
+    * transaction at a time as each is indexed.
+    */
+   rollups_read = read_rollups(budget_file_name);
+   pause_rollups(TRUE);
+   result = index_transactions(budget, budget_file_name);
+   pause_rollups(FALSE);
+   if(result == FILE_OPS_ERROR)
+   {
+      free_store(budget);
+      return FILE_OPS_ERROR;
+   }
+
+   if(!rollups_read)
+   {
+      add_up_rollups(budget);
+   }
+
+   ids_given = result > 0;
+
+   if(file_exists(JOURNAL_FILE_NAME))
+   {
+      if(replay_journal(JOURNAL_FILE_NAME, budget,
+         &number_of_transactions) == FILE_OPS_ERROR)
+      {
+         free_store(budget);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Applies each journal entry to the store, in the order
+ * they were written
+ *
+ * Entries look like a line of budget.txt with the operation
+ * (and the ID for updates and deletes) in front:
+ *
+ *    C|date|amount|type|description|id|
+ *    U|id|date|amount|type|description|
+ *    D|id|
+ *
+ * A last entry without a new line was cut off while it was being
+ * written, so it is dropped, and budget.txt is rewritten right away
+ * so the next entry doesn't land on the end of it.
+ *
+ */
+int replay_journal(const char *file_name, struct transaction_store *budget,
+   int *number_of_transactions)
+{
+   FILE *fp;
+   char entry[MAX_JOURNAL_ENTRY_LENGTH + 2];
+   char *fields[NUM_TRANSACTION_FIELDS + 1];
+   char *p;
+   char *end_of_id;
+   int number_of_fields = 0;
+   char operation;
+   long line_number = 0;
+   long id = 0;
+   long day;
+   CENTS cents;
+   int type;
+
+   struct transaction *node;
+
+   BOOL valid_entry;
+   BOOL torn_entry = FALSE;
+
+   fp = fopen(file_name, "r");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for reading.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   while(fgets(entry, MAX_JOURNAL_ENTRY_LENGTH + 2, fp) != NULL)
+   {
+      line_number++;
+
+      p = strchr(entry, '\n');
+      if(p == NULL)
+      {
+         if(feof(fp))
+         {
+            torn_entry = TRUE;
+            break;
+         }
+
+         printf("\nLine %ld of %s is too long to read.\n", line_number,
+            file_name);
+         fclose(fp);
+         return FILE_OPS_ERROR;
+      }
+
+      *p = '\0';
+      operation = *entry;
+      valid_entry = operation != '\0' && *(entry + 1) == '|';
+      p = entry + 2;
+
+      /* Updates and deletes name the transaction they change */
+      if(valid_entry && (operation == 'U' || operation == 'D'))
+      {
+         id = strtol(p, &end_of_id, 10);
+         valid_entry = end_of_id != p && *end_of_id == '|'
+            && id >= 1 && id <= MAX_TRANSACTION_ID
+            && find_transaction((int) id) != NULL;
+         p = end_of_id + 1;
+      }
+
+      /* Creates and updates carry a whole transaction */
+      if(valid_entry && (operation == 'C' || operation == 'U'))
+      {
+         number_of_fields = split_transaction_line(p, fields);
+         valid_entry = number_of_fields != 0
+            && fields_to_values(fields[0], fields[1], fields[2], &day,
+               &cents, &type);
+      }
+
+      /* Only creates save the new transaction's ID */
+      if(valid_entry && operation == 'C')
+      {
+         id = number_of_fields > NUM_TRANSACTION_FIELDS
+            ? read_transaction_id(fields[ID_FIELD]) : NO_TRANSACTION_ID;
+         valid_entry = id >= 0;
+      }
+      else if(valid_entry && operation == 'U')
+      {
+         valid_entry = number_of_fields == NUM_TRANSACTION_FIELDS;
+      }
+
+      if(valid_entry && operation == 'C')
+      {
+         node = new_transaction(budget, day, cents, type, fields[3]);
+         if(node == NULL)
+         {
+            printf("\nMemory allocation error.\n");
+            fclose(fp);
+            return FILE_OPS_ERROR;
+         }
+
+         node->id = (int) id;
+         if(!index_transaction(node))
+         {
+            printf("\nTransaction ID %ld is used more than once in %s.\n",
+               id, file_name);
+            printf("\nThe program will exit so no data is lost.\n\n");
+            fclose(fp);
+            return FILE_OPS_ERROR;
+         }
+
+         (*number_of_transactions)++;
+      }
+      else if(valid_entry && operation == 'U')
+      {
+         node = find_transaction((int) id);
+         if(!set_transaction(node, day, cents, type, fields[3]))
+         {
+            printf("\nMemory allocation error.\n");
+            fclose(fp);
+            return FILE_OPS_ERROR;
+         }
+      }
+      else if(valid_entry && operation == 'D')
+      {
+         node = find_transaction((int) id);
+         remove_transaction(budget, node);
+         (*number_of_transactions)--;
+      }
+      else
+      {
+         valid_entry = FALSE;
+      }
+
+      if(!valid_entry)
+      {
+         printf("\nLine %ld of %s is not a valid journal entry.\n",
+            line_number, file_name);
+         printf("\nThe program will exit so no data is lost.\n\n");
+         fclose(fp);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   if(ferror(fp))
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   fclose(fp);
+   journal_has_entries = TRUE;
+
+   if(torn_entry)
+   {
+      printf("\nThe last entry in %s was incomplete and was dropped.\n",
+         file_name);
+      return save_transactions(budget);
+   }
+
+   return 0;
+}
+
+
+
+void set_journal_mode(BOOL enabled)
+{
+   journal_mode = enabled;
+}
+
+
+
+void set_binary_mode(BOOL enabled)
+{
+   binary_mode = enabled;
+   budget_file_name = enabled ? BINARY_FILE_NAME : FILE_NAME;
+}
+
+
+
+void set_zero_copy_mode(BOOL enabled)
+{
+   zero_copy_mode = enabled;
+}
+
+
+
+void set_load_threads(int threads)
+{
+   load_threads = threads;
+}
+
+
+
+/*
+ *
+ * Saves a transaction that was just added to the end of the store
+ *
+ */
+int save_created_transaction(struct transaction_store *budget,
+   struct transaction *new_node)
+{
+   if(sharded_mode_enabled()
+      && shard_transaction_changed(budget, new_node) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   return write_change(budget, 'C', 0, new_node);
+}
+
+
+
+/*
+ *
+ * Saves new values for the transaction with the given ID
+ *
+ */
+int save_updated_transaction(struct transaction_store *budget, int id,
+   struct transaction *node)
+{
+   if(sharded_mode_enabled()
+      && shard_transaction_changed(budget, node) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   return write_change(budget, 'U', id, node);
+}
+
+
+
+/*
+ *
+ * Saves the removal of the transaction with the given ID. It is gone
+ * from the store, so all we get is the shard it was saved in.
+ *
+ */
+int save_deleted_transaction(struct transaction_store *budget, int id,
+   int shard)
+{
+   if(sharded_mode_enabled())
+   {
+      shard_transaction_removed(shard);
+   }
+
+   return write_change(budget, 'D', id, NULL);
+}
+
+
+
+/*
+ *
+ * Writes a change to the journal, hands it to the save thread, or
+ * rewrites budget.txt
+ *
+ * The budget is locked while we write, so a quit signal can't save
+ * it at the same time.
+ *
+ */
+int write_change(struct transaction_store *budget, char operation, int id,
+   const struct transaction *node)
+{
+   int result;
+
+   if(!journal_mode && background_saves_running())
+   {
+      return request_background_save();
+   }
+
+   lock_budget();
+
+   if(journal_mode)
+   {
+      result = append_journal_entry(operation, id, node);
+   }
+   else
+   {
+      result = save_transactions(budget);
+   }
+
+   unlock_budget();
+
+   return result;
+}
+
+
+
+/*
+ *
+ * Writes out anything the background thread hasn't saved yet, and
+ * folds the journal back into budget.txt before we quit, so the
+ * next start doesn't have to replay it
+ *
+ * IDs given to rows that were saved without one are saved too, so
+ * they stay the same from now on. In sharded mode, those are in the
+ * months that are marked as changed.
+ *
+ */
+int save_and_quit(struct transaction_store *budget)
+{
+   if(stop_background_saves() == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   /*
+    * We never unlock, since we are about to exit. If a quit signal
+    * comes in while we save, or while the budget is freed after
+    * this, the signal thread waits here instead of saving with us.
+    */
+   lock_budget();
+
+   if(sync_journal() == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   if(journal_has_entries || ids_given || sharded_mode_enabled())
+   {
+      return save_transactions(budget);
+   }
+
+   /* The totals may have been fixed or added up again since the load */
+   if(!rollup_file_matches())
+   {
+      write_rollups(budget_file_name);
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Writes the whole store to budget.txt (or budget.bin)
+ *
+ * In sharded mode, only the months that changed are written.
+ *
+ * The store goes to a temp file, which is synced to the disk and then
+ * renamed over budget.txt, so after a crash we find either the old
+ * file or the new one, and never a missing or half-written one.
+ *
+ * If there is a journal, we write to the checkpoint file instead of
+ * the temp file, and only delete the journal once the checkpoint is
+ * on the disk. That way load_budget() can always tell whether to trust
+ * the checkpoint or to replay the journal.
+ *
+ */
+int save_transactions(struct transaction_store *budget)
+{
+   const char *new_file_name = TEMP_FILE_NAME;
+
+   if(sharded_mode_enabled())
+   {
+      return save_changed_shards(budget);
+   }
+
+   if(journal_has_entries)
+   {
+      new_file_name = CHECKPOINT_FILE_NAME;
+   }
+
+   if(binary_mode)
+   {
+      if(write_binary_transactions(new_file_name, budget) == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+   else if(write_transactions(new_file_name, budget) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   if(journal_has_entries)
+   {
+      if(journal_fp != NULL)
+      {
+         fclose(journal_fp);
+         journal_fp = NULL;
+      }
+
+      if(remove(JOURNAL_FILE_NAME) != 0 || !sync_directory())
+      {
+         printf("\nFile error.\n\n");
+         printf("Could not remove %s.\n\n", JOURNAL_FILE_NAME);
+         return FILE_OPS_ERROR;
+      }
+
+      journal_has_entries = FALSE;
+      unsynced_entries = 0;
+   }
+
+   if(replace_file(new_file_name, budget_file_name) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   write_rollups(budget_file_name);
+
+   ids_given = FALSE;
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Renames new_file_name over file_name, and makes sure the rename
+ * itself is on the disk
+ *
+ * On POSIX systems rename() replaces the old file in one step, and on
+ * Windows MoveFileEx() does. Other systems won't rename over a file
+ * that exists, so there we have to remove it first, and a crash in
+ * between leaves only the new file.
+ *
+ */
+int replace_file(const char *new_file_name, const char *file_name)
+{
+   BOOL replaced;
+
+#if defined(HAVE_WIN32_FILES)
+   replaced = MoveFileExA(new_file_name, file_name,
+      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+#ifndef HAVE_POSIX_FILES
+   remove(file_name);
+#endif
+   replaced = rename(new_file_name, file_name) == 0 && sync_directory();
+#endif
+
+   if(!replaced)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not rename %s to %s.\n\n", new_file_name, file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   return 0;
+}
+
+
+
+int write_transactions(const char *file_name,
+   const struct transaction_store *budget)
+{
+   return write_transaction_lines(file_name, budget, NULL, 0);
+}
+
+
+
+int write_transaction_array(const char *file_name,
+   struct transaction **nodes, long count)
+{
+   return write_transaction_lines(file_name, NULL, nodes, count);
+}
+
+
+
+/*
+ *
+ * Writes the transactions in the store, or in the array of nodes if
+ * there is one, to the given file, one per line
+ *
+ * Lines are built right in a SAVE_BLOCK_SIZE block, with each field
+ * copied once to the end of the block (no strcat rescanning the line),
+ * and the block is written out whenever it is full. A million rows take
+ * about forty writes instead of a million fprintf() calls.
+ *
+ */
+int write_transaction_lines(const char *file_name,
+   const struct transaction_store *budget, struct transaction **nodes,
+   long count)
+{
+   FILE *fp;
+   char *block;
+   char *end;
+   char date_string[DATE_LENGTH + 1];
+   char amount_string[AMOUNT_LENGTH + 1];
+   char type_string[TYPE_LENGTH + 1];
+   char id_string[ID_INPUT_LENGTH + 1];
+   long i = 0;
+   struct store_cursor cursor;
+   struct transaction *p;
+
+   BOOL write_error = FALSE;
+
+   block = malloc(SAVE_BLOCK_SIZE);
+   if(block == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   fp = fopen(file_name, "w");
+   if(fp == NULL)
+   {
+      free(block);
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for writing..\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   /* We only ever hand fwrite() whole blocks, so a stdio buffer
+    * would just be one more copy */
+   setvbuf(fp, NULL, _IONBF, 0);
+
+   end = block;
+   if(nodes == NULL)
+   {
+      p = first_transaction(budget, &cursor);
+   }
+   else
+   {
+      p = count > 0 ? nodes[0] : NULL;
+   }
+
+   while(p != NULL && !write_error)
+   {
+      /* A line is never longer than MAX_TRANSACTION_LENGTH */
+      if(end - block > SAVE_BLOCK_SIZE - (MAX_TRANSACTION_LENGTH + 1))
+      {
+         write_error = !write_block(fp, block, end - block);
+         end = block;
+      }
+
+      transaction_to_text(p, date_string, amount_string, type_string);
+      end = append_field(end, date_string);
+      end = append_field(end, amount_string);
+      end = append_field(end, type_string);
+      end = append_field(end, p->description);
+      sprintf(id_string, "%d", p->id);
+      end = append_field(end, id_string);
+      *end++ = '\n';
+
+      i++;
+      p = nodes == NULL ? next_transaction(&cursor)
+         : (i < count ? nodes[i] : NULL);
+   }
+
+   if(!write_error)
+   {
+      write_error = !write_block(fp, block, end - block)
+         || !sync_file(fp);
+   }
+
+   free(block);
+
+   if(fclose(fp) == EOF || write_error)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not write %s.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Copies a field and the '|' after it to p, and returns a pointer
+ * to the character after the '|'
+ *
+ */
+char *append_field(char *p, const char *field)
+{
+   size_t length = strlen(field);
+
+   memcpy(p, field, length);
+   *(p + length) = '|';
+
+   return p + length + 1;
+}
+
+
+
+BOOL write_block(FILE *fp, const void *block, size_t size)
+{
+   return fwrite(block, 1, size, fp) == size;
+}
+
+
+
+/*
+ *
+ * Appends one entry to the journal and pushes it out to the file,
+ * so each change costs one short write no matter how big the
+ * budget is. How often the entries are synced to the disk is up
+ * to the sync policy.
+ *
+ */
+int append_journal_entry(char operation, int id,
+   const struct transaction *node)
+{
+   char date_string[DATE_LENGTH + 1];
+   char amount_string[AMOUNT_LENGTH + 1];
+   char type_string[TYPE_LENGTH + 1];
+   int result;
+
+   if(journal_fp == NULL)
+   {
+      journal_fp = fopen(JOURNAL_FILE_NAME, "a");
+      if(journal_fp == NULL || !sync_directory())
+      {
+         printf("\nFile error.\n\n");
+         printf("Could not open %s for writing..\n\n", JOURNAL_FILE_NAME);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   if(node != NULL)
+   {
+      transaction_to_text(node, date_string, amount_string, type_string);
+   }
+
+   if(operation == 'C')
+   {
+      result = fprintf(journal_fp, "C|%s|%s|%s|%s|%d|\n", date_string,
+         amount_string, type_string, node->description, node->id);
+   }
+   else if(operation == 'U')
+   {
+      result = fprintf(journal_fp, "U|%d|%s|%s|%s|%s|\n", id, date_string,
+         amount_string, type_string, node->description);
+   }
+   else
+   {
+      result = fprintf(journal_fp, "D|%d|\n", id);
+   }
+
+   if(result < 0 || fflush(journal_fp) == EOF)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not write %s.\n\n", JOURNAL_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   journal_has_entries = TRUE;
+   unsynced_entries++;
+
+   /*
+    * Group commit: depending on the policy, this entry may wait to
+    * go out to the disk together with the ones after it
+    */
+   if(sync_policy == SYNC_EVERY_CHANGE
+      || (sync_policy == SYNC_EVERY_N_CHANGES
+         && unsynced_entries >= sync_setting)
+      || (sync_policy == SYNC_EVERY_INTERVAL
+         && current_milliseconds() - last_sync_milliseconds >= sync_setting))
+   {
+      return sync_journal();
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Forces every journal entry written so far out to the disk
+ *
+ */
+int sync_journal(void)
+{
+   if(journal_fp == NULL || unsynced_entries == 0)
+   {
+      return 0;
+   }
+
+   if(!sync_file(journal_fp))
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not write %s.\n\n", JOURNAL_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   unsynced_entries = 0;
+   last_sync_milliseconds = current_milliseconds();
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Chooses when journal entries are forced out to the disk. Full saves
+ * are always synced, since the rename that finishes them is only safe
+ * once the new file is on the disk.
+ *
+ */
+void set_sync_policy(int policy, long setting)
+{
+   sync_policy = policy;
+   sync_setting = setting;
+}
+
+
+
+/*
+ *
+ * Pushes a file's data through stdio and the operating system's cache
+ * all the way to the disk
+ *
+ */
+BOOL sync_file(FILE *fp)
+{
+   if(fflush(fp) == EOF)
+   {
+      return FALSE;
+   }
+
+#if defined(HAVE_POSIX_FILES)
+   if(fsync(fileno(fp)) != 0)
+   {
+      return FALSE;
+   }
+#elif defined(HAVE_WIN32_FILES)
+   if(_commit(_fileno(fp)) != 0)
+   {
+      return FALSE;
+   }
+#endif
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Makes a file we created, renamed, or removed in the current
+ * directory stay that way after a crash
+ *
+ * Windows has no way to do this for a directory, but the renames
+ * are written through by MoveFileEx().
+ *
+ */
+BOOL sync_directory(void)
+{
+#ifdef HAVE_POSIX_FILES
+   int fd;
+   int result;
+
+   fd = open(".", O_RDONLY);
+   if(fd == -1)
+   {
+      return FALSE;
+   }
+
+   result = fsync(fd);
+   close(fd);
+
+   return result == 0;
+#else
+   return TRUE;
+#endif
+}
+
+
+
+long current_milliseconds(void)
+{
+#ifdef HAVE_MMAP
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return (long) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#else
+   return (long) time(NULL) * 1000;
+#endif
+}
+
+
+
+/*
+ *
+ * Brings a whole file into memory, by mapping it where we can
+ *
+ * The memory can be written to, but the mapping is private, so
+ * nothing written to it ever reaches the file.
+ *
+ */
+int map_file(const char *file_name, struct mapped_file *file)
+{
+#ifdef HAVE_MMAP
+   struct stat file_status;
+   int fd;
+   void *data;
+
+   file->data = NULL;
+   file->size = 0;
+   file->mapped = FALSE;
+
+   fd = open(file_name, O_RDONLY);
+   if(fd == -1)
+   {
+      printf("\nFile error.\n\n");
+      printf("Please ensure %s exists, and try again.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   if(fstat(fd, &file_status) == -1)
+   {
+      close(fd);
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   /* mmap won't map an empty file, but there's nothing to map anyway */
+   if(file_status.st_size > 0)
+   {
+      data = mmap(NULL, (size_t) file_status.st_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE, fd, 0);
+      if(data == MAP_FAILED)
+      {
+         close(fd);
+         printf("\nFile error.\n\n");
+         printf("Could not map %s into memory.\n\n", file_name);
+         return FILE_OPS_ERROR;
+      }
+
+      file->data = data;
+      file->size = (size_t) file_status.st_size;
+      file->mapped = TRUE;
+   }
+
+   close(fd);
+
+   return 0;
+#else
+   FILE *fp;
+   long size;
+
+   file->data = NULL;
+   file->size = 0;
+   file->mapped = FALSE;
+
+   fp = fopen(file_name, "rb");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Please ensure %s exists, and try again.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   if(fseek(fp, 0L, SEEK_END) != 0 || (size = ftell(fp)) < 0
+      || fseek(fp, 0L, SEEK_SET) != 0)
+   {
+      fclose(fp);
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   file->data = malloc(size > 0 ? (size_t) size : 1);
+   if(file->data == NULL)
+   {
+      fclose(fp);
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   file->size = fread(file->data, 1, (size_t) size, fp);
+   if(file->size != (size_t) size)
+   {
+      fclose(fp);
+      free(file->data);
+      file->data = NULL;
+      printf("\nFile error.\n\n");
+      printf("Could not read %s.\n\n", file_name);
+      return FILE_OPS_ERROR;
+   }
+
+   fclose(fp);
+
+   return 0;
+#endif
+}
+
+
+
+void unmap_file(struct mapped_file *file)
+{
+#ifdef HAVE_MMAP
+   if(file->mapped)
+   {
+      munmap(file->data, file->size);
+   }
+#else
+   free(file->data);
+#endif
+
+   file->data = NULL;
+   file->size = 0;
+   file->mapped = FALSE;
+}
+
+
+
+BOOL file_exists(const char *file_name)
+{
+   FILE *fp;
+
+   fp = fopen(file_name, "r");
+   if(fp == NULL)
+   {
+      return FALSE;
+   }
+
+   fclose(fp);
+
+   return TRUE;
+}
+
+
+
@@ -0,0 +1,141 @@
+/*
+ *
+ * Name:       file_operations.h
+ *
+ * Purpose:    Contains function prototypes for loading the list of
+ *             transactions from the budget file and the journal, and
+ *             for saving changes to them.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef FILE_OPERATIONS_H
+#define FILE_OPERATIONS_H
+#include <stdio.h>
+#include "crud_operations.h"
+#include "delimiter_scan.h"
+#include "boolean.h"
+
+/*
+ * The loader reads the budget file in blocks of this many bytes
+ * instead of one line at a time.
+ */
+#define LOAD_BLOCK_SIZE 1048576
+
+/* Saving builds the file in blocks of this many bytes */
+#define SAVE_BLOCK_SIZE 1048576
+
+/*
+ * A whole file in memory. On Unix the file is mapped with mmap;
+ * elsewhere it is read into a buffer.
+ */
+struct mapped_file
+{
+   char *data;
+   size_t size;
+   BOOL mapped;
+};
+
+/*
+ * Returns the number of transactions loaded into the store, which is
+ * emptied first, or FILE_OPS_ERROR if the file could not be read in
+ * full. On an error, the store is left empty.
+ */
+int load_transactions(const char *file_name,
+   struct transaction_store *budget);
+
+/* What parse_transaction_line() found on a line of the budget file */
+#define LINE_BLANK 0
+#define LINE_ADDED 1
+#define LINE_TOO_LONG 2
+#define LINE_INVALID 3
+#define LINE_NO_MEMORY 4
+
+int parse_transaction_line(char *line, const struct scanned_line *scanned,
+   BOOL borrow, struct transaction_store *budget);
+void report_line_error(int status, long line_number, const char *file_name);
+
+/*
+ * Loads budget.txt and replays the journal on top of it. Also finishes
+ * a checkpoint that was interrupted before it could rename its file.
+ */
+int load_budget(struct transaction_store *budget);
+int replay_journal(const char *file_name, struct transaction_store *budget,
+   int *number_of_transactions);
+
+/*
+ * In journal mode, every change is appended to the journal as one
+ * entry instead of rewriting budget.txt. The journal is folded back
+ * into budget.txt by save_transactions() when the user quits.
+ */
+void set_journal_mode(BOOL enabled);
+
+/*
+ * Sync policies for the journal: force each entry to the disk as it is
+ * written, or once every N entries, or once every N milliseconds.
+ * Entries still waiting are synced when the user quits.
+ */
+#define SYNC_EVERY_CHANGE 0
+#define SYNC_EVERY_N_CHANGES 1
+#define SYNC_EVERY_INTERVAL 2
+
+void set_sync_policy(int policy, long setting);
+int sync_journal(void);
+
+/*
+ * With more than one load thread, budget.txt is split into ranges
+ * that are parsed at the same time. This has no effect in binary mode.
+ */
+void set_load_threads(int threads);
+
+/* In binary mode, budget.bin is used instead of budget.txt */
+void set_binary_mode(BOOL enabled);
+
+/*
+ * In zero-copy mode, budget.txt is mapped into memory and the
+ * descriptions point into it, instead of each field being copied. This has no
+ * effect in binary mode.
+ */
+void set_zero_copy_mode(BOOL enabled);
+int load_mapped_transactions(const char *file_name,
+   struct transaction_store *budget);
+
+/*
+ * Each of these returns 0, or FILE_OPS_ERROR if the change
+ * could not be written.
+ */
+int save_created_transaction(struct transaction_store *budget,
+   struct transaction *new_node);
+int save_updated_transaction(struct transaction_store *budget, int id,
+   struct transaction *node);
+int save_deleted_transaction(struct transaction_store *budget, int id,
+   int shard);
+int save_transactions(struct transaction_store *budget);
+int save_and_quit(struct transaction_store *budget);
+
+int write_transactions(const char *file_name,
+   const struct transaction_store *budget);
+int write_transaction_array(const char *file_name,
+   struct transaction **nodes, long count);
+BOOL write_block(FILE *fp, const void *block, size_t size);
+BOOL sync_file(FILE *fp);
+int replace_file(const char *new_file_name, const char *file_name);
+int map_file(const char *file_name, struct mapped_file *file);
+void unmap_file(struct mapped_file *file);
+BOOL file_exists(const char *file_name);
+
+#endif
+
+
+
@@ -25,6 +25,7 @@
  *
  */
 #include "menus.h"
+#include "balance.h"
 
 
 
@@ -33,18 +34,31 @@
  * Displays c_budget_linked_lists' main (initial) menu
  *
  */
-void display_main_menu(void)
+void display_main_menu(CENTS credits, CENTS debits)
 {
+   char balance_string[BALANCE_LENGTH];
+   char credits_string[BALANCE_LENGTH];
+   char debits_string[BALANCE_LENGTH];
+   
+   cents_to_amount(credits - debits, balance_string);
+   cents_to_amount(credits, credits_string);
+   cents_to_amount(debits, debits_string);
+   
    printf("\n\n  --------------\n");
    printf("  |  C_BUDGET  |\n");
    printf("  --------------\n\n");
+   printf("    Balance: %s (credits %s, debits %s)\n\n", balance_string,
+      credits_string, debits_string);
    printf("    Main Menu\n");
    printf("\n    Choose from the following options:\n\n");
    printf("\t(1) Create a New Record\n");
    printf("\t(2) Display Your Budget\n");
    printf("\t(3) Update an Existing Record\n");
    printf("\t(4) Delete a Record\n");
-   printf("\t(5) Save and Quit\n");
+   printf("\t(5) Find Records by Date\n");
+   printf("\t(6) Search Descriptions\n");
+   printf("\t(7) Show Reports\n");
+   printf("\t(8) Save and Quit\n");
    printf("\n    Type your option: ");
 }
 
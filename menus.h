@@ -22,8 +22,10 @@
 #ifndef BUDGET_MENUS_H
 #define BUDGET_MENUS_H
 #include <stdio.h>
+#include "conversions.h"
 
-void display_main_menu(void);
+/* Shows the balance of the budget above the options */
+void display_main_menu(CENTS credits, CENTS debits);
 void display_update_record_menu(void);
 
 #endif
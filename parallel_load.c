@@ -0,0 +1,279 @@
+/*
+ *
+ * Name:       parallel_load.c
+ *
+ * Purpose:    Contains functions for loading a large budget file on
+ *             several threads at once.
+ *
+ *             The file is mapped into memory and cut into ranges that
+ *             end on a new line. Each thread turns its range into its
+ *             own store, and the stores' blocks are joined in file
+ *             order, so the budget comes out the same as with the
+ *             one-thread loader.
+ *
+ *             This needs POSIX threads. Everywhere else, the ranges
+ *             are parsed one after another.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The POSIX headers need this before any other #include.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_PTHREADS
+#endif
+
+#include "parallel_load.h"
+#include "read_input.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * One range of the file and what came of parsing it. A thread stops
+ * at the first bad line, and status holds the LINE_ code for it.
+ * number_of_lines counts the lines up to and including that one, so
+ * we can tell which line of the whole file it was.
+ */
+struct load_chunk
+{
+   char *start;
+   char *end;
+   BOOL borrow;
+
+   struct transaction_store budget;
+   int number_of_transactions;
+   long number_of_lines;
+   int status;
+
+#ifdef HAVE_PTHREADS
+   pthread_t thread;
+   BOOL started;
+#endif
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void *parse_chunk(void *argument);
+
+
+
+int load_transactions_in_parallel(const char *file_name,
+   struct mapped_file *file, BOOL borrow, int number_of_threads,
+   struct transaction_store *budget)
+{
+   struct load_chunk chunks[MAX_LOAD_THREADS];
+   char *start;
+   char *end;
+   char *end_of_data;
+   long line_number = 0;
+   int number_of_chunks;
+   int number_of_transactions = 0;
+   int i;
+
+   BOOL load_error = FALSE;
+
+   init_store(budget);
+
+   if(map_file(file_name, file) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   end_of_data = file->data + file->size;
+
+   /* A small file isn't worth the threads */
+   number_of_chunks = number_of_threads;
+   if(number_of_chunks > MAX_LOAD_THREADS)
+   {
+      number_of_chunks = MAX_LOAD_THREADS;
+   }
+
+   if((size_t) number_of_chunks > file->size / MIN_LOAD_CHUNK_SIZE)
+   {
+      number_of_chunks = (int) (file->size / MIN_LOAD_CHUNK_SIZE);
+   }
+
+   if(number_of_chunks < 1)
+   {
+      number_of_chunks = 1;
+   }
+
+   /* Each range runs to the end of the line its share of the file ends in */
+   start = file->data;
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      end = file->data + file->size / number_of_chunks * (i + 1);
+
+      if(i == number_of_chunks - 1)
+      {
+         end = end_of_data;
+      }
+      else if(end <= start)
+      {
+         end = start;
+      }
+      else if(*(end - 1) != '\n')
+      {
+         end = memchr(end, '\n', end_of_data - end);
+         end = end == NULL ? end_of_data : end + 1;
+      }
+
+      chunks[i].start = start;
+      chunks[i].end = end;
+      chunks[i].borrow = borrow;
+      start = end;
+   }
+
+#ifdef HAVE_PTHREADS
+   /* The first range is parsed on this thread while the others run */
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      chunks[i].started = pthread_create(&chunks[i].thread, NULL,
+         parse_chunk, &chunks[i]) == 0;
+
+      if(!chunks[i].started)
+      {
+         (void) parse_chunk(&chunks[i]);
+      }
+   }
+
+   (void) parse_chunk(&chunks[0]);
+
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      if(chunks[i].started)
+      {
+         pthread_join(chunks[i].thread, NULL);
+      }
+   }
+#else
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      (void) parse_chunk(&chunks[i]);
+   }
+#endif
+
+   /* Join the stores in file order, and report the first bad line */
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      if(!load_error && chunks[i].status != LINE_ADDED)
+      {
+         report_line_error(chunks[i].status,
+            line_number + chunks[i].number_of_lines, file_name);
+         load_error = TRUE;
+      }
+
+      line_number += chunks[i].number_of_lines;
+      number_of_transactions += chunks[i].number_of_transactions;
+
+      append_store(budget, &chunks[i].budget);
+   }
+
+   if(load_error)
+   {
+      printf("\nThe program will exit so no data is lost.\n\n");
+      free_store(budget);
+      unmap_file(file);
+      return FILE_OPS_ERROR;
+   }
+
+   if(!borrow)
+   {
+      unmap_file(file);
+   }
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Turns the lines of one range into a store of its own
+ *
+ * The new line after each line is overwritten with '\0', which is
+ * safe since the mapping is private. The last line of the file may
+ * not have one, so that line is copied instead.
+ *
+ */
+void *parse_chunk(void *argument)
+{
+   struct load_chunk *chunk = argument;
+   struct delimiter_scan scan;
+   struct scanned_line scanned;
+   char last_line[MAX_TRANSACTION_LENGTH + 1];
+   char *line;
+
+   init_store(&chunk->budget);
+   chunk->number_of_transactions = 0;
+   chunk->number_of_lines = 0;
+   chunk->status = LINE_ADDED;
+
+   start_delimiter_scan(&scan, chunk->start, chunk->end - chunk->start);
+
+   while(chunk->status == LINE_ADDED && scan_line(&scan, &scanned))
+   {
+      chunk->number_of_lines++;
+      line = chunk->start + scanned.start;
+
+      if(scanned.has_new_line)
+      {
+         line[scanned.length] = '\0';
+         chunk->status = parse_transaction_line(line, &scanned,
+            chunk->borrow, &chunk->budget);
+      }
+      else if(scanned.length > MAX_TRANSACTION_LENGTH)
+      {
+         chunk->status = LINE_TOO_LONG;
+         break;
+      }
+      else
+      {
+         memcpy(last_line, line, scanned.length);
+         last_line[scanned.length] = '\0';
+         chunk->status = parse_transaction_line(last_line, &scanned, FALSE,
+            &chunk->budget);
+      }
+
+      if(chunk->status == LINE_BLANK)
+      {
+         chunk->status = LINE_ADDED;
+         continue;
+      }
+
+      if(chunk->status != LINE_ADDED)
+      {
+         break;
+      }
+
+      chunk->number_of_transactions++;
+   }
+
+   return NULL;
+}
+
+
+
@@ -0,0 +1,47 @@
+/*
+ *
+ * Name:       parallel_load.h
+ *
+ * Purpose:    Contains function prototypes for loading a large
+ *             budget file on several threads at once.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef PARALLEL_LOAD_H
+#define PARALLEL_LOAD_H
+#include "crud_operations.h"
+#include "file_operations.h"
+#include "boolean.h"
+
+/* The most threads we will start, and the least each one should parse */
+#define MAX_LOAD_THREADS 64
+#define MIN_LOAD_CHUNK_SIZE LOAD_BLOCK_SIZE
+
+/*
+ * Maps file_name into *file and parses it on up to number_of_threads
+ * threads. The store, the return value, and any error message are the
+ * same as load_transactions() would give.
+ *
+ * If borrow is TRUE, new descriptions point into *file, which must then
+ * stay mapped. Otherwise they are copied and *file is unmapped.
+ */
+int load_transactions_in_parallel(const char *file_name,
+   struct mapped_file *file, BOOL borrow, int number_of_threads,
+   struct transaction_store *budget);
+
+#endif
+
+
+
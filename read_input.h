@@ -37,23 +37,33 @@
 
 
 #define FILE_NAME "budget.txt"
+#define BINARY_FILE_NAME "budget.bin"
 #define TEMP_FILE_NAME "temp_budget.txt"
+#define JOURNAL_FILE_NAME "budget_journal.txt"
+#define CHECKPOINT_FILE_NAME "checkpoint_budget.txt"
+#define SHARD_INDEX_FILE_NAME "budget_shards.txt"
+#define TEMP_SHARD_INDEX_FILE_NAME "temp_budget_shards.txt"
+#define ROLLUP_FILE_NAME "budget_rollups.txt"
+#define TEMP_ROLLUP_FILE_NAME "temp_budget_rollups.txt"
 
-#define MAX_TRANSACTIONS 10
 #define MAX_YEAR 3000
 
-/* Set lengths for a transaction and for each part of a transaction */
-#define MAX_TRANSACTION_LENGTH 250
+/*
+ * Set lengths for a transaction and for each part of a transaction.
+ * A whole line is the four fields and the ID, each with a '|'.
+ */
+#define MAX_TRANSACTION_LENGTH 260
+#define MAX_JOURNAL_ENTRY_LENGTH (MAX_TRANSACTION_LENGTH + ID_INPUT_LENGTH + 4)
 #define DATE_LENGTH 10
 #define AMOUNT_LENGTH 10
 #define TYPE_LENGTH 2
 #define DESCRIPTION_LENGTH 220
 
-/* Don't allow Ids greater than 999,999 (six digits) */
-#define ID_INPUT_LENGTH 6
+/* Don't allow Ids greater than 999,999,999 (nine digits) */
+#define ID_INPUT_LENGTH 9
 
 #define MENU_INPUT_LENGTH 2
-#define NUM_MAIN_MENU_OPTIONS 6
+#define NUM_MAIN_MENU_OPTIONS 9
 #define NUM_UPDATE_MENU_OPTIONS 6
 
 /* Define an integer for file operation errors */
@@ -0,0 +1,1520 @@
+/*
+ *
+ * Name:       rollups.c
+ *
+ * Purpose:    Contains functions for keeping totals of the budget by
+ *             month and by description.
+ *
+ *             Reports like spending per month or per payee used to
+ *             need every transaction. Now each month and description
+ *             has a group that is kept up to date as transactions are
+ *             added and removed, so a report only reads the groups.
+ *
+ *             The groups are saved in ROLLUP_FILE_NAME along with the
+ *             size and time of the budget file they were added up
+ *             from. If the budget file hasn't changed since, loading
+ *             reads the groups instead of adding them up again.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * On Unix we can tell if the budget file changed with stat, and add
+ * up the groups on several threads, which need the POSIX headers.
+ * This has to come before any other #include. Everywhere else, the
+ * groups are added up on one thread on every load.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200809L
+#define HAVE_STAT
+#define HAVE_PTHREADS
+#endif
+
+#include <ctype.h>
+#include <time.h>
+#include "rollups.h"
+#include "balance.h"
+#include "conversions.h"
+#include "file_operations.h"
+
+#ifdef HAVE_STAT
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* macOS keeps the nanoseconds of the time a file was written elsewhere */
+#ifdef __APPLE__
+#define WRITE_NANOSECONDS(status) ((status).st_mtimensec)
+#else
+#define WRITE_NANOSECONDS(status) ((status).st_mtim.tv_nsec)
+#endif
+#endif
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* Each table starts with this many slots, and doubles when full */
+#define MIN_ROLLUP_SLOTS 64
+
+/* Saved in place of a smallest or largest amount that isn't known */
+#define UNKNOWN_CENTS -1L
+
+/* Room for the stamp of the budget file: five numbers */
+#define MAX_STAMP_LENGTH (5 * 21 + 16)
+
+/* Room for a rollup line: six numbers and a description */
+#define MAX_ROLLUP_LINE_LENGTH (DESCRIPTION_LENGTH + 6 * 21 + 16)
+
+/*
+ * The most threads the groups are added up on, and the fewest blocks
+ * of the store each one should get
+ */
+#define MAX_ROLLUP_THREADS 64
+#define MIN_ROLLUP_CHUNK_BLOCKS 64
+
+/* How many descriptions and days each thread remembers the group of */
+#define ROLLUP_CACHE_SIZE 4096
+
+/*
+ * One month or description. A month group has no description, and a
+ * description group's text points just past the structure, in the same
+ * allocation.
+ */
+struct rollup
+{
+   struct rollup *next;
+   int month;
+   char *description;
+   long count;
+   CENTS credits;
+   CENTS debits;
+   CENTS smallest;
+   CENTS largest;
+   BOOL extremes_known;
+};
+
+/* A hash table of groups, with a chain for each slot */
+struct rollup_table
+{
+   struct rollup **slots;
+   unsigned long number_of_slots;
+   unsigned long number_of_groups;
+};
+
+/*
+ * A run of blocks of the store, and the groups of just the
+ * transactions in it
+ */
+struct rollup_chunk
+{
+   struct store_block *first;
+   long number_of_blocks;
+
+   struct rollup_table months;
+   struct rollup_table descriptions;
+   BOOL out_of_memory;
+
+#ifdef HAVE_PTHREADS
+   pthread_t thread;
+   BOOL started;
+#endif
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void normalize_description(const char *description, char *normalized);
+unsigned long rollup_hash(int month, const char *description);
+struct rollup *find_rollup(struct rollup_table *table, int month,
+   const char *description, BOOL create);
+BOOL grow_rollup_table(struct rollup_table *table);
+BOOL link_rollup(struct rollup_table *table, struct rollup *group);
+void delete_rollup(struct rollup_table *table, struct rollup *group);
+void add_to_group(struct rollup *group, const struct transaction *node);
+void remove_from_group(struct rollup_table *table, struct rollup *group,
+   const struct transaction *node);
+void free_rollup_table(struct rollup_table *table);
+void lose_rollups(void);
+void forget_stale_extremes(struct rollup_table *table);
+void mark_extremes_known(struct rollup_table *table);
+int prepare_rollups(const struct transaction_store *store);
+void *add_up_chunk(void *argument);
+BOOL merge_rollup_table(struct rollup_table *table,
+   struct rollup_table *other);
+unsigned long rollup_checksum(const struct rollup_table *table);
+struct rollup **sorted_rollups(const struct rollup_table *table,
+   int (*compare)(const void *, const void *));
+int compare_month_rollups(const void *a, const void *b);
+int compare_description_rollups(const void *a, const void *b);
+void print_rollup_amounts(const struct rollup *group);
+BOOL get_file_stamp(const char *file_name, char *stamp);
+BOOL parse_rollup_numbers(char **ptr_text, CENTS *numbers, int count);
+void write_rollup_numbers(char *text, const struct rollup *group);
+
+/*
+ * The groups. When we run out of memory while keeping them, they are
+ * thrown away and added up again from the store when a report needs
+ * them. number_of_stale counts the groups whose smallest or largest
+ * amount was removed.
+ */
+static struct rollup_table months = { NULL, 0, 0 };
+static struct rollup_table descriptions = { NULL, 0, 0 };
+static long number_of_stale = 0;
+static BOOL rollups_lost = FALSE;
+static BOOL rollups_paused = FALSE;
+static BOOL file_matches = FALSE;
+
+/* 0 until set, for as many as there are processors */
+static int rollup_threads = 0;
+
+
+
+void add_to_rollups(const struct transaction *node)
+{
+   char normalized[DESCRIPTION_LENGTH + 1];
+   struct rollup *month_group;
+   struct rollup *description_group;
+
+   if(rollups_paused || rollups_lost)
+   {
+      return;
+   }
+
+   file_matches = FALSE;
+
+   normalize_description(node->description, normalized);
+
+   month_group = find_rollup(&months, day_number_to_month(node->day), NULL,
+      TRUE);
+   description_group = find_rollup(&descriptions, 0, normalized, TRUE);
+   if(month_group == NULL || description_group == NULL)
+   {
+      lose_rollups();
+      return;
+   }
+
+   add_to_group(month_group, node);
+   add_to_group(description_group, node);
+}
+
+
+
+void remove_from_rollups(const struct transaction *node)
+{
+   char normalized[DESCRIPTION_LENGTH + 1];
+   struct rollup *month_group;
+   struct rollup *description_group;
+
+   if(rollups_paused || rollups_lost)
+   {
+      return;
+   }
+
+   file_matches = FALSE;
+
+   normalize_description(node->description, normalized);
+
+   month_group = find_rollup(&months, day_number_to_month(node->day), NULL,
+      FALSE);
+   description_group = find_rollup(&descriptions, 0, normalized, FALSE);
+
+   /* Only if the saved groups didn't match the budget after all */
+   if(month_group == NULL || description_group == NULL)
+   {
+      lose_rollups();
+      return;
+   }
+
+   remove_from_group(&months, month_group, node);
+   remove_from_group(&descriptions, description_group, node);
+}
+
+
+
+/*
+ *
+ * The file starts with the stamp of the budget file, then has a line
+ * for each group, and ends with a line of its own, so a file that was
+ * cut off is never read:
+ *
+ *    budget|size|seconds|nanoseconds|device|inode|
+ *    M|yyyy|mm|count|credits|debits|smallest|largest|
+ *    D|count|credits|debits|smallest|largest|description|
+ *    end|
+ *
+ */
+BOOL read_rollups(const char *budget_file_name)
+{
+   FILE *fp;
+   char line[MAX_ROLLUP_LINE_LENGTH + 2];
+   char *p;
+   char *end;
+   char stamp[MAX_STAMP_LENGTH];
+   CENTS numbers[7];
+   struct rollup *group;
+   BOOL valid = FALSE;
+
+   if(!get_file_stamp(budget_file_name, stamp))
+   {
+      return FALSE;
+   }
+
+   fp = fopen(ROLLUP_FILE_NAME, "r");
+   if(fp == NULL)
+   {
+      return FALSE;
+   }
+
+   if(fgets(line, sizeof(line), fp) == NULL || strcmp(line, stamp) != 0)
+   {
+      fclose(fp);
+      return FALSE;
+   }
+
+   while(fgets(line, sizeof(line), fp) != NULL)
+   {
+      if(strcmp(line, "end|\n") == 0)
+      {
+         valid = TRUE;
+         break;
+      }
+
+      p = line + 2;
+      group = NULL;
+
+      if(strncmp(line, "M|", 2) == 0 && parse_rollup_numbers(&p, numbers, 7)
+         && *p == '\n' && numbers[0] >= 1 && numbers[0] < MAX_YEAR
+         && numbers[1] >= 1 && numbers[1] <= 12)
+      {
+         group = find_rollup(&months,
+            (int) (numbers[0] * 12 + numbers[1] - 1), NULL, TRUE);
+      }
+      else if(strncmp(line, "D|", 2) == 0
+         && parse_rollup_numbers(&p, numbers + 2, 5)
+         && (end = strrchr(p, '|')) != NULL)
+      {
+         *end = '\0';
+         group = find_rollup(&descriptions, 0, p, TRUE);
+      }
+
+      if(group == NULL || group->count != 0 || numbers[2] < 1)
+      {
+         break;
+      }
+
+      group->count = (long) numbers[2];
+      group->credits = numbers[3];
+      group->debits = numbers[4];
+      group->smallest = numbers[5];
+      group->largest = numbers[6];
+      group->extremes_known = numbers[5] != UNKNOWN_CENTS
+         && numbers[6] != UNKNOWN_CENTS;
+
+      if(!group->extremes_known)
+      {
+         number_of_stale++;
+      }
+   }
+
+   fclose(fp);
+
+   if(!valid)
+   {
+      free_rollups();
+      return FALSE;
+   }
+
+   file_matches = TRUE;
+
+   return TRUE;
+}
+
+
+
+void pause_rollups(BOOL paused)
+{
+   rollups_paused = paused;
+}
+
+
+
+void set_rollup_threads(int threads)
+{
+   rollup_threads = threads > MAX_ROLLUP_THREADS ? MAX_ROLLUP_THREADS
+      : threads;
+}
+
+
+
+/*
+ *
+ * Adds up every group from the store, replacing the ones we have
+ *
+ * The store is cut into runs of blocks, one for each thread. Each
+ * thread adds up its own groups, and those are merged into the first
+ * thread's, which become the budget's. A group is only ever touched
+ * by one thread, so nothing needs to be locked.
+ *
+ */
+void add_up_rollups(const struct transaction_store *store)
+{
+   struct rollup_chunk chunks[MAX_ROLLUP_THREADS];
+   struct store_block *block;
+   long number_of_blocks = 0;
+   long blocks_per_chunk;
+   long j;
+   int number_of_chunks;
+   int i;
+
+   BOOL out_of_memory;
+
+   free_rollups();
+
+   for(block = store->first; block != NULL; block = block->next)
+   {
+      number_of_blocks++;
+   }
+
+   /* A small budget isn't worth the threads */
+   number_of_chunks = choose_rollup_threads();
+   if(number_of_chunks > number_of_blocks / MIN_ROLLUP_CHUNK_BLOCKS)
+   {
+      number_of_chunks = (int) (number_of_blocks / MIN_ROLLUP_CHUNK_BLOCKS);
+   }
+
+   if(number_of_chunks < 1)
+   {
+      number_of_chunks = 1;
+   }
+
+   /* The last chunk also gets the blocks left over */
+   blocks_per_chunk = number_of_blocks / number_of_chunks;
+   block = store->first;
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      chunks[i].first = block;
+      chunks[i].number_of_blocks = i < number_of_chunks - 1
+         ? blocks_per_chunk : number_of_blocks - blocks_per_chunk * i;
+
+      for(j = 0; j < chunks[i].number_of_blocks; j++)
+      {
+         block = block->next;
+      }
+   }
+
+#ifdef HAVE_PTHREADS
+   /* The first chunk is added up on this thread while the others run */
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      chunks[i].started = pthread_create(&chunks[i].thread, NULL,
+         add_up_chunk, &chunks[i]) == 0;
+
+      if(!chunks[i].started)
+      {
+         (void) add_up_chunk(&chunks[i]);
+      }
+   }
+
+   (void) add_up_chunk(&chunks[0]);
+
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      if(chunks[i].started)
+      {
+         pthread_join(chunks[i].thread, NULL);
+      }
+   }
+#else
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      (void) add_up_chunk(&chunks[i]);
+   }
+#endif
+
+   months = chunks[0].months;
+   descriptions = chunks[0].descriptions;
+   out_of_memory = chunks[0].out_of_memory;
+
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      if(!out_of_memory && (chunks[i].out_of_memory
+         || !merge_rollup_table(&months, &chunks[i].months)
+         || !merge_rollup_table(&descriptions, &chunks[i].descriptions)))
+      {
+         out_of_memory = TRUE;
+      }
+
+      free_rollup_table(&chunks[i].months);
+      free_rollup_table(&chunks[i].descriptions);
+   }
+
+   if(out_of_memory)
+   {
+      lose_rollups();
+   }
+}
+
+
+
+int print_rollup_benchmark(const struct transaction_store *store)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+   unsigned long checksum;
+   double start;
+   int most_threads = choose_rollup_threads();
+   int saved_threads = rollup_threads;
+   int threads;
+
+   printf("\nAdding up the groups of %ld transactions:\n\n",
+      store->number_of_transactions);
+
+   /* The way the groups are kept up to date, one transaction at a time */
+   free_rollups();
+   start = wall_clock_seconds();
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      add_to_rollups(p);
+   }
+
+   if(rollups_lost)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   printf("   One at a time: %.3f ms\n",
+      (wall_clock_seconds() - start) * 1000);
+
+   checksum = rollup_checksum(&months) + rollup_checksum(&descriptions);
+
+   for(threads = 1; threads <= most_threads;
+      threads = threads < most_threads && threads * 2 > most_threads
+         ? most_threads : threads * 2)
+   {
+      rollup_threads = threads;
+
+      free_rollups();
+      start = wall_clock_seconds();
+      add_up_rollups(store);
+
+      if(rollups_lost)
+      {
+         rollup_threads = saved_threads;
+         printf("\nMemory allocation error.\n");
+         return FILE_OPS_ERROR;
+      }
+
+      printf("   On %d thread%s: %.3f ms\n", threads, threads == 1 ? "" : "s",
+         (wall_clock_seconds() - start) * 1000);
+
+      if(rollup_checksum(&months) + rollup_checksum(&descriptions)
+         != checksum)
+      {
+         rollup_threads = saved_threads;
+         printf("\nThe groups added up on %d threads don't match.\n",
+            threads);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   rollup_threads = saved_threads;
+
+   return 0;
+}
+
+
+
+void write_rollups(const char *budget_file_name)
+{
+   FILE *fp;
+   struct rollup *group;
+   char numbers[5 * (CENTS_TEXT_LENGTH + 1) + 1];
+   char stamp[MAX_STAMP_LENGTH];
+   unsigned long i;
+   int result;
+
+   if(rollups_lost || !get_file_stamp(budget_file_name, stamp))
+   {
+      remove(ROLLUP_FILE_NAME);
+      return;
+   }
+
+   /* Like the budget, the groups go to a temp file that is renamed */
+   fp = fopen(TEMP_ROLLUP_FILE_NAME, "w");
+   if(fp == NULL)
+   {
+      remove(ROLLUP_FILE_NAME);
+      return;
+   }
+
+   result = fputs(stamp, fp) == EOF ? -1 : 0;
+
+   for(i = 0; i < months.number_of_slots && result >= 0; i++)
+   {
+      for(group = months.slots[i]; group != NULL && result >= 0;
+         group = group->next)
+      {
+         write_rollup_numbers(numbers, group);
+         result = fprintf(fp, "M|%04d|%02d|%s\n", group->month / 12,
+            group->month % 12 + 1, numbers);
+      }
+   }
+
+   for(i = 0; i < descriptions.number_of_slots && result >= 0; i++)
+   {
+      for(group = descriptions.slots[i]; group != NULL && result >= 0;
+         group = group->next)
+      {
+         write_rollup_numbers(numbers, group);
+         result = fprintf(fp, "D|%s%s|\n", numbers, group->description);
+      }
+   }
+
+   if(result >= 0)
+   {
+      result = fprintf(fp, "end|\n");
+   }
+
+   if(result < 0 || !sync_file(fp))
+   {
+      fclose(fp);
+      remove(TEMP_ROLLUP_FILE_NAME);
+      remove(ROLLUP_FILE_NAME);
+      return;
+   }
+
+   if(fclose(fp) != 0
+      || replace_file(TEMP_ROLLUP_FILE_NAME, ROLLUP_FILE_NAME)
+         == FILE_OPS_ERROR)
+   {
+      remove(TEMP_ROLLUP_FILE_NAME);
+      remove(ROLLUP_FILE_NAME);
+      return;
+   }
+
+   file_matches = TRUE;
+}
+
+
+
+BOOL rollup_file_matches(void)
+{
+   return file_matches;
+}
+
+
+
+int print_month_rollups(const struct transaction_store *store)
+{
+   struct rollup **groups;
+   unsigned long i;
+
+   if(prepare_rollups(store) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   groups = sorted_rollups(&months, compare_month_rollups);
+   if(groups == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   printf("%-7s\t%8s\t%14s\t%14s\t%14s\t%10s\t%10s\n", "Month", "Count",
+      "Credits", "Debits", "Balance", "Smallest", "Largest");
+   printf("%-7s\t%8s\t%14s\t%14s\t%14s\t%10s\t%10s\n", "-------",
+      "--------", "--------------", "--------------", "--------------",
+      "----------", "----------");
+
+   for(i = 0; i < months.number_of_groups; i++)
+   {
+      printf("%02d/%04d\t", groups[i]->month % 12 + 1, groups[i]->month / 12);
+      print_rollup_amounts(groups[i]);
+      printf("\n");
+   }
+
+   printf("\n%lu months.\n", months.number_of_groups);
+
+   free(groups);
+
+   return 0;
+}
+
+
+
+int print_description_rollups(const struct transaction_store *store)
+{
+   struct rollup **groups;
+   unsigned long i;
+
+   if(prepare_rollups(store) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   groups = sorted_rollups(&descriptions, compare_description_rollups);
+   if(groups == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   printf("%8s\t%14s\t%14s\t%14s\t%10s\t%10s\t%-50s\n", "Count",
+      "Credits", "Debits", "Balance", "Smallest", "Largest", "Description");
+   printf("%8s\t%14s\t%14s\t%14s\t%10s\t%10s\t%-50s\n", "--------",
+      "--------------", "--------------", "--------------", "----------",
+      "----------", "--------------------------------------------------");
+
+   for(i = 0; i < descriptions.number_of_groups; i++)
+   {
+      print_rollup_amounts(groups[i]);
+      printf("\t%-50s\n", groups[i]->description);
+   }
+
+   printf("\n%lu descriptions.\n", descriptions.number_of_groups);
+
+   free(groups);
+
+   return 0;
+}
+
+
+
+void free_rollups(void)
+{
+   free_rollup_table(&months);
+   free_rollup_table(&descriptions);
+   number_of_stale = 0;
+   rollups_lost = FALSE;
+   file_matches = FALSE;
+}
+
+
+
+/*
+ *
+ * Copies a description in lower case, with each run of spaces made
+ * into one, and none at the start or end, so "Rent " and "rent" are
+ * in the same group
+ *
+ */
+void normalize_description(const char *description, char *normalized)
+{
+   const unsigned char *p = (const unsigned char *) description;
+   char *q = normalized;
+
+   while(*p != '\0')
+   {
+      if(isspace(*p))
+      {
+         while(isspace(*p))
+         {
+            p++;
+         }
+
+         if(q != normalized && *p != '\0')
+         {
+            *q++ = ' ';
+         }
+      }
+      else
+      {
+         *q++ = (char) tolower(*p);
+         p++;
+      }
+   }
+
+   *q = '\0';
+}
+
+
+
+unsigned long rollup_hash(int month, const char *description)
+{
+   unsigned long hash = 5381;
+
+   if(description == NULL)
+   {
+      return (unsigned long) month * 2654435761UL;
+   }
+
+   while(*description != '\0')
+   {
+      hash = hash * 33 + (unsigned char) *description++;
+   }
+
+   return hash;
+}
+
+
+
+/*
+ *
+ * Returns the group for a month, or for a description if it isn't
+ * NULL. If there is none, a new, empty one is added if create is TRUE.
+ * Returns NULL if there is none, or if we run out of memory.
+ *
+ */
+struct rollup *find_rollup(struct rollup_table *table, int month,
+   const char *description, BOOL create)
+{
+   struct rollup *group;
+   unsigned long slot;
+
+   if(table->number_of_slots > 0)
+   {
+      slot = rollup_hash(month, description) & (table->number_of_slots - 1);
+
+      for(group = table->slots[slot]; group != NULL; group = group->next)
+      {
+         if(description == NULL ? group->month == month
+            : strcmp(group->description, description) == 0)
+         {
+            return group;
+         }
+      }
+   }
+
+   if(!create)
+   {
+      return NULL;
+   }
+
+   group = malloc(sizeof(struct rollup)
+      + (description == NULL ? 0 : strlen(description) + 1));
+   if(group == NULL)
+   {
+      return NULL;
+   }
+
+   group->month = month;
+   group->description = NULL;
+   group->count = 0;
+   group->credits = 0;
+   group->debits = 0;
+   group->smallest = 0;
+   group->largest = 0;
+   group->extremes_known = TRUE;
+
+   if(description != NULL)
+   {
+      group->description = (char *) (group + 1);
+      strcpy(group->description, description);
+   }
+
+   if(!link_rollup(table, group))
+   {
+      free(group);
+      return NULL;
+   }
+
+   return group;
+}
+
+
+
+BOOL grow_rollup_table(struct rollup_table *table)
+{
+   struct rollup **slots;
+   struct rollup *group;
+   struct rollup *next;
+   unsigned long number_of_slots;
+   unsigned long slot;
+   unsigned long i;
+
+   number_of_slots = table->number_of_slots == 0 ? MIN_ROLLUP_SLOTS
+      : table->number_of_slots * 2;
+
+   slots = calloc(number_of_slots, sizeof(struct rollup *));
+   if(slots == NULL)
+   {
+      return FALSE;
+   }
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = next)
+      {
+         next = group->next;
+         slot = rollup_hash(group->month, group->description)
+            & (number_of_slots - 1);
+         group->next = slots[slot];
+         slots[slot] = group;
+      }
+   }
+
+   free(table->slots);
+   table->slots = slots;
+   table->number_of_slots = number_of_slots;
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Puts a group that isn't in the table into it. Returns FALSE if the
+ * table has to grow and we run out of memory.
+ *
+ */
+BOOL link_rollup(struct rollup_table *table, struct rollup *group)
+{
+   unsigned long slot;
+
+   if(table->number_of_groups >= table->number_of_slots
+      && !grow_rollup_table(table))
+   {
+      return FALSE;
+   }
+
+   slot = rollup_hash(group->month, group->description)
+      & (table->number_of_slots - 1);
+   group->next = table->slots[slot];
+   table->slots[slot] = group;
+   table->number_of_groups++;
+
+   return TRUE;
+}
+
+
+
+void delete_rollup(struct rollup_table *table, struct rollup *group)
+{
+   struct rollup **p;
+
+   p = &table->slots[rollup_hash(group->month, group->description)
+      & (table->number_of_slots - 1)];
+
+   while(*p != group)
+   {
+      p = &(*p)->next;
+   }
+
+   *p = group->next;
+   table->number_of_groups--;
+
+   if(!group->extremes_known)
+   {
+      number_of_stale--;
+   }
+
+   free(group);
+}
+
+
+
+void add_to_group(struct rollup *group, const struct transaction *node)
+{
+   if(node->type == CREDIT_TYPE)
+   {
+      group->credits += node->amount;
+   }
+   else
+   {
+      group->debits += node->amount;
+   }
+
+   group->count++;
+
+   if(!group->extremes_known)
+   {
+      return;
+   }
+
+   if(group->count == 1 || node->amount < group->smallest)
+   {
+      group->smallest = node->amount;
+   }
+
+   if(group->count == 1 || node->amount > group->largest)
+   {
+      group->largest = node->amount;
+   }
+}
+
+
+
+void remove_from_group(struct rollup_table *table, struct rollup *group,
+   const struct transaction *node)
+{
+   if(node->type == CREDIT_TYPE)
+   {
+      group->credits -= node->amount;
+   }
+   else
+   {
+      group->debits -= node->amount;
+   }
+
+   group->count--;
+
+   if(group->count == 0)
+   {
+      delete_rollup(table, group);
+   }
+   else if(group->extremes_known && (node->amount == group->smallest
+      || node->amount == group->largest))
+   {
+      group->extremes_known = FALSE;
+      number_of_stale++;
+   }
+}
+
+
+
+void free_rollup_table(struct rollup_table *table)
+{
+   struct rollup *group;
+   struct rollup *next;
+   unsigned long i;
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = next)
+      {
+         next = group->next;
+         free(group);
+      }
+   }
+
+   free(table->slots);
+   table->slots = NULL;
+   table->number_of_slots = 0;
+   table->number_of_groups = 0;
+}
+
+
+
+/*
+ *
+ * Throws the groups away after we run out of memory, or find that
+ * they don't match the budget, so they get added up again
+ *
+ */
+void lose_rollups(void)
+{
+   free_rollups();
+   rollups_lost = TRUE;
+}
+
+
+
+/*
+ *
+ * Before the pass that fixes them, the stale groups' smallest and
+ * largest amounts are set to UNKNOWN_CENTS, and after it, every group
+ * is known again
+ *
+ */
+void forget_stale_extremes(struct rollup_table *table)
+{
+   struct rollup *group;
+   unsigned long i;
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = group->next)
+      {
+         if(!group->extremes_known)
+         {
+            group->smallest = UNKNOWN_CENTS;
+            group->largest = UNKNOWN_CENTS;
+         }
+      }
+   }
+}
+
+
+
+void mark_extremes_known(struct rollup_table *table)
+{
+   struct rollup *group;
+   unsigned long i;
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = group->next)
+      {
+         group->extremes_known = TRUE;
+      }
+   }
+}
+
+
+
+/*
+ *
+ * Makes every group right before a report: all of them, if they were
+ * lost, or else the smallest and largest amounts of the groups that
+ * lost theirs. Either takes one pass over the store, and only happens
+ * when needed.
+ *
+ */
+int prepare_rollups(const struct transaction_store *store)
+{
+   char normalized[DESCRIPTION_LENGTH + 1];
+   struct store_cursor cursor;
+   struct transaction *p;
+   struct rollup *groups[2];
+   struct rollup *group;
+   int g;
+
+   if(rollups_lost)
+   {
+      add_up_rollups(store);
+
+      if(rollups_lost)
+      {
+         printf("\nMemory allocation error.\n");
+         return FILE_OPS_ERROR;
+      }
+
+      return 0;
+   }
+
+   if(number_of_stale == 0)
+   {
+      return 0;
+   }
+
+   forget_stale_extremes(&months);
+   forget_stale_extremes(&descriptions);
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      normalize_description(p->description, normalized);
+      groups[0] = find_rollup(&months, day_number_to_month(p->day), NULL,
+         FALSE);
+      groups[1] = find_rollup(&descriptions, 0, normalized, FALSE);
+
+      for(g = 0; g < 2; g++)
+      {
+         group = groups[g];
+         if(group == NULL || group->extremes_known)
+         {
+            continue;
+         }
+
+         /* Amounts are never negative, so -1 marks a group not seen yet */
+         if(group->smallest == UNKNOWN_CENTS || p->amount < group->smallest)
+         {
+            group->smallest = p->amount;
+         }
+
+         if(group->largest == UNKNOWN_CENTS || p->amount > group->largest)
+         {
+            group->largest = p->amount;
+         }
+      }
+   }
+
+   mark_extremes_known(&months);
+   mark_extremes_known(&descriptions);
+
+   number_of_stale = 0;
+   file_matches = FALSE;
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * How many threads to add up the groups on: as many as were asked
+ * for, or else one for each processor
+ *
+ */
+int choose_rollup_threads(void)
+{
+   long processors = 1;
+
+   if(rollup_threads > 0)
+   {
+      return rollup_threads;
+   }
+
+#if defined(HAVE_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+   processors = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+   if(processors < 1)
+   {
+      processors = 1;
+   }
+
+   return processors > MAX_ROLLUP_THREADS ? MAX_ROLLUP_THREADS
+      : (int) processors;
+}
+
+
+
+/*
+ *
+ * Adds up the groups of one chunk into its own tables
+ *
+ * Transactions with the same description share one copy of it, so
+ * the group of each copy is remembered, and most transactions find
+ * theirs without normalizing and hashing their description. The same
+ * goes for the group of each day's month.
+ *
+ */
+void *add_up_chunk(void *argument)
+{
+   struct rollup_chunk *chunk = argument;
+   char normalized[DESCRIPTION_LENGTH + 1];
+   const char *cached_descriptions[ROLLUP_CACHE_SIZE];
+   struct rollup *cached_description_groups[ROLLUP_CACHE_SIZE];
+   int cached_days[ROLLUP_CACHE_SIZE];
+   struct rollup *cached_month_groups[ROLLUP_CACHE_SIZE];
+   struct store_block *block = chunk->first;
+   struct transaction *p;
+   unsigned long slot;
+   long b;
+   int i;
+
+   chunk->months.slots = NULL;
+   chunk->months.number_of_slots = 0;
+   chunk->months.number_of_groups = 0;
+   chunk->descriptions = chunk->months;
+   chunk->out_of_memory = FALSE;
+
+   for(i = 0; i < ROLLUP_CACHE_SIZE; i++)
+   {
+      cached_descriptions[i] = NULL;
+      cached_month_groups[i] = NULL;
+   }
+
+   for(b = 0; b < chunk->number_of_blocks; b++, block = block->next)
+   {
+      for(i = 0; i < block->used; i++)
+      {
+         p = &block->records[i];
+         if(p->deleted)
+         {
+            continue;
+         }
+
+         slot = (unsigned long) p->day % ROLLUP_CACHE_SIZE;
+         if(cached_month_groups[slot] == NULL || cached_days[slot] != p->day)
+         {
+            cached_days[slot] = p->day;
+            cached_month_groups[slot] = find_rollup(&chunk->months,
+               day_number_to_month(p->day), NULL, TRUE);
+         }
+
+         slot = ((unsigned long) p->description >> 4) % ROLLUP_CACHE_SIZE;
+         if(cached_descriptions[slot] != p->description)
+         {
+            normalize_description(p->description, normalized);
+            cached_descriptions[slot] = p->description;
+            cached_description_groups[slot] =
+               find_rollup(&chunk->descriptions, 0, normalized, TRUE);
+         }
+
+         if(cached_month_groups[(unsigned long) p->day % ROLLUP_CACHE_SIZE]
+            == NULL || cached_description_groups[slot] == NULL)
+         {
+            chunk->out_of_memory = TRUE;
+            return NULL;
+         }
+
+         add_to_group(cached_month_groups[(unsigned long) p->day
+            % ROLLUP_CACHE_SIZE], p);
+         add_to_group(cached_description_groups[slot], p);
+      }
+   }
+
+   return NULL;
+}
+
+
+
+/*
+ *
+ * Moves every group of other into table, adding it to the group that
+ * is already there, if there is one. Returns FALSE if we run out of
+ * memory, and then the groups that are left are still in other.
+ *
+ */
+BOOL merge_rollup_table(struct rollup_table *table,
+   struct rollup_table *other)
+{
+   struct rollup *group;
+   struct rollup *same;
+   unsigned long i;
+
+   for(i = 0; i < other->number_of_slots; i++)
+   {
+      while((group = other->slots[i]) != NULL)
+      {
+         same = find_rollup(table, group->month, group->description, FALSE);
+         other->slots[i] = group->next;
+
+         if(same == NULL)
+         {
+            if(!link_rollup(table, group))
+            {
+               other->slots[i] = group;
+               return FALSE;
+            }
+         }
+         else
+         {
+            same->smallest = group->smallest < same->smallest
+               ? group->smallest : same->smallest;
+            same->largest = group->largest > same->largest
+               ? group->largest : same->largest;
+            same->count += group->count;
+            same->credits += group->credits;
+            same->debits += group->debits;
+            free(group);
+         }
+
+         other->number_of_groups--;
+      }
+   }
+
+   return TRUE;
+}
+
+
+
+/* Tells the benchmark whether two ways of adding up came out the same */
+unsigned long rollup_checksum(const struct rollup_table *table)
+{
+   const struct rollup *group;
+   unsigned long checksum = table->number_of_groups;
+   unsigned long i;
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = group->next)
+      {
+         checksum += (unsigned long) group->month * 3
+            + (unsigned long) group->count * 5
+            + (unsigned long) group->credits * 7
+            + (unsigned long) group->debits * 11
+            + (unsigned long) group->smallest * 13
+            + (unsigned long) group->largest * 17;
+      }
+   }
+
+   return checksum;
+}
+
+
+
+/* Time on the clock on the wall, since clock() adds up every thread */
+double wall_clock_seconds(void)
+{
+#ifdef HAVE_PTHREADS
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return (double) now.tv_sec + (double) now.tv_nsec / 1000000000.0;
+#else
+   return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+
+/*
+ *
+ * Returns a new array of the groups in a table, sorted, which the
+ * caller frees, or NULL if we run out of memory
+ *
+ */
+struct rollup **sorted_rollups(const struct rollup_table *table,
+   int (*compare)(const void *, const void *))
+{
+   struct rollup **groups;
+   struct rollup *group;
+   unsigned long i;
+   unsigned long n = 0;
+
+   groups = malloc(sizeof(struct rollup *) * (table->number_of_groups + 1));
+   if(groups == NULL)
+   {
+      return NULL;
+   }
+
+   for(i = 0; i < table->number_of_slots; i++)
+   {
+      for(group = table->slots[i]; group != NULL; group = group->next)
+      {
+         groups[n++] = group;
+      }
+   }
+
+   qsort(groups, n, sizeof(struct rollup *), compare);
+
+   return groups;
+}
+
+
+
+int compare_month_rollups(const void *a, const void *b)
+{
+   const struct rollup *group_a = *(struct rollup * const *) a;
+   const struct rollup *group_b = *(struct rollup * const *) b;
+
+   return group_a->month < group_b->month ? -1
+      : group_a->month > group_b->month;
+}
+
+
+
+int compare_description_rollups(const void *a, const void *b)
+{
+   const struct rollup *group_a = *(struct rollup * const *) a;
+   const struct rollup *group_b = *(struct rollup * const *) b;
+
+   return strcmp(group_a->description, group_b->description);
+}
+
+
+
+void print_rollup_amounts(const struct rollup *group)
+{
+   char credits_string[BALANCE_LENGTH];
+   char debits_string[BALANCE_LENGTH];
+   char balance_string[BALANCE_LENGTH];
+   char smallest_string[BALANCE_LENGTH];
+   char largest_string[BALANCE_LENGTH];
+
+   cents_to_amount(group->credits, credits_string);
+   cents_to_amount(group->debits, debits_string);
+   cents_to_amount(group->credits - group->debits, balance_string);
+   cents_to_amount(group->smallest, smallest_string);
+   cents_to_amount(group->largest, largest_string);
+
+   printf("%8ld\t%14s\t%14s\t%14s\t%10s\t%10s", group->count,
+      credits_string, debits_string, balance_string, smallest_string,
+      largest_string);
+}
+
+
+
+/*
+ *
+ * Writes the first line of the rollup file for a budget file: its
+ * size, the time it was last written to the nanosecond, and the
+ * device and inode it is on. Every save renames a new file over the
+ * budget, which gives it a new inode, so a file that was edited
+ * another way still shows up as changed even if it has the same size
+ * and was written within the same second. Returns FALSE if we can't
+ * get these, or if there is no way to on this system.
+ *
+ */
+BOOL get_file_stamp(const char *file_name, char *stamp)
+{
+#ifdef HAVE_STAT
+   struct stat status;
+
+   if(stat(file_name, &status) != 0)
+   {
+      return FALSE;
+   }
+
+   sprintf(stamp, "budget|%lu|%ld|%ld|%lu|%lu|\n",
+      (unsigned long) status.st_size, (long) status.st_mtime,
+      (long) WRITE_NANOSECONDS(status), (unsigned long) status.st_dev,
+      (unsigned long) status.st_ino);
+
+   return TRUE;
+#else
+   (void) file_name;
+   (void) stamp;
+
+   return FALSE;
+#endif
+}
+
+
+
+/*
+ *
+ * Reads count numbers, each followed by a '|', and moves *ptr_text
+ * past them. Returns FALSE if any of them is missing.
+ *
+ */
+BOOL parse_rollup_numbers(char **ptr_text, CENTS *numbers, int count)
+{
+   char *p = *ptr_text;
+   int i;
+
+   for(i = 0; i < count; i++)
+   {
+      p = (char *) read_cents(p, &numbers[i]);
+      if(p == NULL || *p != '|')
+      {
+         return FALSE;
+      }
+
+      p++;
+   }
+
+   *ptr_text = p;
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Writes a group's count, credits, debits, smallest, and largest
+ * amounts, each followed by a '|', the way parse_rollup_numbers()
+ * reads them
+ *
+ */
+void write_rollup_numbers(char *text, const struct rollup *group)
+{
+   CENTS numbers[5];
+   int i;
+
+   numbers[0] = group->count;
+   numbers[1] = group->credits;
+   numbers[2] = group->debits;
+   numbers[3] = group->extremes_known ? group->smallest : UNKNOWN_CENTS;
+   numbers[4] = group->extremes_known ? group->largest : UNKNOWN_CENTS;
+
+   for(i = 0; i < 5; i++)
+   {
+      text = write_cents(text, numbers[i]);
+      *text++ = '|';
+   }
+
+   *text = '\0';
+}
+
+
+
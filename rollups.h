@@ -0,0 +1,103 @@
+/*
+ *
+ * Name:       rollups.h
+ *
+ * Purpose:    Contains function prototypes for keeping totals of the
+ *             budget by month and by description.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef ROLLUPS_H
+#define ROLLUPS_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/*
+ * Each month, and each description, has a group with the number of
+ * transactions in it, their total credits and debits, and the smallest
+ * and largest amount. Descriptions are grouped without regard to case
+ * or extra spaces.
+ *
+ * The ID index calls these as transactions are added and removed, like
+ * the balance.
+ */
+void add_to_rollups(const struct transaction *node);
+void remove_from_rollups(const struct transaction *node);
+
+/*
+ * Reads the groups saved in ROLLUP_FILE_NAME, if they were saved with
+ * the budget file as it is now. Returns FALSE if they weren't, and the
+ * groups have to be added up from the transactions as they load.
+ */
+BOOL read_rollups(const char *budget_file_name);
+
+/*
+ * While paused, the groups aren't changed, so the transactions the
+ * saved groups already count can be loaded without counting them twice
+ */
+void pause_rollups(BOOL paused);
+
+/*
+ * Saves the groups with the size, time, and inode of the budget file
+ * that was just written. They are only a copy of what the budget holds, so if
+ * they can't be saved, they are added up again on the next load.
+ */
+void write_rollups(const char *budget_file_name);
+
+/*
+ * Adds up every group from the transactions in the store, on as many
+ * threads as set_rollup_threads() asked for, or one for each processor
+ * if it wasn't called. Loading uses this instead of adding each
+ * transaction as it is indexed, when the saved groups can't be used.
+ * If we run out of memory, the groups are added up again before the
+ * next report.
+ */
+void set_rollup_threads(int threads);
+void add_up_rollups(const struct transaction_store *store);
+
+/*
+ * How many threads add_up_rollups() uses, which the other reports that
+ * run on several threads use too, and the time on the clock on the
+ * wall in seconds, for timing them
+ */
+int choose_rollup_threads(void);
+double wall_clock_seconds(void);
+
+/*
+ * Times adding up the groups one transaction at a time against
+ * add_up_rollups() on more and more threads, checks that they agree,
+ * and prints the times
+ */
+int print_rollup_benchmark(const struct transaction_store *store);
+
+/* FALSE if the groups changed since they were read or written */
+BOOL rollup_file_matches(void);
+
+/*
+ * Print the groups by month in order, or by description in order.
+ * Adding a transaction keeps the smallest and largest amounts, but
+ * removing the smallest or largest one can't know the next, so the
+ * groups that lost one are fixed with one pass over the store first.
+ */
+int print_month_rollups(const struct transaction_store *store);
+int print_description_rollups(const struct transaction_store *store);
+
+void free_rollups(void);
+
+#endif
+
+
+
@@ -0,0 +1,842 @@
+/*
+ *
+ * Name:       search_index.c
+ *
+ * Purpose:    Contains functions for finding the transactions whose
+ *             descriptions contain some words.
+ *
+ *             Each word that appears in a description has a list of
+ *             the IDs of the transactions it appears in, sorted from
+ *             lowest to highest, and the words themselves are kept in
+ *             sorted order. A word is found with a binary search, the
+ *             words starting with some letters are next to each other,
+ *             and the lists of several words are intersected starting
+ *             with the shortest, so a search doesn't read the budget.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <ctype.h>
+#include "search_index.h"
+
+/* The ID list of a new word starts with room for this many */
+#define MIN_SEARCH_IDS 2
+
+/* The hash table used while building starts with this many slots */
+#define MIN_BUILD_SLOTS 1024
+
+/*
+ * One word and the IDs of the transactions it appears in. text points
+ * just past the structure, in the same allocation.
+ */
+struct search_word
+{
+   int *ids;
+   long number_of_ids;
+   long capacity;
+   char *text;
+};
+
+/* The IDs that match one word of a query */
+struct search_term
+{
+   const int *ids;
+   long number_of_ids;
+
+   /* TRUE if ids was allocated for this term, and has to be freed */
+   BOOL allocated;
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+int next_word(const char **ptr_text, char *word);
+struct search_word *new_search_word(const char *text);
+void free_search_word(struct search_word *word);
+BOOL append_id(struct search_word *word, int id);
+BOOL insert_id(struct search_word *word, int id);
+void delete_id(struct search_word *word, int id);
+long find_word_position(const char *text);
+BOOL insert_word(struct search_word *word, long position);
+void delete_word(long position);
+unsigned long hash_word(const char *text);
+int compare_ids(const void *a, const void *b);
+int compare_words(const void *a, const void *b);
+int compare_terms(const void *a, const void *b);
+BOOL find_term(const char *text, BOOL prefix, struct search_term *term);
+BOOL contains_id(const int *ids, long number_of_ids, int id);
+
+/* Every word, in order */
+static struct search_word **words = NULL;
+static long number_of_words = 0;
+static long word_capacity = 0;
+static BOOL index_built = FALSE;
+
+
+
+int build_search_index(const struct transaction_store *store)
+{
+   struct search_word **table;
+   struct search_word **bigger;
+   struct store_cursor cursor;
+   struct transaction *p;
+   const char *text;
+   char word[DESCRIPTION_LENGTH + 1];
+   unsigned long number_of_slots = MIN_BUILD_SLOTS;
+   unsigned long i;
+   unsigned long j;
+   long k;
+   BOOL out_of_memory = FALSE;
+
+   if(index_built)
+   {
+      return 0;
+   }
+
+   /*
+    * A hash table finds each word while the index is built, and the
+    * words are sorted once at the end, instead of being inserted into
+    * the sorted array one at a time.
+    */
+   table = calloc(number_of_slots, sizeof(struct search_word *));
+   if(table == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = first_transaction(store, &cursor); p != NULL && !out_of_memory;
+      p = next_transaction(&cursor))
+   {
+      text = p->description;
+
+      while(!out_of_memory && next_word(&text, word) > 0)
+      {
+         i = hash_word(word) & (number_of_slots - 1);
+         while(table[i] != NULL && strcmp(table[i]->text, word) != 0)
+         {
+            i = (i + 1) & (number_of_slots - 1);
+         }
+
+         if(table[i] == NULL)
+         {
+            table[i] = new_search_word(word);
+            if(table[i] == NULL)
+            {
+               out_of_memory = TRUE;
+               break;
+            }
+
+            number_of_words++;
+         }
+
+         /* The IDs are sorted at the end, since the store may not be */
+         if(!append_id(table[i], p->id))
+         {
+            out_of_memory = TRUE;
+            break;
+         }
+
+         if((unsigned long) number_of_words * 2 <= number_of_slots)
+         {
+            continue;
+         }
+
+         bigger = calloc(number_of_slots * 2, sizeof(struct search_word *));
+         if(bigger == NULL)
+         {
+            out_of_memory = TRUE;
+            break;
+         }
+
+         for(i = 0; i < number_of_slots; i++)
+         {
+            if(table[i] == NULL)
+            {
+               continue;
+            }
+
+            j = hash_word(table[i]->text) & (number_of_slots * 2 - 1);
+            while(bigger[j] != NULL)
+            {
+               j = (j + 1) & (number_of_slots * 2 - 1);
+            }
+
+            bigger[j] = table[i];
+         }
+
+         free(table);
+         table = bigger;
+         number_of_slots *= 2;
+      }
+   }
+
+   words = malloc(sizeof(struct search_word *)
+      * (size_t) (number_of_words + 1));
+
+   if(out_of_memory || words == NULL)
+   {
+      for(i = 0; i < number_of_slots; i++)
+      {
+         if(table[i] != NULL)
+         {
+            free_search_word(table[i]);
+         }
+      }
+
+      free(table);
+      free(words);
+      words = NULL;
+      number_of_words = 0;
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   k = 0;
+   for(i = 0; i < number_of_slots; i++)
+   {
+      if(table[i] != NULL)
+      {
+         words[k++] = table[i];
+      }
+   }
+
+   free(table);
+
+   qsort(words, (size_t) number_of_words, sizeof(struct search_word *),
+      compare_words);
+
+   /* The store may not be in order of ID, as in the sharded budget */
+   for(k = 0; k < number_of_words; k++)
+   {
+      for(i = 1; i < (unsigned long) words[k]->number_of_ids; i++)
+      {
+         if(words[k]->ids[i - 1] > words[k]->ids[i])
+         {
+            qsort(words[k]->ids, (size_t) words[k]->number_of_ids,
+               sizeof(int), compare_ids);
+            break;
+         }
+      }
+   }
+
+   word_capacity = number_of_words + 1;
+   index_built = TRUE;
+
+   return 0;
+}
+
+
+
+void add_to_search_index(const struct transaction *node)
+{
+   struct search_word *word;
+   const char *text = node->description;
+   char word_text[DESCRIPTION_LENGTH + 1];
+   long position;
+
+   if(!index_built)
+   {
+      return;
+   }
+
+   while(next_word(&text, word_text) > 0)
+   {
+      position = find_word_position(word_text);
+
+      if(position < number_of_words
+         && strcmp(words[position]->text, word_text) == 0)
+      {
+         word = words[position];
+      }
+      else
+      {
+         word = new_search_word(word_text);
+         if(word == NULL || !insert_word(word, position))
+         {
+            free_search_word(word);
+            free_search_index();
+            return;
+         }
+      }
+
+      if(!insert_id(word, node->id))
+      {
+         free_search_index();
+         return;
+      }
+   }
+}
+
+
+
+void remove_from_search_index(const struct transaction *node)
+{
+   const char *text = node->description;
+   char word_text[DESCRIPTION_LENGTH + 1];
+   long position;
+
+   if(!index_built)
+   {
+      return;
+   }
+
+   while(next_word(&text, word_text) > 0)
+   {
+      position = find_word_position(word_text);
+
+      if(position == number_of_words
+         || strcmp(words[position]->text, word_text) != 0)
+      {
+         continue;
+      }
+
+      delete_id(words[position], node->id);
+
+      if(words[position]->number_of_ids == 0)
+      {
+         delete_word(position);
+      }
+   }
+}
+
+
+
+long search_transactions(const char *query, int **ptr_ids)
+{
+   struct search_term terms[MAX_SEARCH_TERMS];
+   char word[DESCRIPTION_LENGTH + 1];
+   int *ids;
+   long number_of_ids;
+   long i;
+   int number_of_terms = 0;
+   int t;
+   BOOL out_of_memory = FALSE;
+
+   *ptr_ids = NULL;
+
+   /* Find the IDs of each word on its own first */
+   while(number_of_terms < MAX_SEARCH_TERMS && next_word(&query, word) > 0)
+   {
+      if(!find_term(word, *query == '*', &terms[number_of_terms]))
+      {
+         out_of_memory = TRUE;
+         break;
+      }
+
+      number_of_terms++;
+
+      if(terms[number_of_terms - 1].number_of_ids == 0)
+      {
+         break;
+      }
+   }
+
+   number_of_ids = 0;
+   ids = NULL;
+
+   if(!out_of_memory && number_of_terms > 0)
+   {
+      /*
+       * Start with the shortest list, and only keep the IDs that are
+       * in every other one, so the result never grows
+       */
+      qsort(terms, (size_t) number_of_terms, sizeof(struct search_term),
+         compare_terms);
+
+      ids = malloc(sizeof(int) * (size_t) (terms[0].number_of_ids + 1));
+      if(ids == NULL)
+      {
+         out_of_memory = TRUE;
+      }
+      else
+      {
+         for(i = 0; i < terms[0].number_of_ids; i++)
+         {
+            for(t = 1; t < number_of_terms; t++)
+            {
+               if(!contains_id(terms[t].ids, terms[t].number_of_ids,
+                  terms[0].ids[i]))
+               {
+                  break;
+               }
+            }
+
+            if(t == number_of_terms)
+            {
+               ids[number_of_ids++] = terms[0].ids[i];
+            }
+         }
+      }
+   }
+
+   for(t = 0; t < number_of_terms; t++)
+   {
+      if(terms[t].allocated)
+      {
+         free((void *) terms[t].ids);
+      }
+   }
+
+   if(out_of_memory)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   *ptr_ids = ids;
+
+   return number_of_ids;
+}
+
+
+
+void free_search_index(void)
+{
+   long i;
+
+   for(i = 0; i < number_of_words; i++)
+   {
+      free_search_word(words[i]);
+   }
+
+   free(words);
+   words = NULL;
+   number_of_words = 0;
+   word_capacity = 0;
+   index_built = FALSE;
+}
+
+
+
+/*
+ *
+ * Copies the next word of the text into word, in lower case, and moves
+ * *ptr_text just past it. Returns the length of the word, or 0 when
+ * there are no more words.
+ *
+ */
+int next_word(const char **ptr_text, char *word)
+{
+   const unsigned char *p = (const unsigned char *) *ptr_text;
+   int length = 0;
+
+   while(*p != '\0' && !isalnum(*p))
+   {
+      p++;
+   }
+
+   while(*p != '\0' && isalnum(*p) && length < DESCRIPTION_LENGTH)
+   {
+      word[length++] = (char) tolower(*p);
+      p++;
+   }
+
+   word[length] = '\0';
+   *ptr_text = (const char *) p;
+
+   return length;
+}
+
+
+
+struct search_word *new_search_word(const char *text)
+{
+   struct search_word *word;
+
+   word = malloc(sizeof(struct search_word) + strlen(text) + 1);
+   if(word == NULL)
+   {
+      return NULL;
+   }
+
+   word->ids = malloc(sizeof(int) * MIN_SEARCH_IDS);
+   if(word->ids == NULL)
+   {
+      free(word);
+      return NULL;
+   }
+
+   word->number_of_ids = 0;
+   word->capacity = MIN_SEARCH_IDS;
+   word->text = (char *) (word + 1);
+   strcpy(word->text, text);
+
+   return word;
+}
+
+
+
+void free_search_word(struct search_word *word)
+{
+   if(word != NULL)
+   {
+      free(word->ids);
+      free(word);
+   }
+}
+
+
+
+/*
+ *
+ * Adds an ID to the end of a word's list, unless it is already the
+ * last one there (the word appears twice in one description)
+ *
+ */
+BOOL append_id(struct search_word *word, int id)
+{
+   int *bigger;
+
+   if(word->number_of_ids > 0 && word->ids[word->number_of_ids - 1] == id)
+   {
+      return TRUE;
+   }
+
+   if(word->number_of_ids == word->capacity)
+   {
+      bigger = realloc(word->ids, sizeof(int) * (size_t) word->capacity * 2);
+      if(bigger == NULL)
+      {
+         return FALSE;
+      }
+
+      word->ids = bigger;
+      word->capacity *= 2;
+   }
+
+   word->ids[word->number_of_ids++] = id;
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Adds an ID in its place in a word's sorted list. New transactions
+ * have the highest ID, so this is almost always an append.
+ *
+ */
+BOOL insert_id(struct search_word *word, int id)
+{
+   long low = 0;
+   long high = word->number_of_ids;
+   long middle;
+
+   if(high == 0 || word->ids[high - 1] <= id)
+   {
+      return append_id(word, id);
+   }
+
+   while(low < high)
+   {
+      middle = low + (high - low) / 2;
+
+      if(word->ids[middle] < id)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+
+   if(word->ids[low] == id)
+   {
+      return TRUE;
+   }
+
+   /* Make room at the end, then slide the higher IDs up one */
+   if(!append_id(word, id))
+   {
+      return FALSE;
+   }
+
+   memmove(&word->ids[low + 1], &word->ids[low],
+      sizeof(int) * (size_t) (word->number_of_ids - 1 - low));
+   word->ids[low] = id;
+
+   return TRUE;
+}
+
+
+
+void delete_id(struct search_word *word, int id)
+{
+   long low = 0;
+   long high = word->number_of_ids;
+   long middle;
+
+   while(low < high)
+   {
+      middle = low + (high - low) / 2;
+
+      if(word->ids[middle] < id)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+
+   if(low < word->number_of_ids && word->ids[low] == id)
+   {
+      memmove(&word->ids[low], &word->ids[low + 1],
+         sizeof(int) * (size_t) (word->number_of_ids - 1 - low));
+      word->number_of_ids--;
+   }
+}
+
+
+
+/*
+ *
+ * Returns the position of the first word that isn't before text,
+ * which is number_of_words if they all are
+ *
+ */
+long find_word_position(const char *text)
+{
+   long low = 0;
+   long high = number_of_words;
+   long middle;
+
+   while(low < high)
+   {
+      middle = low + (high - low) / 2;
+
+      if(strcmp(words[middle]->text, text) < 0)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+
+   return low;
+}
+
+
+
+BOOL insert_word(struct search_word *word, long position)
+{
+   struct search_word **bigger;
+
+   if(number_of_words == word_capacity)
+   {
+      bigger = realloc(words, sizeof(struct search_word *)
+         * (size_t) (word_capacity * 2 + 1));
+      if(bigger == NULL)
+      {
+         return FALSE;
+      }
+
+      words = bigger;
+      word_capacity = word_capacity * 2 + 1;
+   }
+
+   memmove(&words[position + 1], &words[position],
+      sizeof(struct search_word *) * (size_t) (number_of_words - position));
+   words[position] = word;
+   number_of_words++;
+
+   return TRUE;
+}
+
+
+
+void delete_word(long position)
+{
+   free_search_word(words[position]);
+
+   memmove(&words[position], &words[position + 1],
+      sizeof(struct search_word *)
+         * (size_t) (number_of_words - 1 - position));
+   number_of_words--;
+}
+
+
+
+/*
+ *
+ * The same string hash as the description pool
+ *
+ */
+unsigned long hash_word(const char *text)
+{
+   unsigned long hash = 5381;
+
+   while(*text != '\0')
+   {
+      hash = hash * 33 + (unsigned char) *text++;
+   }
+
+   return hash;
+}
+
+
+
+int compare_ids(const void *a, const void *b)
+{
+   int id_a = *(const int *) a;
+   int id_b = *(const int *) b;
+
+   return id_a < id_b ? -1 : id_a > id_b;
+}
+
+
+
+int compare_words(const void *a, const void *b)
+{
+   const struct search_word *word_a = *(struct search_word * const *) a;
+   const struct search_word *word_b = *(struct search_word * const *) b;
+
+   return strcmp(word_a->text, word_b->text);
+}
+
+
+
+int compare_terms(const void *a, const void *b)
+{
+   const struct search_term *term_a = a;
+   const struct search_term *term_b = b;
+
+   return term_a->number_of_ids < term_b->number_of_ids ? -1
+      : term_a->number_of_ids > term_b->number_of_ids;
+}
+
+
+
+/*
+ *
+ * Sets term to the IDs of the transactions that contain the word, or
+ * any word that starts with it if prefix is TRUE. Several words' lists
+ * are merged into one new list. Returns FALSE if we run out of memory.
+ *
+ */
+BOOL find_term(const char *text, BOOL prefix, struct search_term *term)
+{
+   size_t length = strlen(text);
+   long first = find_word_position(text);
+   long last = first;
+   long number_of_ids = 0;
+   long i;
+   long j;
+   int *ids;
+
+   term->ids = NULL;
+   term->number_of_ids = 0;
+   term->allocated = FALSE;
+
+   if(prefix)
+   {
+      while(last < number_of_words
+         && strncmp(words[last]->text, text, length) == 0)
+      {
+         number_of_ids += words[last]->number_of_ids;
+         last++;
+      }
+   }
+   else if(last < number_of_words && strcmp(words[last]->text, text) == 0)
+   {
+      number_of_ids = words[last]->number_of_ids;
+      last++;
+   }
+
+   /* Zero or one word needs no copy */
+   if(last - first <= 1)
+   {
+      if(last > first)
+      {
+         term->ids = words[first]->ids;
+         term->number_of_ids = words[first]->number_of_ids;
+      }
+
+      return TRUE;
+   }
+
+   ids = malloc(sizeof(int) * (size_t) number_of_ids);
+   if(ids == NULL)
+   {
+      return FALSE;
+   }
+
+   number_of_ids = 0;
+   for(i = first; i < last; i++)
+   {
+      memcpy(&ids[number_of_ids], words[i]->ids,
+         sizeof(int) * (size_t) words[i]->number_of_ids);
+      number_of_ids += words[i]->number_of_ids;
+   }
+
+   qsort(ids, (size_t) number_of_ids, sizeof(int), compare_ids);
+
+   /* One description can have more than one of the words */
+   j = 0;
+   for(i = 0; i < number_of_ids; i++)
+   {
+      if(j == 0 || ids[j - 1] != ids[i])
+      {
+         ids[j++] = ids[i];
+      }
+   }
+
+   term->ids = ids;
+   term->number_of_ids = j;
+   term->allocated = TRUE;
+
+   return TRUE;
+}
+
+
+
+BOOL contains_id(const int *ids, long number_of_ids, int id)
+{
+   long low = 0;
+   long high = number_of_ids;
+   long middle;
+
+   while(low < high)
+   {
+      middle = low + (high - low) / 2;
+
+      if(ids[middle] < id)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle;
+      }
+   }
+
+   return low < number_of_ids && ids[low] == id;
+}
+
+
+
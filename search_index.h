@@ -0,0 +1,66 @@
+/*
+ *
+ * Name:       search_index.h
+ *
+ * Purpose:    Contains function prototypes for finding the transactions
+ *             whose descriptions contain some words.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/*
+ * A word is a run of letters and digits, so a description of
+ * DESCRIPTION_LENGTH characters can't have more words than this
+ */
+#define MAX_SEARCH_TERMS (DESCRIPTION_LENGTH / 2 + 1)
+
+/*
+ * Builds the index from every transaction in the store, unless it is
+ * already built. Like the date index, it is only built the first time
+ * it is needed. Returns FILE_OPS_ERROR if we run out of memory.
+ */
+int build_search_index(const struct transaction_store *store);
+
+/*
+ * Keep a built index up to date as transactions are added, removed,
+ * or given a new description. They do nothing before the index is
+ * built. If we run out of memory, the index is dropped, to be built
+ * again the next time it is needed.
+ */
+void add_to_search_index(const struct transaction *node);
+void remove_from_search_index(const struct transaction *node);
+
+/*
+ * Finds the transactions whose descriptions contain every word of the
+ * query, ignoring case. A word ending in * matches any word that starts
+ * with it. The index must be built.
+ *
+ * Sets *ptr_ids to a new array of their IDs, from lowest to highest,
+ * which the caller frees, and returns how many there are. Returns
+ * FILE_OPS_ERROR if we run out of memory.
+ */
+long search_transactions(const char *query, int **ptr_ids);
+
+void free_search_index(void);
+
+#endif
+
+
+
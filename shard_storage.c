@@ -0,0 +1,922 @@
+/*
+ *
+ * Name:       shard_storage.c
+ *
+ * Purpose:    Contains functions for saving the budget in one file
+ *             per month, and loading each month only when it is
+ *             needed.
+ *
+ *             Starting up only reads the current month. Another month
+ *             is read when a transaction is created in it, or when
+ *             the user asks to see or change the whole budget. A
+ *             change rewrites just the months it touched.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <time.h>
+#include <ctype.h>
+#include "shard_storage.h"
+#include "file_operations.h"
+#include "background_save.h"
+#include "conversions.h"
+#include "transaction_index.h"
+#include "balance.h"
+#include "read_input.h"
+
+/*
+ * One month of the budget. Months are numbered year * 12 + month - 1,
+ * so they sort in order, and transactions remember which one they
+ * are saved in.
+ */
+struct shard
+{
+   int month;
+   int number_of_transactions;
+   BOOL loaded;
+   BOOL changed;
+   
+   /* Where this month's transactions start in the array we save from */
+   long first_node;
+   
+   /*
+    * The month's totals, as saved in the index, so the balance doesn't
+    * need the months that aren't loaded. Indexes saved before there
+    * were totals don't have them.
+    */
+   CENTS credits;
+   CENTS debits;
+   BOOL totals_known;
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void get_shard_file_name(int month, char *file_name);
+struct shard *find_shard(int month);
+struct shard *add_shard(int month);
+void remove_from_shard(int month);
+void set_shard_totals(struct shard *shard, CENTS credits, CENTS debits);
+int load_shard(struct shard *shard, struct transaction_store *month);
+int read_shard_index(void);
+int write_shard_index(void);
+int split_budget_file(struct transaction_store *budget);
+
+/*
+ * The months that have a file, sorted by month. shard_index_changed
+ * tells us a month was added or emptied, or its totals changed, so the
+ * index file needs to be rewritten on the next save. The index also holds the next ID,
+ * and saved_next_id is the one it holds now.
+ */
+static BOOL sharded_mode = FALSE;
+static struct shard *shards = NULL;
+static int number_of_shards = 0;
+static int shard_capacity = 0;
+static BOOL shard_index_changed = FALSE;
+static long saved_next_id = 0;
+
+
+
+void set_sharded_mode(BOOL enabled)
+{
+   sharded_mode = enabled;
+}
+
+
+
+BOOL sharded_mode_enabled(void)
+{
+   return sharded_mode;
+}
+
+
+
+/*
+ *
+ * Loads the current month of the budget
+ *
+ * If there is no index yet, budget.txt has never been split into
+ * months, so we do that first. All of it is loaded in that case.
+ *
+ */
+int load_sharded_budget(struct transaction_store *budget)
+{
+   time_t now;
+   struct tm *today;
+   struct shard *shard;
+   struct transaction_store month;
+   int number_of_transactions = 0;
+   int result;
+   int i;
+
+   init_store(budget);
+
+   if(!file_exists(SHARD_INDEX_FILE_NAME))
+   {
+      return split_budget_file(budget);
+   }
+
+   if(read_shard_index() == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   now = time(NULL);
+   today = localtime(&now);
+
+   shard = find_shard((today->tm_year + 1900) * 12 + today->tm_mon);
+   if(shard != NULL)
+   {
+      number_of_transactions = load_shard(shard, budget);
+      if(number_of_transactions == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   /*
+    * The balance needs the totals of every month, so a month saved
+    * before its totals were is loaded once, and its totals are saved
+    * in the index the next time it is written
+    */
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].loaded && !shards[i].totals_known)
+      {
+         result = load_shard(&shards[i], &month);
+         if(result == FILE_OPS_ERROR)
+         {
+            free_store(budget);
+            return FILE_OPS_ERROR;
+         }
+
+         append_store(budget, &month);
+         number_of_transactions += result;
+      }
+   }
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Loads every month that isn't loaded yet
+ *
+ * Displaying, updating, and deleting show the whole budget, and the
+ * ID the user picks may be in any month, so they need every month.
+ *
+ */
+int load_all_shards(struct transaction_store *budget,
+   int *number_of_transactions)
+{
+   struct transaction_store month;
+   int i;
+
+   if(!sharded_mode)
+   {
+      return 0;
+   }
+
+   lock_budget();
+
+   *number_of_transactions = 0;
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].loaded)
+      {
+         if(load_shard(&shards[i], &month) == FILE_OPS_ERROR)
+         {
+            unlock_budget();
+            return FILE_OPS_ERROR;
+         }
+
+         append_store(budget, &month);
+      }
+
+      *number_of_transactions += shards[i].number_of_transactions;
+   }
+
+   unlock_budget();
+
+   return 0;
+}
+
+
+
+void add_unloaded_shard_totals(CENTS *credits, CENTS *debits)
+{
+   int i;
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].loaded)
+      {
+         *credits += shards[i].credits;
+         *debits += shards[i].debits;
+      }
+   }
+}
+
+
+
+/*
+ *
+ * Marks the month a created or updated transaction is in as changed.
+ * If an update moved it to another month, the month it was in before
+ * is changed too.
+ *
+ * A month must be loaded before it can be rewritten, or the rest of
+ * its transactions would be lost, so we load it here if needed.
+ *
+ */
+int shard_transaction_changed(struct transaction_store *budget,
+   struct transaction *node)
+{
+   struct transaction_store month_store;
+   struct shard *shard;
+   int month = day_number_to_month(node->day);
+
+   lock_budget();
+
+   shard = find_shard(month);
+   if(shard == NULL)
+   {
+      shard = add_shard(month);
+      if(shard == NULL)
+      {
+         unlock_budget();
+         printf("\nMemory allocation error.\n");
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   if(!shard->loaded)
+   {
+      if(load_shard(shard, &month_store) == FILE_OPS_ERROR)
+      {
+         unlock_budget();
+         return FILE_OPS_ERROR;
+      }
+
+      append_store(budget, &month_store);
+   }
+
+   shard->changed = TRUE;
+
+   if(node->shard != month)
+   {
+      shard->number_of_transactions++;
+
+      remove_from_shard(node->shard);
+
+      node->shard = month;
+   }
+
+   unlock_budget();
+
+   return 0;
+}
+
+
+
+void shard_transaction_removed(int shard)
+{
+   lock_budget();
+   remove_from_shard(shard);
+   unlock_budget();
+}
+
+
+
+void remove_from_shard(int month)
+{
+   struct shard *shard = find_shard(month);
+
+   if(shard == NULL)
+   {
+      return;
+   }
+
+   shard->changed = TRUE;
+   shard->number_of_transactions--;
+
+   if(shard->number_of_transactions == 0)
+   {
+      shard_index_changed = TRUE;
+   }
+}
+
+
+
+/*
+ *
+ * Keeps a month's totals, and marks the index to be written again
+ * if they aren't the ones it holds
+ *
+ */
+void set_shard_totals(struct shard *shard, CENTS credits, CENTS debits)
+{
+   if(!shard->totals_known || shard->credits != credits
+      || shard->debits != debits)
+   {
+      shard->credits = credits;
+      shard->debits = debits;
+      shard->totals_known = TRUE;
+      shard_index_changed = TRUE;
+   }
+}
+
+
+
+/*
+ *
+ * Rewrites each month that changed since the last save
+ *
+ * One pass over the store gathers the transactions of every changed
+ * month into an array, grouped by month, so saving many months
+ * doesn't read the whole store once for each of them.
+ *
+ * The index is written first, so a new month is listed before its
+ * file exists. If we crash in between, load_shard() treats the missing
+ * file as an empty month. An emptied month is taken out of the index
+ * before its file is removed, for the same reason. The index also
+ * holds each month's totals, so it is written again whenever the
+ * totals of a month changed.
+ *
+ */
+int save_changed_shards(struct transaction_store *budget)
+{
+   char file_name[SHARD_FILE_NAME_LENGTH];
+   struct transaction **nodes;
+   struct store_cursor cursor;
+   struct transaction *p;
+   struct shard *shard;
+   long number_of_nodes = 0;
+   long *next_node;
+   long j;
+   CENTS credits;
+   CENTS debits;
+   int i;
+   int kept = 0;
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(shards[i].changed)
+      {
+         shards[i].first_node = number_of_nodes;
+         number_of_nodes += shards[i].number_of_transactions;
+      }
+   }
+
+   nodes = malloc((number_of_nodes + 1) * sizeof(struct transaction *));
+   next_node = malloc((number_of_shards + 1) * sizeof(long));
+   if(nodes == NULL || next_node == NULL)
+   {
+      free(nodes);
+      free(next_node);
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      next_node[i] = shards[i].first_node;
+   }
+
+   for(p = first_transaction(budget, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      shard = find_shard(p->shard);
+
+      if(shard != NULL && shard->changed && next_node[shard - shards]
+         < shard->first_node + shard->number_of_transactions)
+      {
+         nodes[next_node[shard - shards]++] = p;
+      }
+   }
+
+   free(next_node);
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].changed)
+      {
+         continue;
+      }
+
+      credits = 0;
+      debits = 0;
+
+      for(j = shards[i].first_node;
+         j < shards[i].first_node + shards[i].number_of_transactions; j++)
+      {
+         if(nodes[j]->type == CREDIT_TYPE)
+         {
+            credits += nodes[j]->amount;
+         }
+         else
+         {
+            debits += nodes[j]->amount;
+         }
+      }
+
+      set_shard_totals(&shards[i], credits, debits);
+   }
+
+   /* A new ID has to be saved before a month that uses it */
+   if((shard_index_changed || get_next_transaction_id() != saved_next_id)
+      && write_shard_index() == FILE_OPS_ERROR)
+   {
+      free(nodes);
+      return FILE_OPS_ERROR;
+   }
+
+   shard_index_changed = FALSE;
+
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].changed)
+      {
+         continue;
+      }
+
+      get_shard_file_name(shards[i].month, file_name);
+
+      if(shards[i].number_of_transactions == 0)
+      {
+         remove(file_name);
+      }
+      else if(write_transaction_array(TEMP_FILE_NAME,
+         nodes + shards[i].first_node, shards[i].number_of_transactions)
+            == FILE_OPS_ERROR
+         || replace_file(TEMP_FILE_NAME, file_name) == FILE_OPS_ERROR)
+      {
+         free(nodes);
+         return FILE_OPS_ERROR;
+      }
+
+      shards[i].changed = FALSE;
+   }
+
+   free(nodes);
+
+   /* Emptied months don't have a file anymore */
+   for(i = 0; i < number_of_shards; i++)
+   {
+      if(!shards[i].loaded || shards[i].number_of_transactions > 0)
+      {
+         shards[kept++] = shards[i];
+      }
+   }
+
+   number_of_shards = kept;
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * file_name must have room for SHARD_FILE_NAME_LENGTH characters
+ *
+ */
+void get_shard_file_name(int month, char *file_name)
+{
+   sprintf(file_name, "budget_%04d_%02d.txt", month / 12, month % 12 + 1);
+}
+
+
+
+/*
+ *
+ * Returns the shard for the given month, or NULL if that month
+ * doesn't have a file
+ *
+ */
+struct shard *find_shard(int month)
+{
+   int low = 0;
+   int high = number_of_shards - 1;
+   int middle;
+
+   while(low <= high)
+   {
+      middle = (low + high) / 2;
+
+      if(shards[middle].month == month)
+      {
+         return &shards[middle];
+      }
+
+      if(shards[middle].month < month)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle - 1;
+      }
+   }
+
+   return NULL;
+}
+
+
+
+/*
+ *
+ * Adds an empty, loaded month in its place in the list of shards.
+ * This may move the list, so pointers from find_shard() must be
+ * looked up again afterward.
+ *
+ */
+struct shard *add_shard(int month)
+{
+   struct shard *bigger;
+   int i;
+
+   if(number_of_shards == shard_capacity)
+   {
+      shard_capacity = shard_capacity == 0 ? 16 : shard_capacity * 2;
+
+      bigger = realloc(shards, shard_capacity * sizeof(struct shard));
+      if(bigger == NULL)
+      {
+         return NULL;
+      }
+
+      shards = bigger;
+   }
+
+   for(i = number_of_shards; i > 0 && shards[i - 1].month > month; i--)
+   {
+      shards[i] = shards[i - 1];
+   }
+
+   shards[i].month = month;
+   shards[i].number_of_transactions = 0;
+   shards[i].loaded = TRUE;
+   shards[i].changed = FALSE;
+   shards[i].credits = 0;
+   shards[i].debits = 0;
+   shards[i].totals_known = TRUE;
+
+   number_of_shards++;
+   shard_index_changed = TRUE;
+
+   return &shards[i];
+}
+
+
+
+/*
+ *
+ * Reads one month's file into a new store, and returns the number
+ * of transactions in it, or FILE_OPS_ERROR
+ *
+ * If any of them were saved without an ID, the month is marked as
+ * changed, so the IDs they get now are saved with them.
+ *
+ */
+int load_shard(struct shard *shard, struct transaction_store *month)
+{
+   char file_name[SHARD_FILE_NAME_LENGTH];
+   struct store_cursor cursor;
+   struct transaction *p;
+   CENTS credits = 0;
+   CENTS debits = 0;
+   int number_of_transactions = 0;
+   int ids_given;
+
+   init_store(month);
+
+   get_shard_file_name(shard->month, file_name);
+
+   if(file_exists(file_name))
+   {
+      number_of_transactions = load_transactions(file_name, month);
+      if(number_of_transactions == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   for(p = first_transaction(month, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      p->shard = shard->month;
+
+      if(p->type == CREDIT_TYPE)
+      {
+         credits += p->amount;
+      }
+      else
+      {
+         debits += p->amount;
+      }
+   }
+
+   /* The file is the truth, if the index doesn't agree with it */
+   set_shard_totals(shard, credits, debits);
+
+   ids_given = index_transactions(month, file_name);
+   if(ids_given == FILE_OPS_ERROR)
+   {
+      free_store(month);
+      return FILE_OPS_ERROR;
+   }
+
+   if(ids_given > 0)
+   {
+      shard->changed = TRUE;
+   }
+
+   shard->number_of_transactions = number_of_transactions;
+   shard->loaded = TRUE;
+
+   return number_of_transactions;
+}
+
+
+
+/*
+ *
+ * Reads the index of months. Each line holds a year, a month, and
+ * the month's total credits and debits, in cents:
+ *
+ *    yyyy|mm|credits|debits|
+ *
+ * The totals are missing from an index saved before there were any.
+ *
+ * except for one that holds the ID the next new transaction gets:
+ *
+ *    next_id|n|
+ *
+ */
+int read_shard_index(void)
+{
+   FILE *fp;
+   char line[MAX_TRANSACTION_LENGTH + 2];
+   char *p;
+   long year;
+   long month = 0;
+   long line_number = 0;
+   CENTS credits = 0;
+   CENTS debits = 0;
+   struct shard *shard;
+   BOOL totals_known;
+   BOOL valid_totals;
+   int i;
+
+   fp = fopen(SHARD_INDEX_FILE_NAME, "r");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for reading..\n\n", SHARD_INDEX_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   while(fgets(line, sizeof(line), fp) != NULL)
+   {
+      line_number++;
+
+      if(strncmp(line, "next_id|", 8) == 0)
+      {
+         saved_next_id = strtol(line + 8, &p, 10);
+         if(*p != '|' || saved_next_id < 1
+            || saved_next_id > MAX_TRANSACTION_ID + 1)
+         {
+            printf("\nLine %ld of %s is not a valid ID.\n", line_number,
+               SHARD_INDEX_FILE_NAME);
+            printf("\nThe program will exit so no data is lost.\n\n");
+            fclose(fp);
+            return FILE_OPS_ERROR;
+         }
+
+         set_next_transaction_id(saved_next_id);
+         continue;
+      }
+
+      year = strtol(line, &p, 10);
+      if(*p == '|')
+      {
+         month = strtol(p + 1, &p, 10);
+      }
+
+      /* No totals is fine, but half of them isn't */
+      totals_known = FALSE;
+      valid_totals = TRUE;
+      if(*p == '|' && isdigit((unsigned char) p[1]))
+      {
+         p = (char *) read_cents(p + 1, &credits);
+         if(p != NULL && *p == '|' && isdigit((unsigned char) p[1]))
+         {
+            p = (char *) read_cents(p + 1, &debits);
+            totals_known = p != NULL && *p == '|';
+         }
+
+         valid_totals = totals_known;
+      }
+
+      shard = NULL;
+      if(*p == '|' && valid_totals && year >= 1 && year < MAX_YEAR
+         && month >= 1 && month <= 12)
+      {
+         shard = find_shard((int) (year * 12 + month - 1));
+         if(shard == NULL)
+         {
+            shard = add_shard((int) (year * 12 + month - 1));
+         }
+      }
+
+      if(shard == NULL)
+      {
+         printf("\nLine %ld of %s is not a valid month.\n", line_number,
+            SHARD_INDEX_FILE_NAME);
+         printf("\nThe program will exit so no data is lost.\n\n");
+         fclose(fp);
+         return FILE_OPS_ERROR;
+      }
+
+      shard->credits = totals_known ? credits : 0;
+      shard->debits = totals_known ? debits : 0;
+      shard->totals_known = totals_known;
+   }
+
+   fclose(fp);
+
+   /* Nothing is loaded yet, and the index matches the file */
+   for(i = 0; i < number_of_shards; i++)
+   {
+      shards[i].loaded = FALSE;
+   }
+
+   shard_index_changed = FALSE;
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Writes the index of months that have transactions, and the next ID.
+ * A month that isn't loaded is kept, since we don't know that it is
+ * empty.
+ *
+ */
+int write_shard_index(void)
+{
+   FILE *fp;
+   long next_id = get_next_transaction_id();
+   char credits[CENTS_TEXT_LENGTH + 1];
+   char debits[CENTS_TEXT_LENGTH + 1];
+   int i;
+   int result;
+
+   fp = fopen(TEMP_SHARD_INDEX_FILE_NAME, "w");
+   if(fp == NULL)
+   {
+      printf("\nFile error.\n\n");
+      printf("Could not open %s for writing..\n\n",
+         TEMP_SHARD_INDEX_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   result = fprintf(fp, "next_id|%ld|\n", next_id);
+
+   for(i = 0; i < number_of_shards && result >= 0; i++)
+   {
+      if(shards[i].loaded && shards[i].number_of_transactions == 0)
+      {
+         continue;
+      }
+
+      if(shards[i].totals_known)
+      {
+         *write_cents(credits, shards[i].credits) = '\0';
+         *write_cents(debits, shards[i].debits) = '\0';
+         result = fprintf(fp, "%04d|%02d|%s|%s|\n", shards[i].month / 12,
+            shards[i].month % 12 + 1, credits, debits);
+      }
+      else
+      {
+         result = fprintf(fp, "%04d|%02d|\n", shards[i].month / 12,
+            shards[i].month % 12 + 1);
+      }
+   }
+
+   if(result < 0 || !sync_file(fp))
+   {
+      fclose(fp);
+      printf("\nFile error.\n\n");
+      printf("Could not write %s.\n\n", TEMP_SHARD_INDEX_FILE_NAME);
+      return FILE_OPS_ERROR;
+   }
+
+   fclose(fp);
+
+   if(replace_file(TEMP_SHARD_INDEX_FILE_NAME, SHARD_INDEX_FILE_NAME)
+      == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   saved_next_id = next_id;
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Splits budget.txt into a file for each month, the first time the
+ * program runs in sharded mode
+ *
+ * budget.txt is only removed after every month and the index are
+ * on the disk.
+ *
+ */
+int split_budget_file(struct transaction_store *budget)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+   struct shard *shard;
+   int number_of_transactions;
+
+   number_of_transactions = load_transactions(FILE_NAME, budget);
+   if(number_of_transactions == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   if(index_transactions(budget, FILE_NAME) == FILE_OPS_ERROR)
+   {
+      free_store(budget);
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = first_transaction(budget, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      p->shard = day_number_to_month(p->day);
+
+      shard = find_shard(p->shard);
+      if(shard == NULL)
+      {
+         shard = add_shard(p->shard);
+      }
+
+      if(shard == NULL)
+      {
+         printf("\nMemory allocation error.\n");
+         printf("\nThe program will exit so no data is lost.\n\n");
+         free_store(budget);
+         return FILE_OPS_ERROR;
+      }
+
+      shard->number_of_transactions++;
+      shard->changed = TRUE;
+   }
+
+   shard_index_changed = TRUE;
+
+   if(save_changed_shards(budget) == FILE_OPS_ERROR
+      || remove(FILE_NAME) != 0)
+   {
+      free_store(budget);
+      return FILE_OPS_ERROR;
+   }
+
+   printf("\nSaved %d transactions from %s by month.\n",
+      number_of_transactions, FILE_NAME);
+
+   return number_of_transactions;
+}
+
+
+
@@ -0,0 +1,72 @@
+/*
+ *
+ * Name:       shard_storage.h
+ *
+ * Purpose:    Contains function prototypes for saving the budget in
+ *             one file per month, and loading each month only when
+ *             it is needed.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef SHARD_STORAGE_H
+#define SHARD_STORAGE_H
+#include "crud_operations.h"
+#include "boolean.h"
+
+/*
+ * Each month is saved in a file named like budget_2023_01.txt. The
+ * months that have a file are listed in SHARD_INDEX_FILE_NAME.
+ */
+#define SHARD_FILE_NAME_LENGTH 20
+
+void set_sharded_mode(BOOL enabled);
+BOOL sharded_mode_enabled(void);
+
+/*
+ * Loads the current month. The first time, budget.txt is split into
+ * months instead. Returns the number of transactions loaded, or
+ * FILE_OPS_ERROR.
+ */
+int load_sharded_budget(struct transaction_store *budget);
+
+/*
+ * Loads every month that isn't loaded yet onto the end of the store,
+ * and sets *number_of_transactions to the number in the store. Does
+ * nothing outside of sharded mode.
+ */
+int load_all_shards(struct transaction_store *budget,
+   int *number_of_transactions);
+
+/*
+ * Marks the months a created or updated transaction was and is now
+ * in as changed, loading the new month first if it isn't loaded
+ */
+int shard_transaction_changed(struct transaction_store *budget,
+   struct transaction *node);
+void shard_transaction_removed(int shard);
+
+/*
+ * Adds the saved totals of the months that aren't loaded, which the
+ * balance of the loaded transactions doesn't have
+ */
+void add_unloaded_shard_totals(CENTS *credits, CENTS *debits);
+
+/* Rewrites only the months that changed since the last save */
+int save_changed_shards(struct transaction_store *budget);
+
+#endif
+
+
+
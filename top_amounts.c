@@ -0,0 +1,489 @@
+/*
+ *
+ * Name:       top_amounts.c
+ *
+ * Purpose:    Contains functions for finding the largest or smallest
+ *             transactions of a type between two dates.
+ *
+ *             The K transactions kept so far are in a heap with the
+ *             one that would be dropped first at the top, so each
+ *             transaction that matches is compared with the top, and
+ *             only replaces it, in O(log K), if it ranks ahead of it.
+ *             The store is cut into runs of blocks, one for each
+ *             thread, and each thread keeps its own heap. The threads'
+ *             heaps are then merged into one more heap the same way.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The threads need the POSIX headers, which have to come before any
+ * other #include. Everywhere else, the store is read on one thread.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_PTHREADS
+#endif
+
+#include "top_amounts.h"
+#include "balance.h"
+#include "rollups.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/*
+ * The most threads a query runs on, and the fewest blocks of the store
+ * each one should get
+ */
+#define MAX_TOP_THREADS 64
+#define MIN_TOP_CHUNK_BLOCKS 64
+
+/* How many times the benchmark runs each way, and how many it finds */
+#define BENCHMARK_TOP_RUNS 10
+#define BENCHMARK_TOP_COUNT 20
+
+/* The transactions kept so far, with the one to drop first at items[0] */
+struct top_heap
+{
+   struct transaction **items;
+   long size;
+   const struct top_query *query;
+};
+
+/* A run of blocks of the store, and the heap of just its transactions */
+struct top_chunk
+{
+   struct store_block *first;
+   long number_of_blocks;
+
+   struct top_heap heap;
+
+#ifdef HAVE_PTHREADS
+   pthread_t thread;
+   BOOL started;
+#endif
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+long find_top_on_threads(const struct transaction_store *store,
+   const struct top_query *query, int threads, struct transaction **top);
+void *find_top_in_chunk(void *argument);
+BOOL ranks_ahead(const struct transaction *a, const struct transaction *b,
+   const struct top_query *query);
+void offer_to_heap(struct top_heap *heap, struct transaction *node);
+void sift_top_down(struct top_heap *heap, long i);
+long sort_to_find_top(const struct transaction_store *store,
+   const struct top_query *query, struct transaction **top);
+int compare_for_top(const void *a, const void *b);
+
+/* qsort() can't pass the query to compare_for_top(), so it is kept here */
+static const struct top_query *qsort_query = NULL;
+
+
+
+long find_top_transactions(const struct transaction_store *store,
+   const struct top_query *query, struct transaction **top)
+{
+   return find_top_on_threads(store, query, choose_rollup_threads(), top);
+}
+
+
+
+int print_top_benchmark(const struct transaction_store *store)
+{
+   struct transaction *sorted[BENCHMARK_TOP_COUNT];
+   struct transaction *top[BENCHMARK_TOP_COUNT];
+   struct top_query query;
+   double start;
+   long number_sorted = 0;
+   long number_found = 0;
+   long i;
+   int most_threads = choose_rollup_threads();
+   int threads;
+   int run;
+
+   /* "My 20 largest expenses" over every date */
+   query.count = BENCHMARK_TOP_COUNT;
+   query.largest = TRUE;
+   query.type = DEBIT_TYPE;
+   query.first_day = INVALID_DAY_NUMBER;
+   query.last_day = -INVALID_DAY_NUMBER;
+
+   printf("\nFinding the %d largest debits of %ld transactions:\n\n",
+      BENCHMARK_TOP_COUNT, store->number_of_transactions);
+
+   start = wall_clock_seconds();
+   for(run = 0; run < BENCHMARK_TOP_RUNS; run++)
+   {
+      number_sorted = sort_to_find_top(store, &query, sorted);
+      if(number_sorted == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   printf("   Sorting every debit: %.3f ms\n",
+      (wall_clock_seconds() - start) * 1000 / BENCHMARK_TOP_RUNS);
+
+   for(threads = 1; threads <= most_threads;
+      threads = threads < most_threads && threads * 2 > most_threads
+         ? most_threads : threads * 2)
+   {
+      start = wall_clock_seconds();
+      for(run = 0; run < BENCHMARK_TOP_RUNS; run++)
+      {
+         number_found = find_top_on_threads(store, &query, threads, top);
+         if(number_found == FILE_OPS_ERROR)
+         {
+            return FILE_OPS_ERROR;
+         }
+      }
+
+      printf("   A heap on %d thread%s: %.3f ms\n", threads,
+         threads == 1 ? "" : "s",
+         (wall_clock_seconds() - start) * 1000 / BENCHMARK_TOP_RUNS);
+
+      for(i = 0; i < number_found; i++)
+      {
+         if(number_found != number_sorted || top[i] != sorted[i])
+         {
+            printf("\nThe largest debits found on %d threads don't match.\n",
+               threads);
+            return FILE_OPS_ERROR;
+         }
+      }
+   }
+
+   return 0;
+}
+
+
+
+long find_top_on_threads(const struct transaction_store *store,
+   const struct top_query *query, int threads, struct transaction **top)
+{
+   struct top_chunk chunks[MAX_TOP_THREADS];
+   struct top_heap heap;
+   struct store_block *block;
+   long number_of_blocks = 0;
+   long blocks_per_chunk;
+   long number_found;
+   long j;
+   int number_of_chunks;
+   int i;
+
+   BOOL out_of_memory = FALSE;
+
+   for(block = store->first; block != NULL; block = block->next)
+   {
+      number_of_blocks++;
+   }
+
+   /* A small budget isn't worth the threads */
+   number_of_chunks = threads > MAX_TOP_THREADS ? MAX_TOP_THREADS : threads;
+   if(number_of_chunks > number_of_blocks / MIN_TOP_CHUNK_BLOCKS)
+   {
+      number_of_chunks = (int) (number_of_blocks / MIN_TOP_CHUNK_BLOCKS);
+   }
+
+   if(number_of_chunks < 1)
+   {
+      number_of_chunks = 1;
+   }
+
+   /* The last chunk also gets the blocks left over */
+   blocks_per_chunk = number_of_blocks / number_of_chunks;
+   block = store->first;
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      chunks[i].first = block;
+      chunks[i].number_of_blocks = i < number_of_chunks - 1
+         ? blocks_per_chunk : number_of_blocks - blocks_per_chunk * i;
+      chunks[i].heap.size = 0;
+      chunks[i].heap.query = query;
+      chunks[i].heap.items = malloc(sizeof(struct transaction *)
+         * (size_t) query->count);
+
+      if(chunks[i].heap.items == NULL)
+      {
+         out_of_memory = TRUE;
+      }
+
+      for(j = 0; j < chunks[i].number_of_blocks; j++)
+      {
+         block = block->next;
+      }
+   }
+
+   if(out_of_memory)
+   {
+      for(i = 0; i < number_of_chunks; i++)
+      {
+         free(chunks[i].heap.items);
+      }
+
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+#ifdef HAVE_PTHREADS
+   /* The first chunk is read on this thread while the others run */
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      chunks[i].started = pthread_create(&chunks[i].thread, NULL,
+         find_top_in_chunk, &chunks[i]) == 0;
+
+      if(!chunks[i].started)
+      {
+         (void) find_top_in_chunk(&chunks[i]);
+      }
+   }
+
+   (void) find_top_in_chunk(&chunks[0]);
+
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      if(chunks[i].started)
+      {
+         pthread_join(chunks[i].thread, NULL);
+      }
+   }
+#else
+   for(i = 0; i < number_of_chunks; i++)
+   {
+      (void) find_top_in_chunk(&chunks[i]);
+   }
+#endif
+
+   /* The first chunk's heap takes in what the others found */
+   heap = chunks[0].heap;
+   for(i = 1; i < number_of_chunks; i++)
+   {
+      for(j = 0; j < chunks[i].heap.size; j++)
+      {
+         offer_to_heap(&heap, chunks[i].heap.items[j]);
+      }
+
+      free(chunks[i].heap.items);
+   }
+
+   /* Taking the top off each time leaves the first one for last */
+   number_found = heap.size;
+   for(j = number_found - 1; j >= 0; j--)
+   {
+      top[j] = heap.items[0];
+      heap.items[0] = heap.items[--heap.size];
+      sift_top_down(&heap, 0);
+   }
+
+   free(heap.items);
+
+   return number_found;
+}
+
+
+
+void *find_top_in_chunk(void *argument)
+{
+   struct top_chunk *chunk = argument;
+   const struct top_query *query = chunk->heap.query;
+   struct store_block *block = chunk->first;
+   struct transaction *p;
+   long b;
+   int i;
+
+   for(b = 0; b < chunk->number_of_blocks; b++, block = block->next)
+   {
+      for(i = 0; i < block->used; i++)
+      {
+         p = &block->records[i];
+
+         if(!p->deleted && (query->type == ANY_TYPE || p->type == query->type)
+            && p->day >= query->first_day && p->day <= query->last_day)
+         {
+            offer_to_heap(&chunk->heap, p);
+         }
+      }
+   }
+
+   return NULL;
+}
+
+
+
+/* TRUE if a comes before b in the answer to the query */
+BOOL ranks_ahead(const struct transaction *a, const struct transaction *b,
+   const struct top_query *query)
+{
+   if(a->amount != b->amount)
+   {
+      return query->largest ? a->amount > b->amount : a->amount < b->amount;
+   }
+
+   return a->id < b->id;
+}
+
+
+
+/*
+ *
+ * Keeps node if the heap isn't full yet, or if it ranks ahead of the
+ * transaction at the top, which it replaces
+ *
+ */
+void offer_to_heap(struct top_heap *heap, struct transaction *node)
+{
+   long i;
+   long parent;
+
+   if(heap->size == heap->query->count)
+   {
+      if(ranks_ahead(node, heap->items[0], heap->query))
+      {
+         heap->items[0] = node;
+         sift_top_down(heap, 0);
+      }
+
+      return;
+   }
+
+   /* Move it up past every transaction that ranks ahead of it */
+   i = heap->size++;
+   while(i > 0)
+   {
+      parent = (i - 1) / 2;
+      if(!ranks_ahead(heap->items[parent], node, heap->query))
+      {
+         break;
+      }
+
+      heap->items[i] = heap->items[parent];
+      i = parent;
+   }
+
+   heap->items[i] = node;
+}
+
+
+
+void sift_top_down(struct top_heap *heap, long i)
+{
+   struct transaction *node = heap->items[i];
+   long child;
+
+   for( ;; )
+   {
+      /* The child that ranks last is the one to move up */
+      child = 2 * i + 1;
+      if(child >= heap->size)
+      {
+         break;
+      }
+
+      if(child + 1 < heap->size
+         && ranks_ahead(heap->items[child], heap->items[child + 1],
+            heap->query))
+      {
+         child++;
+      }
+
+      if(!ranks_ahead(node, heap->items[child], heap->query))
+      {
+         break;
+      }
+
+      heap->items[i] = heap->items[child];
+      i = child;
+   }
+
+   heap->items[i] = node;
+}
+
+
+
+/*
+ *
+ * Finds the same transactions by sorting every one that matches, for
+ * the benchmark to compare against
+ *
+ */
+long sort_to_find_top(const struct transaction_store *store,
+   const struct top_query *query, struct transaction **top)
+{
+   struct store_cursor cursor;
+   struct transaction **matches;
+   struct transaction *p;
+   long number_of_matches = 0;
+   long i;
+
+   matches = malloc(sizeof(struct transaction *)
+      * (size_t) (store->number_of_transactions + 1));
+   if(matches == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      if((query->type == ANY_TYPE || p->type == query->type)
+         && p->day >= query->first_day && p->day <= query->last_day)
+      {
+         matches[number_of_matches++] = p;
+      }
+   }
+
+   qsort_query = query;
+   qsort(matches, (size_t) number_of_matches, sizeof(struct transaction *),
+      compare_for_top);
+
+   for(i = 0; i < number_of_matches && i < query->count; i++)
+   {
+      top[i] = matches[i];
+   }
+
+   free(matches);
+
+   return i;
+}
+
+
+
+int compare_for_top(const void *a, const void *b)
+{
+   const struct transaction *x = *(struct transaction * const *) a;
+   const struct transaction *y = *(struct transaction * const *) b;
+
+   if(ranks_ahead(x, y, qsort_query))
+   {
+      return -1;
+   }
+
+   return ranks_ahead(y, x, qsort_query) ? 1 : 0;
+}
+
+
+
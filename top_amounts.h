@@ -0,0 +1,71 @@
+/*
+ *
+ * Name:       top_amounts.h
+ *
+ * Purpose:    Contains function prototypes for finding the largest or
+ *             smallest transactions of a type between two dates.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TOP_AMOUNTS_H
+#define TOP_AMOUNTS_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/* The most transactions one query can ask for */
+#define MAX_TOP_COUNT 1000
+
+/* A query's type when it takes both credits and debits */
+#define ANY_TYPE -1
+
+struct top_query
+{
+   /* How many transactions to find, from 1 to MAX_TOP_COUNT */
+   int count;
+
+   /* TRUE for the largest amounts, FALSE for the smallest */
+   BOOL largest;
+
+   /* CREDIT_TYPE, DEBIT_TYPE, or ANY_TYPE */
+   int type;
+
+   /* Only transactions from first_day to last_day, both included */
+   long first_day;
+   long last_day;
+};
+
+/*
+ * Finds the query->count largest or smallest transactions that match
+ * the query, in O(n log K) for K of them, and puts them in top from the
+ * first to the last in order. Equal amounts go in order of ID. The
+ * store is split between the same number of threads the reports use.
+ * Returns how many were found, which is fewer than asked for if fewer
+ * match, or FILE_OPS_ERROR if we run out of memory.
+ */
+long find_top_transactions(const struct transaction_store *store,
+   const struct top_query *query, struct transaction **top);
+
+/*
+ * Times find_top_transactions() on more and more threads against
+ * sorting every transaction that matches, checks that they agree, and
+ * prints the times
+ */
+int print_top_benchmark(const struct transaction_store *store);
+
+#endif
+
+
+
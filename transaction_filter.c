@@ -0,0 +1,1160 @@
+/*
+ *
+ * Name:       transaction_filter.c
+ *
+ * Purpose:    Contains functions for compiling a filter, and finding the
+ *             transactions that match it.
+ *
+ *             A filter is parsed once, into a list of steps in postfix
+ *             order, with its amounts, dates, and types already turned
+ *             into numbers. Each transaction then only runs the steps,
+ *             comparing its fields as numbers. Transactions with the
+ *             same description share one copy of it, so the results of
+ *             the description tests are remembered for each copy.
+ *
+ *             Before anything is read, the tests joined by AND at the
+ *             top of the filter are looked at, and words or a range of
+ *             dates that every match must have let the search or date
+ *             index read only the transactions that could match.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+#include "transaction_filter.h"
+#include "transaction_index.h"
+#include "search_index.h"
+#include "validation.h"
+#include "conversions.h"
+#include "rollups.h"
+
+/* How many times the benchmark runs each filter both ways */
+#define BENCHMARK_FILTER_RUNS 10
+#define NUMBER_OF_BENCHMARK_FILTERS 3
+
+/*
+ * The transactions with a filter's words are read, instead of the
+ * store, when they are no more than 1 in this many
+ */
+#define MIN_WORDS_FRACTION 8
+
+/* The list of matches starts with room for this many, and doubles */
+#define MIN_MATCHES 256
+
+/* Where a filter is being read from, and the first thing wrong with it */
+struct filter_parser
+{
+   const char *p;
+   struct transaction_filter *filter;
+   const struct transaction_store *store;
+
+   const char *error;
+   const char *error_at;
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+BOOL parse_any(struct filter_parser *parser);
+BOOL parse_all(struct filter_parser *parser);
+BOOL parse_condition(struct filter_parser *parser);
+BOOL parse_test(struct filter_parser *parser);
+BOOL parse_description_test(struct filter_parser *parser, int comparison,
+   const char *value, const char *value_at);
+BOOL filter_error(struct filter_parser *parser, const char *at,
+   const char *error);
+struct filter_step *add_step(struct filter_parser *parser, int opcode,
+   int comparison, long number);
+BOOL read_keyword(struct filter_parser *parser, const char *keyword);
+BOOL read_symbol(struct filter_parser *parser, char symbol);
+int read_comparison(struct filter_parser *parser);
+size_t read_word(struct filter_parser *parser, char *word);
+BOOL read_value(struct filter_parser *parser, char *value);
+BOOL is_word_character(char c);
+void to_lower_case(const char *text, char *lower);
+void find_bounds(struct transaction_filter *filter, int last);
+BOOL compare_numbers(long value, int comparison, long number);
+unsigned long test_description(struct transaction_filter *filter,
+   const char *description);
+BOOL has_id(const int *ids, long number_of_ids, int id);
+struct transaction *next_candidate(struct filter_cursor *cursor);
+int compare_match_ids(const void *a, const void *b);
+long count_matches(struct transaction_filter *filter,
+   const struct transaction_store *store);
+
+
+
+int compile_filter(const char *expression,
+   const struct transaction_store *store, struct transaction_filter *filter)
+{
+   struct filter_parser parser;
+   int i;
+
+   filter->number_of_steps = 0;
+   filter->number_of_tests = 0;
+   filter->first_day = INT_MIN;
+   filter->last_day = INT_MAX;
+   filter->candidates = -1;
+   filter->read_everything = FALSE;
+
+   for(i = 0; i < FILTER_CACHE_SIZE; i++)
+   {
+      filter->cached_descriptions[i] = NULL;
+   }
+
+   parser.p = expression;
+   parser.filter = filter;
+   parser.store = store;
+   parser.error = NULL;
+   parser.error_at = NULL;
+
+   if(parse_any(&parser))
+   {
+      while(isspace((unsigned char) *parser.p))
+      {
+         parser.p++;
+      }
+
+      if(*parser.p != '\0')
+      {
+         (void) filter_error(&parser, parser.p, "AND or OR was expected");
+      }
+   }
+
+   if(parser.error != NULL)
+   {
+      if(*parser.error_at == '\0')
+      {
+         printf("\nThe filter isn't right at its end: %s.\n", parser.error);
+      }
+      else
+      {
+         printf("\nThe filter isn't right at \"%s\": %s.\n", parser.error_at,
+            parser.error);
+      }
+
+      free_filter(filter);
+      return FILE_OPS_ERROR;
+   }
+
+   find_bounds(filter, filter->number_of_steps - 1);
+
+   return 0;
+}
+
+
+
+BOOL filter_matches(struct transaction_filter *filter,
+   const struct transaction *node)
+{
+   BOOL results[MAX_FILTER_STEPS];
+   const struct filter_step *step = filter->steps;
+   const struct filter_step *end = step + filter->number_of_steps;
+   int top = 0;
+
+   for( ; step < end; step++)
+   {
+      if(step->opcode == FILTER_AND)
+      {
+         top--;
+         results[top - 1] = results[top - 1] && results[top];
+      }
+      else if(step->opcode == FILTER_OR)
+      {
+         top--;
+         results[top - 1] = results[top - 1] || results[top];
+      }
+      else if(step->opcode == FILTER_NOT)
+      {
+         results[top - 1] = !results[top - 1];
+      }
+      else if(step->opcode == FILTER_AMOUNT)
+      {
+         results[top++] = compare_numbers(node->amount, step->comparison,
+            step->number);
+      }
+      else if(step->opcode == FILTER_DATE)
+      {
+         results[top++] = compare_numbers(node->day, step->comparison,
+            step->number);
+      }
+      else if(step->opcode == FILTER_TYPE)
+      {
+         results[top++] = compare_numbers(node->type, step->comparison,
+            step->number);
+      }
+      else if(step->opcode == FILTER_ID)
+      {
+         results[top++] = compare_numbers(node->id, step->comparison,
+            step->number);
+      }
+      else if(step->opcode == FILTER_DESCRIPTION)
+      {
+         results[top++] = (BOOL) ((test_description(filter,
+            node->description) >> step->test) & 1UL);
+      }
+      else
+      {
+         results[top++] = has_id(step->ids, step->number_of_ids, node->id);
+      }
+   }
+
+   return results[0];
+}
+
+
+
+struct transaction *first_match(struct transaction_filter *filter,
+   const struct transaction_store *store, struct filter_cursor *cursor)
+{
+   struct transaction *p;
+
+   cursor->filter = filter;
+   cursor->source = 0;
+   cursor->next_id = 0;
+
+   if(filter->first_day > filter->last_day)
+   {
+      return NULL;
+   }
+
+   /*
+    * Reading the words' transactions one at a time is slower than
+    * reading the store, unless they are only a few of them
+    */
+   if(!filter->read_everything && filter->candidates != -1
+      && filter->steps[filter->candidates].number_of_ids
+         <= store->number_of_transactions / MIN_WORDS_FRACTION)
+   {
+      cursor->source = FILTER_WORDS;
+      p = next_candidate(cursor);
+   }
+   else if(!filter->read_everything && date_index_is_built()
+      && (filter->first_day != INT_MIN || filter->last_day != INT_MAX))
+   {
+      cursor->source = FILTER_DATE;
+      p = first_in_date_range((int) filter->first_day,
+         (int) filter->last_day, &cursor->dates);
+   }
+   else
+   {
+      p = first_transaction(store, &cursor->store);
+   }
+
+   if(p != NULL && !filter_matches(filter, p))
+   {
+      p = next_match(cursor);
+   }
+
+   return p;
+}
+
+
+
+struct transaction *next_match(struct filter_cursor *cursor)
+{
+   struct transaction *p;
+
+   do
+   {
+      p = next_candidate(cursor);
+   } while(p != NULL && !filter_matches(cursor->filter, p));
+
+   return p;
+}
+
+
+
+/*
+ *
+ * Collects every match, in whichever order first_match() reads them,
+ * and sorts them by ID, so they come out the same way whether or not
+ * an index was used
+ *
+ */
+long filter_transactions(struct transaction_filter *filter,
+   const struct transaction_store *store, struct transaction ***ptr_matches)
+{
+   struct filter_cursor cursor;
+   struct transaction **matches = NULL;
+   struct transaction **bigger;
+   struct transaction *p;
+   long number_of_matches = 0;
+   long room = 0;
+
+   for(p = first_match(filter, store, &cursor); p != NULL;
+      p = next_match(&cursor))
+   {
+      if(number_of_matches == room)
+      {
+         room = room == 0 ? MIN_MATCHES : room * 2;
+         bigger = realloc(matches, room * sizeof(struct transaction *));
+         if(bigger == NULL)
+         {
+            free(matches);
+            printf("\nMemory allocation error.\n");
+            return FILE_OPS_ERROR;
+         }
+
+         matches = bigger;
+      }
+
+      matches[number_of_matches++] = p;
+   }
+
+   /* The words' transactions are read in order of ID already */
+   if(cursor.source != FILTER_WORDS && number_of_matches > 1)
+   {
+      qsort(matches, number_of_matches, sizeof(struct transaction *),
+         compare_match_ids);
+   }
+
+   *ptr_matches = matches;
+
+   return number_of_matches;
+}
+
+
+
+int compare_match_ids(const void *a, const void *b)
+{
+   const struct transaction *node_a = *(struct transaction * const *) a;
+   const struct transaction *node_b = *(struct transaction * const *) b;
+
+   return (node_a->id > node_b->id) - (node_a->id < node_b->id);
+}
+
+
+
+void free_filter(struct transaction_filter *filter)
+{
+   int i;
+
+   for(i = 0; i < filter->number_of_steps; i++)
+   {
+      if(filter->steps[i].opcode == FILTER_WORDS)
+      {
+         free(filter->steps[i].ids);
+         filter->steps[i].ids = NULL;
+      }
+   }
+
+   filter->number_of_steps = 0;
+}
+
+
+
+int print_filter_benchmark(const struct transaction_store *store)
+{
+   char expressions[NUMBER_OF_BENCHMARK_FILTERS][DESCRIPTION_LENGTH + 32];
+   char first_date_string[DATE_LENGTH + 1];
+   char last_date_string[DATE_LENGTH + 1];
+   char words[DESCRIPTION_LENGTH + 1];
+   struct transaction_filter filter;
+   struct store_cursor cursor;
+   const struct transaction *first;
+   const char *p;
+   double start;
+   double seconds[2];
+   long number_found[2];
+   size_t length = 0;
+   int run;
+   int way;
+   int i;
+
+   first = first_transaction(store, &cursor);
+   if(first == NULL)
+   {
+      printf("\nThere are no transactions to filter.\n");
+      return 0;
+   }
+
+   /* A month from the first date, and the words of its description */
+   day_number_to_date(first->day, first_date_string);
+   day_number_to_date(first->day + 30, last_date_string);
+
+   for(p = first->description; *p != '\0'; p++)
+   {
+      words[length++] = (char) (isalnum((unsigned char) *p) ? *p : ' ');
+   }
+
+   words[length] = '\0';
+
+   sprintf(expressions[0], "type=0 AND amount>50.00");
+   sprintf(expressions[1], "date>=%s AND date<=%s AND type=0",
+      first_date_string, last_date_string);
+   sprintf(expressions[2], "desc:\"%s\" AND amount>10.00", words);
+
+   if(build_date_index(store) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   printf("\nFiltering %ld transactions:\n", store->number_of_transactions);
+
+   for(i = 0; i < NUMBER_OF_BENCHMARK_FILTERS; i++)
+   {
+      if(compile_filter(expressions[i], store, &filter) == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+
+      for(way = 0; way < 2; way++)
+      {
+         filter.read_everything = way == 0;
+
+         start = wall_clock_seconds();
+         for(run = 0; run < BENCHMARK_FILTER_RUNS; run++)
+         {
+            number_found[way] = count_matches(&filter, store);
+         }
+
+         seconds[way] = (wall_clock_seconds() - start) / BENCHMARK_FILTER_RUNS;
+      }
+
+      free_filter(&filter);
+
+      printf("\n   %s\n", expressions[i]);
+      printf("   Reading every transaction: %.3f ms\n", seconds[0] * 1000);
+      printf("   Using the indexes: %.3f ms\n", seconds[1] * 1000);
+      printf("   %ld transactions matched.\n", number_found[1]);
+
+      if(number_found[0] != number_found[1])
+      {
+         printf("\nThe filter found %ld transactions with the indexes and %ld without.\n",
+            number_found[1], number_found[0]);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Parses tests joined by OR, which come after the ones joined by AND
+ *
+ */
+BOOL parse_any(struct filter_parser *parser)
+{
+   if(!parse_all(parser))
+   {
+      return FALSE;
+   }
+
+   while(read_keyword(parser, "or"))
+   {
+      if(!parse_all(parser) || add_step(parser, FILTER_OR, 0, 0) == NULL)
+      {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+
+BOOL parse_all(struct filter_parser *parser)
+{
+   if(!parse_condition(parser))
+   {
+      return FALSE;
+   }
+
+   while(read_keyword(parser, "and"))
+   {
+      if(!parse_condition(parser)
+         || add_step(parser, FILTER_AND, 0, 0) == NULL)
+      {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Parses a test, NOT and a condition, or a filter in parentheses
+ *
+ */
+BOOL parse_condition(struct filter_parser *parser)
+{
+   if(read_keyword(parser, "not"))
+   {
+      return parse_condition(parser)
+         && add_step(parser, FILTER_NOT, 0, 0) != NULL;
+   }
+
+   if(read_symbol(parser, '('))
+   {
+      if(!parse_any(parser))
+      {
+         return FALSE;
+      }
+
+      if(!read_symbol(parser, ')'))
+      {
+         return filter_error(parser, parser->p, "a ) was expected");
+      }
+
+      return TRUE;
+   }
+
+   return parse_test(parser);
+}
+
+
+
+BOOL parse_test(struct filter_parser *parser)
+{
+   char field[DESCRIPTION_LENGTH + 1];
+   char value[DESCRIPTION_LENGTH + 1];
+   const char *field_at;
+   const char *value_at;
+   CENTS cents;
+   long number;
+   int opcode;
+   int comparison;
+
+   while(isspace((unsigned char) *parser->p))
+   {
+      parser->p++;
+   }
+
+   field_at = parser->p;
+   if(read_word(parser, field) == 0)
+   {
+      return filter_error(parser, field_at,
+         "a test like amount>50.00 was expected");
+   }
+
+   comparison = read_comparison(parser);
+   if(comparison == 0)
+   {
+      return filter_error(parser, parser->p,
+         "=, !=, <, <=, >, >=, ~, or : was expected");
+   }
+
+   while(isspace((unsigned char) *parser->p))
+   {
+      parser->p++;
+   }
+
+   value_at = parser->p;
+   if(!read_value(parser, value))
+   {
+      return filter_error(parser, value_at, "a value was expected");
+   }
+
+   to_lower_case(field, field);
+
+   if(strcmp(field, "desc") == 0 || strcmp(field, "description") == 0)
+   {
+      return parse_description_test(parser, comparison, value, value_at);
+   }
+
+   if(comparison == FILTER_CONTAINS || comparison == FILTER_HAS_WORDS)
+   {
+      return filter_error(parser, field_at,
+         "only desc can be compared with ~ or :");
+   }
+
+   if(strcmp(field, "id") == 0)
+   {
+      opcode = FILTER_ID;
+      number = atol(value);
+      if(strlen(value) > ID_INPUT_LENGTH
+         || strspn(value, "0123456789") != strlen(value))
+      {
+         return filter_error(parser, value_at, "an ID was expected");
+      }
+   }
+   else if(strcmp(field, "type") == 0)
+   {
+      opcode = FILTER_TYPE;
+      number = *value - '0';
+      if((*value != '0' && *value != '1') || value[1] != '\0')
+      {
+         return filter_error(parser, value_at, "a type of 0 or 1 was expected");
+      }
+   }
+   else if(strcmp(field, "amount") == 0)
+   {
+      opcode = FILTER_AMOUNT;
+      if(!amount_to_cents(value, &cents))
+      {
+         return filter_error(parser, value_at,
+            "an amount like 50.00 was expected");
+      }
+
+      number = cents;
+   }
+   else if(strcmp(field, "date") == 0)
+   {
+      opcode = FILTER_DATE;
+      number = is_valid_date(value) ? date_to_day_number(value)
+         : INVALID_DAY_NUMBER;
+      if(number == INVALID_DAY_NUMBER)
+      {
+         return filter_error(parser, value_at,
+            "a date like 9/1/2022 was expected");
+      }
+   }
+   else
+   {
+      return filter_error(parser, field_at,
+         "the fields are id, type, amount, date, and desc");
+   }
+
+   return add_step(parser, opcode, comparison, number) != NULL;
+}
+
+
+
+BOOL parse_description_test(struct filter_parser *parser, int comparison,
+   const char *value, const char *value_at)
+{
+   struct filter_step *step;
+   long number_found;
+
+   if(comparison == FILTER_HAS_WORDS)
+   {
+      step = add_step(parser, FILTER_WORDS, comparison, 0);
+      if(step == NULL)
+      {
+         return FALSE;
+      }
+
+      if(build_search_index(parser->store) == FILE_OPS_ERROR)
+      {
+         return filter_error(parser, value_at, "there wasn't enough memory");
+      }
+
+      number_found = search_transactions(value, &step->ids);
+      if(number_found == FILE_OPS_ERROR)
+      {
+         return filter_error(parser, value_at, "there wasn't enough memory");
+      }
+
+      step->number_of_ids = number_found;
+
+      return TRUE;
+   }
+
+   if(comparison != FILTER_EQUAL && comparison != FILTER_NOT_EQUAL
+      && comparison != FILTER_CONTAINS)
+   {
+      return filter_error(parser, value_at,
+         "desc can only be compared with =, !=, ~, or :");
+   }
+
+   if(parser->filter->number_of_tests == MAX_DESCRIPTION_TESTS)
+   {
+      return filter_error(parser, value_at,
+         "there are too many tests of descriptions");
+   }
+
+   step = add_step(parser, FILTER_DESCRIPTION, comparison, 0);
+   if(step == NULL)
+   {
+      return FALSE;
+   }
+
+   step->test = parser->filter->number_of_tests++;
+   parser->filter->tests[step->test].comparison = comparison;
+   to_lower_case(value, parser->filter->tests[step->test].text);
+
+   return TRUE;
+}
+
+
+
+/* Remembers the first thing wrong with the filter, and returns FALSE */
+BOOL filter_error(struct filter_parser *parser, const char *at,
+   const char *error)
+{
+   if(parser->error == NULL)
+   {
+      parser->error = error;
+      parser->error_at = at;
+   }
+
+   return FALSE;
+}
+
+
+
+/*
+ *
+ * Adds a step to the end of the filter, and works out how many steps
+ * it takes up with the ones it works on
+ *
+ */
+struct filter_step *add_step(struct filter_parser *parser, int opcode,
+   int comparison, long number)
+{
+   struct transaction_filter *filter = parser->filter;
+   struct filter_step *step;
+   int last = filter->number_of_steps - 1;
+
+   if(filter->number_of_steps == MAX_FILTER_STEPS)
+   {
+      (void) filter_error(parser, parser->p, "the filter is too long");
+      return NULL;
+   }
+
+   step = &filter->steps[filter->number_of_steps++];
+   step->opcode = opcode;
+   step->comparison = comparison;
+   step->number = number;
+   step->test = 0;
+   step->ids = NULL;
+   step->number_of_ids = 0;
+   step->size = 1;
+
+   if(opcode == FILTER_NOT)
+   {
+      step->size += filter->steps[last].size;
+   }
+   else if(opcode == FILTER_AND || opcode == FILTER_OR)
+   {
+      step->size += filter->steps[last].size
+         + filter->steps[last - filter->steps[last].size].size;
+   }
+
+   return step;
+}
+
+
+
+/*
+ *
+ * Reads a keyword, like AND, in any case, if it comes next and is a
+ * word of its own
+ *
+ */
+BOOL read_keyword(struct filter_parser *parser, const char *keyword)
+{
+   const char *p;
+   size_t i;
+
+   while(isspace((unsigned char) *parser->p))
+   {
+      parser->p++;
+   }
+
+   p = parser->p;
+   for(i = 0; keyword[i] != '\0'; i++)
+   {
+      if(tolower((unsigned char) p[i]) != keyword[i])
+      {
+         return FALSE;
+      }
+   }
+
+   if(is_word_character(p[i]))
+   {
+      return FALSE;
+   }
+
+   parser->p += i;
+
+   return TRUE;
+}
+
+
+
+BOOL read_symbol(struct filter_parser *parser, char symbol)
+{
+   while(isspace((unsigned char) *parser->p))
+   {
+      parser->p++;
+   }
+
+   if(*parser->p != symbol)
+   {
+      return FALSE;
+   }
+
+   parser->p++;
+
+   return TRUE;
+}
+
+
+
+/* Returns the comparison that comes next, or 0 if there isn't one */
+int read_comparison(struct filter_parser *parser)
+{
+   const char *p;
+   int comparison = 0;
+
+   while(isspace((unsigned char) *parser->p))
+   {
+      parser->p++;
+   }
+
+   p = parser->p;
+
+   if(p[0] == '!' && p[1] == '=')
+   {
+      comparison = FILTER_NOT_EQUAL;
+   }
+   else if(p[0] == '<')
+   {
+      comparison = p[1] == '=' ? FILTER_LESS_OR_EQUAL : FILTER_LESS;
+   }
+   else if(p[0] == '>')
+   {
+      comparison = p[1] == '=' ? FILTER_GREATER_OR_EQUAL : FILTER_GREATER;
+   }
+   else if(p[0] == '=')
+   {
+      comparison = FILTER_EQUAL;
+   }
+   else if(p[0] == '~')
+   {
+      comparison = FILTER_CONTAINS;
+   }
+   else if(p[0] == ':')
+   {
+      comparison = FILTER_HAS_WORDS;
+   }
+
+   /* Only the first character of =, ~, and : is a part of them */
+   if(comparison != 0)
+   {
+      parser->p += p[0] != '=' && p[0] != '~' && p[0] != ':' && p[1] == '='
+         ? 2 : 1;
+   }
+
+   return comparison;
+}
+
+
+
+/* Reads the characters up to a space, a symbol, or a quote */
+size_t read_word(struct filter_parser *parser, char *word)
+{
+   size_t length = 0;
+
+   while(is_word_character(*parser->p) && length < DESCRIPTION_LENGTH)
+   {
+      word[length++] = *parser->p++;
+   }
+
+   word[length] = '\0';
+
+   return length;
+}
+
+
+
+/* Reads a word, or any text in quotes */
+BOOL read_value(struct filter_parser *parser, char *value)
+{
+   size_t length = 0;
+
+   if(*parser->p != '"')
+   {
+      return read_word(parser, value) > 0;
+   }
+
+   parser->p++;
+   while(*parser->p != '"' && *parser->p != '\0' && length < DESCRIPTION_LENGTH)
+   {
+      value[length++] = *parser->p++;
+   }
+
+   value[length] = '\0';
+
+   if(*parser->p != '"')
+   {
+      return FALSE;
+   }
+
+   parser->p++;
+
+   return TRUE;
+}
+
+
+
+BOOL is_word_character(char c)
+{
+   return c != '\0' && !isspace((unsigned char) c)
+      && strchr("()=!<>~:\"", c) == NULL;
+}
+
+
+
+/* Copies text in lower case. lower may be text. */
+void to_lower_case(const char *text, char *lower)
+{
+   while(*text != '\0')
+   {
+      *lower++ = (char) tolower((unsigned char) *text++);
+   }
+
+   *lower = '\0';
+}
+
+
+
+/*
+ *
+ * Narrows the filter's range of dates, and picks the words with the
+ * fewest transactions, from the tests joined by AND to the rest of the
+ * filter from the step last down
+ *
+ */
+void find_bounds(struct transaction_filter *filter, int last)
+{
+   const struct filter_step *step = &filter->steps[last];
+   long first_day = INT_MIN;
+   long last_day = INT_MAX;
+
+   if(step->opcode == FILTER_AND)
+   {
+      find_bounds(filter, last - 1);
+      find_bounds(filter, last - 1 - filter->steps[last - 1].size);
+   }
+   else if(step->opcode == FILTER_WORDS)
+   {
+      if(filter->candidates == -1 || step->number_of_ids
+         < filter->steps[filter->candidates].number_of_ids)
+      {
+         filter->candidates = last;
+      }
+   }
+   else if(step->opcode == FILTER_DATE)
+   {
+      if(step->comparison == FILTER_EQUAL)
+      {
+         first_day = step->number;
+         last_day = step->number;
+      }
+      else if(step->comparison == FILTER_LESS)
+      {
+         last_day = step->number - 1;
+      }
+      else if(step->comparison == FILTER_LESS_OR_EQUAL)
+      {
+         last_day = step->number;
+      }
+      else if(step->comparison == FILTER_GREATER)
+      {
+         first_day = step->number + 1;
+      }
+      else if(step->comparison == FILTER_GREATER_OR_EQUAL)
+      {
+         first_day = step->number;
+      }
+
+      if(first_day > filter->first_day)
+      {
+         filter->first_day = first_day;
+      }
+
+      if(last_day < filter->last_day)
+      {
+         filter->last_day = last_day;
+      }
+   }
+}
+
+
+
+BOOL compare_numbers(long value, int comparison, long number)
+{
+   if(comparison == FILTER_EQUAL)
+   {
+      return value == number;
+   }
+   else if(comparison == FILTER_NOT_EQUAL)
+   {
+      return value != number;
+   }
+   else if(comparison == FILTER_LESS)
+   {
+      return value < number;
+   }
+   else if(comparison == FILTER_LESS_OR_EQUAL)
+   {
+      return value <= number;
+   }
+   else if(comparison == FILTER_GREATER)
+   {
+      return value > number;
+   }
+
+   return value >= number;
+}
+
+
+
+/*
+ *
+ * Returns the results of every description test of the filter, one bit
+ * each, working them out only the first time the description's copy is
+ * seen, or when another copy has taken its place in the cache
+ *
+ */
+unsigned long test_description(struct transaction_filter *filter,
+   const char *description)
+{
+   char lower[DESCRIPTION_LENGTH + 1];
+   const struct description_test *test;
+   unsigned long slot = ((unsigned long) description >> 4) % FILTER_CACHE_SIZE;
+   unsigned long results = 0;
+   BOOL matched;
+   int i;
+
+   if(filter->cached_descriptions[slot] == description)
+   {
+      return filter->cached_results[slot];
+   }
+
+   to_lower_case(description, lower);
+
+   for(i = 0; i < filter->number_of_tests; i++)
+   {
+      test = &filter->tests[i];
+
+      if(test->comparison == FILTER_CONTAINS)
+      {
+         matched = strstr(lower, test->text) != NULL;
+      }
+      else
+      {
+         matched = (strcmp(lower, test->text) == 0)
+            == (test->comparison == FILTER_EQUAL);
+      }
+
+      if(matched)
+      {
+         results |= 1UL << i;
+      }
+   }
+
+   filter->cached_descriptions[slot] = description;
+   filter->cached_results[slot] = results;
+
+   return results;
+}
+
+
+
+/* Binary search of IDs from lowest to highest */
+BOOL has_id(const int *ids, long number_of_ids, int id)
+{
+   long low = 0;
+   long high = number_of_ids - 1;
+   long middle;
+
+   while(low <= high)
+   {
+      middle = low + (high - low) / 2;
+
+      if(ids[middle] == id)
+      {
+         return TRUE;
+      }
+
+      if(ids[middle] < id)
+      {
+         low = middle + 1;
+      }
+      else
+      {
+         high = middle - 1;
+      }
+   }
+
+   return FALSE;
+}
+
+
+
+/*
+ *
+ * Returns the next transaction that might match, from the words, the
+ * range of dates, or the store
+ *
+ */
+struct transaction *next_candidate(struct filter_cursor *cursor)
+{
+   const struct filter_step *words;
+   struct transaction *p;
+
+   if(cursor->source == FILTER_DATE)
+   {
+      return next_in_date_range(&cursor->dates);
+   }
+
+   if(cursor->source != FILTER_WORDS)
+   {
+      return next_transaction(&cursor->store);
+   }
+
+   /* A deleted transaction isn't found, so skip it */
+   words = &cursor->filter->steps[cursor->filter->candidates];
+   while(cursor->next_id < words->number_of_ids)
+   {
+      p = find_transaction(words->ids[cursor->next_id++]);
+      if(p != NULL)
+      {
+         return p;
+      }
+   }
+
+   return NULL;
+}
+
+
+
+long count_matches(struct transaction_filter *filter,
+   const struct transaction_store *store)
+{
+   struct filter_cursor cursor;
+   struct transaction *p;
+   long number_found = 0;
+
+   for(p = first_match(filter, store, &cursor); p != NULL;
+      p = next_match(&cursor))
+   {
+      number_found++;
+   }
+
+   return number_found;
+}
+
+
+
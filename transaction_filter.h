@@ -0,0 +1,180 @@
+/*
+ *
+ * Name:       transaction_filter.h
+ *
+ * Purpose:    Contains function prototypes for compiling a filter, like
+ *             type=0 AND amount>50.00 AND date>=9/1/2022 AND desc~"Eat",
+ *             and finding the transactions that match it.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_FILTER_H
+#define TRANSACTION_FILTER_H
+#include "transaction_store.h"
+#include "date_index.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/* The most steps, and the most description tests, a filter can have */
+#define MAX_FILTER_STEPS 64
+#define MAX_DESCRIPTION_TESTS 16
+
+/* How many descriptions a filter remembers its tests of */
+#define FILTER_CACHE_SIZE 1024
+
+/* What a step does */
+#define FILTER_ID 1
+#define FILTER_TYPE 2
+#define FILTER_AMOUNT 3
+#define FILTER_DATE 4
+#define FILTER_DESCRIPTION 5
+#define FILTER_WORDS 6
+#define FILTER_AND 7
+#define FILTER_OR 8
+#define FILTER_NOT 9
+
+/* How a step compares its field */
+#define FILTER_EQUAL 1
+#define FILTER_NOT_EQUAL 2
+#define FILTER_LESS 3
+#define FILTER_LESS_OR_EQUAL 4
+#define FILTER_GREATER 5
+#define FILTER_GREATER_OR_EQUAL 6
+#define FILTER_CONTAINS 7
+#define FILTER_HAS_WORDS 8
+
+/*
+ * One step of a compiled filter. The steps are in postfix order, so
+ * each test pushes TRUE or FALSE, and AND, OR, and NOT work on the
+ * results on top.
+ */
+struct filter_step
+{
+   int opcode;
+   int comparison;
+
+   /* The ID, type, amount in cents, or day number to compare with */
+   long number;
+
+   /* For FILTER_DESCRIPTION, which of the description tests this is */
+   int test;
+
+   /* For FILTER_WORDS, the IDs that have the words, lowest first */
+   int *ids;
+   long number_of_ids;
+
+   /* How many steps this one and the ones it works on take up */
+   int size;
+};
+
+/* A description test, with its text in lower case */
+struct description_test
+{
+   int comparison;
+   char text[DESCRIPTION_LENGTH + 1];
+};
+
+struct transaction_filter
+{
+   struct filter_step steps[MAX_FILTER_STEPS];
+   int number_of_steps;
+
+   struct description_test tests[MAX_DESCRIPTION_TESTS];
+   int number_of_tests;
+
+   /*
+    * Every match must be from first_day to last_day, and, when
+    * candidates isn't -1, have the words of that FILTER_WORDS step,
+    * because they are joined to the rest of the filter by AND
+    */
+   long first_day;
+   long last_day;
+   int candidates;
+
+   /* TRUE to read every transaction, even when an index could be used */
+   BOOL read_everything;
+
+   /* The results of every description test, for the last few seen */
+   const char *cached_descriptions[FILTER_CACHE_SIZE];
+   unsigned long cached_results[FILTER_CACHE_SIZE];
+};
+
+/* Where a walk through the transactions that match a filter is */
+struct filter_cursor
+{
+   struct transaction_filter *filter;
+
+   /* FILTER_WORDS, FILTER_DATE, or 0 to read the store */
+   int source;
+
+   struct store_cursor store;
+   struct date_cursor dates;
+   long next_id;
+};
+
+/*
+ * Compiles a filter of tests, like amount>50.00, joined by AND, OR,
+ * and NOT, with parentheses. The fields are id, type, amount, date, and
+ * desc, and they are compared with =, !=, <, <=, >, or >=. A
+ * description can also be checked with ~, for text anywhere in it, or
+ * with :, for words, like the description search. Text may be in
+ * quotes, and descriptions are compared ignoring case.
+ *
+ * A filter with desc: builds the search index. Prints what is wrong
+ * and returns FILE_OPS_ERROR if the filter can't be compiled, or we run
+ * out of memory. Otherwise free_filter() must be called when it is done.
+ */
+int compile_filter(const char *expression,
+   const struct transaction_store *store, struct transaction_filter *filter);
+
+/* Returns TRUE if the transaction matches the filter */
+BOOL filter_matches(struct transaction_filter *filter,
+   const struct transaction *node);
+
+/*
+ * Walk the transactions that match a filter. When the filter needs
+ * words that only a few transactions have, only those are read.
+ * Otherwise, when it is limited to a range of dates and the date index
+ * is built, only that range is read. Anything else reads the store.
+ * The order of the matches depends on which of these was used, so
+ * use filter_transactions() to show them.
+ *
+ *    for(p = first_match(filter, store, &cursor); p != NULL;
+ *       p = next_match(&cursor))
+ */
+struct transaction *first_match(struct transaction_filter *filter,
+   const struct transaction_store *store, struct filter_cursor *cursor);
+struct transaction *next_match(struct filter_cursor *cursor);
+
+/*
+ * Points *ptr_matches at a list of every transaction that matches the
+ * filter, in order of their IDs, and returns how many there are. The
+ * caller frees the list. Returns FILE_OPS_ERROR if we run out of memory.
+ */
+long filter_transactions(struct transaction_filter *filter,
+   const struct transaction_store *store, struct transaction ***ptr_matches);
+
+void free_filter(struct transaction_filter *filter);
+
+/*
+ * Times a few filters read through the store against the same ones
+ * using the indexes, checks that they agree, and prints the times
+ */
+int print_filter_benchmark(const struct transaction_store *store);
+
+#endif
+
+
+
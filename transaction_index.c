@@ -0,0 +1,388 @@
+/*
+ *
+ * Name:       transaction_index.c
+ *
+ * Purpose:    Contains functions for finding a transaction by its ID
+ *             without walking the store.
+ *
+ *             Every transaction has an ID that is saved with it, so it
+ *             keeps the same ID from one run to the next, no matter
+ *             what is created or deleted around it. A hash table from
+ *             ID to node lets Update and Delete go straight to it.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include "transaction_index.h"
+#include "date_index.h"
+#include "search_index.h"
+#include "balance.h"
+#include "rollups.h"
+#include "date_totals.h"
+#include "amount_column.h"
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+unsigned long index_slot(int id);
+BOOL add_to_index(struct transaction *node);
+BOOL grow_index(unsigned long number_of_nodes);
+
+/*
+ * The hash table, with open addressing. An empty slot is NULL.
+ * number_of_slots is 2 to the power of slot_bits. next_id is one
+ * more than the highest ID we have seen.
+ */
+static struct transaction **slots = NULL;
+static unsigned long number_of_slots = 0;
+static int slot_bits = 0;
+static unsigned long number_of_indexed = 0;
+static long next_id = 1;
+
+
+
+int index_transactions(const struct transaction_store *store,
+   const char *file_name)
+{
+   struct store_cursor cursor;
+   struct transaction *p;
+   unsigned long number_of_nodes;
+   int ids_given = 0;
+
+   number_of_nodes = (unsigned long) store->number_of_transactions;
+
+   /*
+    * Make room for the whole store at once, instead of doubling the
+    * table over and over while it loads. After that, adding a node
+    * can only fail because its ID is already used.
+    */
+   if((number_of_indexed + number_of_nodes) * 2 > number_of_slots
+      && !grow_index(number_of_indexed + number_of_nodes))
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   /* Saved IDs first, so the new ones can start after the highest */
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      if(p->id != NO_TRANSACTION_ID && !add_to_index(p))
+      {
+         printf("\nTransaction ID %d is used more than once in %s.\n",
+            p->id, file_name);
+         printf("\nThe program will exit so no data is lost.\n\n");
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   for(p = first_transaction(store, &cursor); p != NULL;
+      p = next_transaction(&cursor))
+   {
+      if(p->id == NO_TRANSACTION_ID)
+      {
+         /* The table has room, so this only fails when IDs run out */
+         if(!index_transaction(p))
+         {
+            printf("\nThere are no more transaction IDs for %s.\n",
+               file_name);
+            printf("\nThe program will exit so no data is lost.\n\n");
+            return FILE_OPS_ERROR;
+         }
+
+         ids_given++;
+      }
+   }
+
+   return ids_given;
+}
+
+
+
+BOOL index_transaction(struct transaction *node)
+{
+   if(node->id == NO_TRANSACTION_ID)
+   {
+      if(next_id > MAX_TRANSACTION_ID)
+      {
+         return FALSE;
+      }
+
+      node->id = (int) next_id;
+   }
+
+   return add_to_index(node);
+}
+
+
+
+/*
+ *
+ * Takes a node out of the table, and moves the nodes after it in
+ * the same run of slots back, so every node can still be found by
+ * probing from its own slot
+ *
+ */
+void unindex_transaction(const struct transaction *node)
+{
+   unsigned long i;
+   unsigned long j;
+   unsigned long home;
+
+   if(number_of_slots == 0)
+   {
+      return;
+   }
+
+   i = index_slot(node->id);
+   while(slots[i] != NULL && slots[i] != node)
+   {
+      i = (i + 1) & (number_of_slots - 1);
+   }
+
+   if(slots[i] == NULL)
+   {
+      return;
+   }
+
+   slots[i] = NULL;
+   number_of_indexed--;
+
+   remove_from_date_index(node);
+   remove_from_search_index(node);
+   remove_from_balance(node);
+   remove_from_rollups(node);
+   remove_from_date_totals(node);
+   remove_from_amount_column(node);
+
+   for(j = (i + 1) & (number_of_slots - 1); slots[j] != NULL;
+      j = (j + 1) & (number_of_slots - 1))
+   {
+      home = index_slot(slots[j]->id);
+
+      /* Move it back unless its home slot is after the hole */
+      if((j > i && (home <= i || home > j))
+         || (j < i && home <= i && home > j))
+      {
+         slots[i] = slots[j];
+         slots[j] = NULL;
+         i = j;
+      }
+   }
+}
+
+
+
+void reindex_transaction(struct transaction *node)
+{
+   unsigned long i;
+
+   if(number_of_slots == 0)
+   {
+      return;
+   }
+
+   i = index_slot(node->id);
+   while(slots[i] != NULL && slots[i]->id != node->id)
+   {
+      i = (i + 1) & (number_of_slots - 1);
+   }
+
+   if(slots[i] != NULL)
+   {
+      slots[i] = node;
+   }
+}
+
+
+
+struct transaction *find_transaction(int id)
+{
+   unsigned long i;
+
+   if(number_of_slots == 0)
+   {
+      return NULL;
+   }
+
+   i = index_slot(id);
+   while(slots[i] != NULL && slots[i]->id != id)
+   {
+      i = (i + 1) & (number_of_slots - 1);
+   }
+
+   return slots[i];
+}
+
+
+
+long get_next_transaction_id(void)
+{
+   return next_id;
+}
+
+
+
+void set_next_transaction_id(long id)
+{
+   if(id > next_id)
+   {
+      next_id = id;
+   }
+}
+
+
+
+void free_transaction_index(void)
+{
+   free(slots);
+   slots = NULL;
+   number_of_slots = 0;
+   slot_bits = 0;
+   number_of_indexed = 0;
+}
+
+
+
+/*
+ *
+ * Fibonacci hashing: multiplying by 2^32 divided by the golden ratio
+ * mixes every bit of the ID into the high bits of the low 32 bits of
+ * the product, so we keep the top slot_bits of those. IDs handed out
+ * in order are spread evenly, and so are IDs typed into the file by
+ * hand that only differ in their high bits, which the low bits of
+ * the product wouldn't tell apart.
+ *
+ */
+unsigned long index_slot(int id)
+{
+   return (((unsigned long) id * 2654435761UL) & 0xffffffffUL)
+      >> (32 - slot_bits);
+}
+
+
+
+/*
+ *
+ * Returns FALSE if the node's ID is already in the table,
+ * or if the table is full and can't grow
+ *
+ */
+BOOL add_to_index(struct transaction *node)
+{
+   unsigned long i;
+
+   if((number_of_indexed + 1) * 2 > number_of_slots
+      && !grow_index(number_of_indexed + 1))
+   {
+      return FALSE;
+   }
+
+   i = index_slot(node->id);
+   while(slots[i] != NULL)
+   {
+      if(slots[i]->id == node->id)
+      {
+         return FALSE;
+      }
+
+      i = (i + 1) & (number_of_slots - 1);
+   }
+
+   slots[i] = node;
+   number_of_indexed++;
+
+   add_to_date_index(node);
+   add_to_search_index(node);
+   add_to_balance(node);
+   add_to_rollups(node);
+   add_to_date_totals(node);
+   add_to_amount_column(node);
+
+   if(node->id >= next_id)
+   {
+      next_id = (long) node->id + 1;
+   }
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Doubles the table until it is at least twice as big as
+ * number_of_nodes, and puts every node back in it
+ *
+ */
+BOOL grow_index(unsigned long number_of_nodes)
+{
+   struct transaction **old_slots = slots;
+   unsigned long old_number_of_slots = number_of_slots;
+   int old_slot_bits = slot_bits;
+   unsigned long i;
+   unsigned long j;
+
+   if(number_of_slots == 0)
+   {
+      number_of_slots = MIN_INDEX_SLOTS;
+      slot_bits = MIN_INDEX_SLOT_BITS;
+   }
+
+   while(number_of_slots < number_of_nodes * 2)
+   {
+      number_of_slots *= 2;
+      slot_bits++;
+   }
+
+   slots = calloc(number_of_slots, sizeof(struct transaction *));
+   if(slots == NULL)
+   {
+      slots = old_slots;
+      number_of_slots = old_number_of_slots;
+      slot_bits = old_slot_bits;
+      return FALSE;
+   }
+
+   for(i = 0; i < old_number_of_slots; i++)
+   {
+      if(old_slots[i] == NULL)
+      {
+         continue;
+      }
+
+      j = index_slot(old_slots[i]->id);
+      while(slots[j] != NULL)
+      {
+         j = (j + 1) & (number_of_slots - 1);
+      }
+
+      slots[j] = old_slots[i];
+   }
+
+   free(old_slots);
+
+   return TRUE;
+}
+
+
+
@@ -0,0 +1,72 @@
+/*
+ *
+ * Name:       transaction_index.h
+ *
+ * Purpose:    Contains function prototypes for finding a transaction
+ *             by its ID without walking the store.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_INDEX_H
+#define TRANSACTION_INDEX_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/* IDs have to fit in the ID_INPUT_LENGTH digits the user can type */
+#define MAX_TRANSACTION_ID 999999999L
+
+/* The hash table starts with this many slots, and doubles when half full */
+#define MIN_INDEX_SLOTS 1024
+#define MIN_INDEX_SLOT_BITS 10
+
+/*
+ * Adds every transaction of a store that was just loaded to the index.
+ * Transactions that were saved without an ID get the next free one,
+ * in order. Returns the number of IDs given out, or FILE_OPS_ERROR if
+ * two transactions have the same ID or we run out of memory.
+ */
+int index_transactions(const struct transaction_store *store,
+   const char *file_name);
+
+/*
+ * Adds one transaction. If it has no ID yet, it gets the next free one.
+ * Returns FALSE if its ID is already used, if every ID up to
+ * MAX_TRANSACTION_ID has been given out, or if we run out of memory.
+ */
+BOOL index_transaction(struct transaction *node);
+
+void unindex_transaction(const struct transaction *node);
+
+/* Points the index at a transaction the store has moved */
+void reindex_transaction(struct transaction *node);
+
+/* Returns NULL if there is no transaction with that ID */
+struct transaction *find_transaction(int id);
+
+/*
+ * The ID the next new transaction will get. The sharded budget keeps
+ * this in its index file, since the months that aren't loaded may
+ * hold higher IDs than any we have seen.
+ */
+long get_next_transaction_id(void);
+void set_next_transaction_id(long id);
+
+void free_transaction_index(void);
+
+#endif
+
+
+
@@ -0,0 +1,225 @@
+/*
+ *
+ * Name:       transaction_pool.c
+ *
+ * Purpose:    Contains functions for handing out blocks of the
+ *             transaction store from big slabs of memory instead of
+ *             one malloc() each.
+ *
+ *             Loading a large budget used to ask the system for memory
+ *             once per transaction. Now the store's blocks are cut from
+ *             slabs that double in size, so a million rows take a few
+ *             dozen allocations. Blocks the store no longer needs go
+ *             on a free list and are reused, and everything is given
+ *             back at once when the program quits.
+ *
+ *             The parallel loader allocates from several threads, so
+ *             the pool is guarded by a mutex where we have POSIX
+ *             threads.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ * The POSIX headers need this before any other #include.
+ *
+ */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
+#define _POSIX_C_SOURCE 200112L
+#define HAVE_PTHREADS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "transaction_pool.h"
+#include "description_pool.h"
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* A slab of blocks, with the blocks right after the header */
+struct slab
+{
+   struct slab *next;
+   long number_of_blocks;
+   struct store_block blocks[1];
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+BOOL add_slab(void);
+
+/*
+ * The slabs, newest first. Blocks from the newest slab are handed out
+ * in order until it is used up. free_blocks is linked through next.
+ */
+static struct slab *slabs = NULL;
+static long next_slab_block = 0;
+static struct store_block *free_blocks = NULL;
+
+/* What the pool has done, for print_memory_statistics() */
+static long slab_allocations = 0;
+static unsigned long slab_bytes = 0;
+static long blocks_in_use = 0;
+static long blocks_reused = 0;
+
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+
+
+struct store_block *pool_allocate_block(void)
+{
+   struct store_block *block = NULL;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   if(free_blocks != NULL)
+   {
+      block = free_blocks;
+      free_blocks = block->next;
+      blocks_reused++;
+   }
+   else if((slabs != NULL && next_slab_block < slabs->number_of_blocks)
+      || add_slab())
+   {
+      block = &slabs->blocks[next_slab_block++];
+   }
+
+   if(block != NULL)
+   {
+      blocks_in_use++;
+   }
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+
+   return block;
+}
+
+
+
+void pool_free_block(struct store_block *block)
+{
+#ifdef HAVE_PTHREADS
+   pthread_mutex_lock(&pool_mutex);
+#endif
+
+   block->next = free_blocks;
+   free_blocks = block;
+   blocks_in_use--;
+
+#ifdef HAVE_PTHREADS
+   pthread_mutex_unlock(&pool_mutex);
+#endif
+}
+
+
+
+void free_memory_pools(void)
+{
+   struct slab *next;
+
+   while(slabs != NULL)
+   {
+      next = slabs->next;
+      free(slabs);
+      slabs = next;
+   }
+
+   next_slab_block = 0;
+   free_blocks = NULL;
+   blocks_in_use = 0;
+
+   free_description_pool();
+}
+
+
+
+void print_memory_statistics(void)
+{
+   long description_allocations;
+   long number_of_descriptions;
+   unsigned long description_bytes;
+
+   get_description_pool_statistics(&description_allocations,
+      &number_of_descriptions, &description_bytes);
+
+   printf("\nMemory used by the budget:\n\n");
+   printf("   %ld blocks of %d transactions in %ld slabs (%lu bytes),"
+      " %ld reused\n", blocks_in_use, STORE_BLOCK_RECORDS, slab_allocations,
+      slab_bytes, blocks_reused);
+   printf("   %ld different descriptions in %ld allocations (%lu bytes)\n",
+      number_of_descriptions, description_allocations, description_bytes);
+   printf("   %ld system allocations in all\n",
+      slab_allocations + description_allocations);
+}
+
+
+
+/*
+ *
+ * Allocates a slab twice the size of the last one, so the number of
+ * allocations only grows with the log of the number of blocks
+ *
+ */
+BOOL add_slab(void)
+{
+   struct slab *slab;
+   long number_of_blocks = MIN_SLAB_BLOCKS;
+   size_t size;
+
+   if(slabs != NULL)
+   {
+      number_of_blocks = slabs->number_of_blocks * 2;
+      if(number_of_blocks > MAX_SLAB_BLOCKS)
+      {
+         number_of_blocks = MAX_SLAB_BLOCKS;
+      }
+   }
+
+   size = sizeof(struct slab)
+      + (size_t) (number_of_blocks - 1) * sizeof(struct store_block);
+
+   slab = malloc(size);
+   if(slab == NULL)
+   {
+      return FALSE;
+   }
+
+   slab->next = slabs;
+   slab->number_of_blocks = number_of_blocks;
+   slabs = slab;
+   next_slab_block = 0;
+
+   slab_allocations++;
+   slab_bytes += size;
+
+   return TRUE;
+}
+
+
+
@@ -0,0 +1,52 @@
+/*
+ *
+ * Name:       transaction_pool.h
+ *
+ * Purpose:    Contains function prototypes for handing out blocks of
+ *             the transaction store from big slabs of memory instead
+ *             of one malloc() each.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_POOL_H
+#define TRANSACTION_POOL_H
+#include "transaction_store.h"
+
+/*
+ * The first slab holds this many blocks of the store, and each one
+ * after that twice as many as the last, up to MAX_SLAB_BLOCKS
+ */
+#define MIN_SLAB_BLOCKS 8
+#define MAX_SLAB_BLOCKS 8192L
+
+/* Returns NULL if we run out of memory */
+struct store_block *pool_allocate_block(void);
+
+/* Puts a block on the free list, for the next allocation to reuse */
+void pool_free_block(struct store_block *block);
+
+/*
+ * Gives every slab, and every copy in the description pool, back to
+ * the system at once. No transaction may be used after this.
+ */
+void free_memory_pools(void);
+
+/* Prints how many times the pools asked the system for memory */
+void print_memory_statistics(void);
+
+#endif
+
+
+
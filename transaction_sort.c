@@ -0,0 +1,743 @@
+/*
+ *
+ * Name:       transaction_sort.c
+ *
+ * Purpose:    Contains functions for sorting transactions by date,
+ *             amount, or description.
+ *
+ *             Transactions are copied into a buffer that can hold as
+ *             many as fit in the memory set for sorts. If they all
+ *             fit, the buffer is sorted and read back in order. If
+ *             not, each time the buffer fills it is sorted and written
+ *             to a temporary file as a run, and the runs are merged at
+ *             the end with a heap that holds the first transaction of
+ *             each run, so only one transaction per run is in memory.
+ *             When there are too many runs to read at once, groups of
+ *             them are merged into longer runs first.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <ctype.h>
+#include <string.h>
+#include <time.h>
+#include "transaction_sort.h"
+
+/*
+ * The buffer starts with room for this many transactions, and doubles,
+ * and a sort always gets at least this many however little memory it
+ * was given
+ */
+#define MIN_SORT_RECORDS 1024
+
+/* The most runs that are merged at once, each with a file open */
+#define MAX_MERGE_RUNS 64
+
+/* The runs array starts with room for this many, and doubles */
+#define MIN_SORT_RUNS 16
+
+/*
+ * A transaction in a run is its day, amount, ID, type, and the length
+ * of its description, followed by the description without its '\0'
+ */
+#define RUN_HEADER_SIZE (sizeof(int) + sizeof(CENTS) + sizeof(int) + 2)
+
+/* How many different descriptions the benchmark's transactions have */
+#define BENCHMARK_DESCRIPTIONS 1000
+
+struct sort_run
+{
+   FILE *fp;
+
+   /* The run's first transaction that hasn't been merged yet */
+   struct transaction current;
+   char description[DESCRIPTION_LENGTH + 1];
+};
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+int compare_sorted(const struct transaction *a, const struct transaction *b,
+   int key);
+int compare_records(const void *a, const void *b);
+int compare_descriptions(const char *a, const char *b);
+int write_run(struct transaction_sort *sort);
+BOOL add_run(struct transaction_sort *sort, FILE *fp);
+BOOL write_run_record(FILE *fp, const struct transaction *node);
+int read_run_record(struct sort_run *run);
+int start_merge(struct transaction_sort *sort, int number_of_runs);
+const struct transaction *next_merged(struct transaction_sort *sort);
+void sift_down(struct transaction_sort *sort, int i);
+int merge_first_runs(struct transaction_sort *sort);
+long random_number(long limit);
+
+static long sort_memory = DEFAULT_SORT_MEMORY;
+
+/* qsort() can't pass the key to compare_records(), so it is kept here */
+static int qsort_key = SORT_BY_DATE;
+
+
+
+void set_sort_memory(long bytes)
+{
+   sort_memory = bytes;
+}
+
+
+
+int start_sort(struct transaction_sort *sort, int key)
+{
+   sort->key = key;
+   sort->number_of_records = 0;
+   sort->number_of_slots = MIN_SORT_RECORDS;
+   sort->max_records = sort_memory / (long) sizeof(struct transaction);
+   sort->next_record = 0;
+   sort->runs = NULL;
+   sort->number_of_runs = 0;
+   sort->max_runs = 0;
+   sort->heap = NULL;
+   sort->heap_size = 0;
+   sort->failed = FALSE;
+
+   if(sort->max_records < MIN_SORT_RECORDS)
+   {
+      sort->max_records = MIN_SORT_RECORDS;
+   }
+
+   sort->records = malloc(sizeof(struct transaction) * MIN_SORT_RECORDS);
+   if(sort->records == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   return 0;
+}
+
+
+
+int add_to_sort(struct transaction_sort *sort, const struct transaction *node)
+{
+   struct transaction *new_records;
+   long new_slots;
+
+   if(sort->number_of_records == sort->number_of_slots)
+   {
+      new_slots = sort->number_of_slots * 2 > sort->max_records
+         ? sort->max_records : sort->number_of_slots * 2;
+
+      /* If the buffer can't grow, it is full, and becomes a run */
+      new_records = new_slots == sort->number_of_slots ? NULL
+         : realloc(sort->records, sizeof(struct transaction)
+            * (size_t) new_slots);
+
+      if(new_records != NULL)
+      {
+         sort->records = new_records;
+         sort->number_of_slots = new_slots;
+      }
+      else if(write_run(sort) == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   sort->records[sort->number_of_records++] = *node;
+
+   return 0;
+}
+
+
+
+int finish_sort(struct transaction_sort *sort)
+{
+   if(sort->number_of_runs == 0)
+   {
+      qsort_key = sort->key;
+      qsort(sort->records, (size_t) sort->number_of_records,
+         sizeof(struct transaction), compare_records);
+
+      return 0;
+   }
+
+   if(sort->number_of_records > 0 && write_run(sort) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   /* The buffer isn't needed while merging */
+   free(sort->records);
+   sort->records = NULL;
+   sort->number_of_slots = 0;
+
+   while(sort->number_of_runs > MAX_MERGE_RUNS)
+   {
+      if(merge_first_runs(sort) == FILE_OPS_ERROR)
+      {
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   return start_merge(sort, sort->number_of_runs);
+}
+
+
+
+const struct transaction *next_sorted(struct transaction_sort *sort)
+{
+   if(sort->number_of_runs > 0)
+   {
+      return next_merged(sort);
+   }
+
+   if(sort->next_record == sort->number_of_records)
+   {
+      return NULL;
+   }
+
+   return &sort->records[sort->next_record++];
+}
+
+
+
+void free_sort(struct transaction_sort *sort)
+{
+   int i;
+
+   /* A temporary file is deleted when it is closed */
+   for(i = 0; i < sort->number_of_runs; i++)
+   {
+      fclose(sort->runs[i].fp);
+   }
+
+   free(sort->records);
+   free(sort->runs);
+   free(sort->heap);
+
+   sort->records = NULL;
+   sort->runs = NULL;
+   sort->heap = NULL;
+   sort->number_of_records = 0;
+   sort->number_of_slots = 0;
+   sort->number_of_runs = 0;
+   sort->max_runs = 0;
+   sort->heap_size = 0;
+}
+
+
+
+int print_sort_benchmark(long number_of_records)
+{
+   struct transaction_sort sort;
+   struct transaction node;
+   const struct transaction *p;
+   char descriptions[BENCHMARK_DESCRIPTIONS][24];
+   clock_t start;
+   double run_seconds;
+   double merge_seconds;
+   long last_day = 0;
+   long last_id = 0;
+   long number_sorted = 0;
+   long i;
+   int number_of_runs;
+
+   for(i = 0; i < BENCHMARK_DESCRIPTIONS; i++)
+   {
+      sprintf(descriptions[i], "Description %ld", i);
+   }
+
+   if(start_sort(&sort, SORT_BY_DATE) == FILE_OPS_ERROR)
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   /* Made-up transactions over about 50 years, with the same seed */
+   srand(1);
+   node.shard = 0;
+   node.deleted = FALSE;
+
+   start = clock();
+   for(i = 0; i < number_of_records; i++)
+   {
+      node.day = (int) random_number(18262);
+      node.amount = random_number(1000000);
+      node.id = (int) (i + 1);
+      node.type = (unsigned char) (rand() & 1);
+      node.description = descriptions[rand() % BENCHMARK_DESCRIPTIONS];
+
+      if(add_to_sort(&sort, &node) == FILE_OPS_ERROR)
+      {
+         free_sort(&sort);
+         return FILE_OPS_ERROR;
+      }
+   }
+
+   number_of_runs = sort.number_of_runs + (sort.number_of_records > 0);
+   run_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   start = clock();
+   if(finish_sort(&sort) == FILE_OPS_ERROR)
+   {
+      free_sort(&sort);
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = next_sorted(&sort); p != NULL; p = next_sorted(&sort))
+   {
+      if(p->day < last_day || (p->day == last_day && p->id <= last_id))
+      {
+         printf("\nThe transactions didn't come out in order.\n");
+         free_sort(&sort);
+         return FILE_OPS_ERROR;
+      }
+
+      last_day = p->day;
+      last_id = p->id;
+      number_sorted++;
+   }
+
+   merge_seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+   if(sort.failed || number_sorted != number_of_records)
+   {
+      printf("\nThe sort lost some of the transactions.\n");
+      free_sort(&sort);
+      return FILE_OPS_ERROR;
+   }
+
+   printf("\nSorting %ld transactions by date in %ld KB of memory:\n\n",
+      number_of_records, sort_memory / 1024);
+
+   if(sort.number_of_runs == 0)
+   {
+      printf("   In memory: %.3f s\n", run_seconds + merge_seconds);
+   }
+   else
+   {
+      printf("   Adding them and writing %d runs: %.3f s\n",
+         number_of_runs, run_seconds);
+      printf("   Merging the runs: %.3f s\n", merge_seconds);
+   }
+
+   free_sort(&sort);
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Orders two transactions by the sort key, and then by ID, so every
+ * sort comes out the same whether it fit in memory or not
+ *
+ */
+int compare_sorted(const struct transaction *a, const struct transaction *b,
+   int key)
+{
+   int result = 0;
+
+   if(key == SORT_BY_DATE)
+   {
+      result = a->day < b->day ? -1 : a->day > b->day;
+   }
+   else if(key == SORT_BY_AMOUNT)
+   {
+      result = a->amount < b->amount ? -1 : a->amount > b->amount;
+   }
+   else if(key == SORT_BY_DESCRIPTION && a->description != b->description)
+   {
+      result = compare_descriptions(a->description, b->description);
+   }
+
+   if(result == 0)
+   {
+      result = a->id < b->id ? -1 : a->id > b->id;
+   }
+
+   return result;
+}
+
+
+
+int compare_records(const void *a, const void *b)
+{
+   return compare_sorted(a, b, qsort_key);
+}
+
+
+
+/* Descriptions sort without regard to case, and then with it */
+int compare_descriptions(const char *a, const char *b)
+{
+   const unsigned char *p = (const unsigned char *) a;
+   const unsigned char *q = (const unsigned char *) b;
+
+   while(*p != '\0' && tolower(*p) == tolower(*q))
+   {
+      p++;
+      q++;
+   }
+
+   if(tolower(*p) != tolower(*q))
+   {
+      return tolower(*p) < tolower(*q) ? -1 : 1;
+   }
+
+   return strcmp(a, b);
+}
+
+
+
+/*
+ *
+ * Sorts the buffer and writes it to a new temporary file as a run,
+ * which leaves the buffer empty
+ *
+ */
+int write_run(struct transaction_sort *sort)
+{
+   FILE *fp;
+   long i;
+
+   qsort_key = sort->key;
+   qsort(sort->records, (size_t) sort->number_of_records,
+      sizeof(struct transaction), compare_records);
+
+   fp = tmpfile();
+   if(fp == NULL)
+   {
+      printf("\nA temporary file for sorting couldn't be created.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(i = 0; i < sort->number_of_records; i++)
+   {
+      if(!write_run_record(fp, &sort->records[i]))
+      {
+         break;
+      }
+   }
+
+   if(i < sort->number_of_records || fflush(fp) != 0 || !add_run(sort, fp))
+   {
+      printf("\nThe transactions couldn't be written to a temporary file.\n");
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   sort->number_of_records = 0;
+
+   return 0;
+}
+
+
+
+/* Adds a written file to the runs, ready to be read from the start */
+BOOL add_run(struct transaction_sort *sort, FILE *fp)
+{
+   struct sort_run *new_runs;
+   int new_max;
+
+   if(sort->number_of_runs == sort->max_runs)
+   {
+      new_max = sort->max_runs == 0 ? MIN_SORT_RUNS : sort->max_runs * 2;
+      new_runs = realloc(sort->runs, sizeof(struct sort_run)
+         * (size_t) new_max);
+      if(new_runs == NULL)
+      {
+         return FALSE;
+      }
+
+      sort->runs = new_runs;
+      sort->max_runs = new_max;
+   }
+
+   rewind(fp);
+   sort->runs[sort->number_of_runs++].fp = fp;
+
+   return TRUE;
+}
+
+
+
+BOOL write_run_record(FILE *fp, const struct transaction *node)
+{
+   unsigned char record[RUN_HEADER_SIZE + DESCRIPTION_LENGTH];
+   unsigned char *p = record;
+   size_t length = strlen(node->description);
+   int day = node->day;
+   int id = node->id;
+
+   memcpy(p, &day, sizeof(int));
+   p += sizeof(int);
+   memcpy(p, &node->amount, sizeof(CENTS));
+   p += sizeof(CENTS);
+   memcpy(p, &id, sizeof(int));
+   p += sizeof(int);
+   *p++ = node->type;
+   *p++ = (unsigned char) length;
+   memcpy(p, node->description, length);
+
+   return fwrite(record, RUN_HEADER_SIZE + length, 1, fp) == 1;
+}
+
+
+
+/*
+ *
+ * Reads the next transaction of a run into run->current. Returns 1 if
+ * there was one, 0 at the end of the run, and FILE_OPS_ERROR if the
+ * file can't be read.
+ *
+ */
+int read_run_record(struct sort_run *run)
+{
+   unsigned char header[RUN_HEADER_SIZE];
+   unsigned char *p = header;
+   size_t length;
+   int day;
+   int id;
+
+   if(fread(header, RUN_HEADER_SIZE, 1, run->fp) != 1)
+   {
+      return ferror(run->fp) ? FILE_OPS_ERROR : 0;
+   }
+
+   memcpy(&day, p, sizeof(int));
+   p += sizeof(int);
+   memcpy(&run->current.amount, p, sizeof(CENTS));
+   p += sizeof(CENTS);
+   memcpy(&id, p, sizeof(int));
+   p += sizeof(int);
+   run->current.type = *p++;
+   length = *p;
+
+   if(length > DESCRIPTION_LENGTH
+      || (length > 0 && fread(run->description, length, 1, run->fp) != 1))
+   {
+      return FILE_OPS_ERROR;
+   }
+
+   run->description[length] = '\0';
+   run->current.day = day;
+   run->current.id = id;
+   run->current.shard = 0;
+   run->current.deleted = FALSE;
+   run->current.description = run->description;
+
+   return 1;
+}
+
+
+
+/*
+ *
+ * Reads the first transaction of each of the first number_of_runs
+ * runs, and makes a heap of the runs that have one
+ *
+ */
+int start_merge(struct transaction_sort *sort, int number_of_runs)
+{
+   int result;
+   int i;
+
+   free(sort->heap);
+   sort->heap = malloc(sizeof(int) * (size_t) number_of_runs);
+   sort->heap_size = 0;
+   if(sort->heap == NULL)
+   {
+      printf("\nMemory allocation error.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   for(i = 0; i < number_of_runs; i++)
+   {
+      result = read_run_record(&sort->runs[i]);
+      if(result == FILE_OPS_ERROR)
+      {
+         printf("\nA temporary file for sorting couldn't be read.\n");
+         return FILE_OPS_ERROR;
+      }
+
+      if(result == 1)
+      {
+         sort->heap[sort->heap_size++] = i;
+      }
+   }
+
+   for(i = sort->heap_size / 2 - 1; i >= 0; i--)
+   {
+      sift_down(sort, i);
+   }
+
+   return 0;
+}
+
+
+
+/*
+ *
+ * Takes the transaction at the top of the heap, and replaces it with
+ * the next one from the same run
+ *
+ */
+const struct transaction *next_merged(struct transaction_sort *sort)
+{
+   struct sort_run *run;
+   int result;
+
+   if(sort->heap_size == 0)
+   {
+      return NULL;
+   }
+
+   run = &sort->runs[sort->heap[0]];
+   sort->merged = run->current;
+   strcpy(sort->merged_description, run->description);
+   sort->merged.description = sort->merged_description;
+
+   result = read_run_record(run);
+   if(result == FILE_OPS_ERROR)
+   {
+      printf("\nA temporary file for sorting couldn't be read.\n");
+      sort->failed = TRUE;
+      return NULL;
+   }
+
+   if(result == 0)
+   {
+      sort->heap[0] = sort->heap[--sort->heap_size];
+   }
+
+   sift_down(sort, 0);
+
+   return &sort->merged;
+}
+
+
+
+void sift_down(struct transaction_sort *sort, int i)
+{
+   int smallest;
+   int child;
+   int temp;
+
+   for( ;; )
+   {
+      smallest = i;
+
+      for(child = 2 * i + 1; child <= 2 * i + 2; child++)
+      {
+         if(child < sort->heap_size
+            && compare_sorted(&sort->runs[sort->heap[child]].current,
+               &sort->runs[sort->heap[smallest]].current, sort->key) < 0)
+         {
+            smallest = child;
+         }
+      }
+
+      if(smallest == i)
+      {
+         return;
+      }
+
+      temp = sort->heap[i];
+      sort->heap[i] = sort->heap[smallest];
+      sort->heap[smallest] = temp;
+      i = smallest;
+   }
+}
+
+
+
+/*
+ *
+ * Merges the first MAX_MERGE_RUNS runs into one new run at the end,
+ * so there are fewer files to read at once
+ *
+ */
+int merge_first_runs(struct transaction_sort *sort)
+{
+   const struct transaction *p;
+   FILE *fp;
+   int i;
+
+   fp = tmpfile();
+   if(fp == NULL)
+   {
+      printf("\nA temporary file for sorting couldn't be created.\n");
+      return FILE_OPS_ERROR;
+   }
+
+   if(start_merge(sort, MAX_MERGE_RUNS) == FILE_OPS_ERROR)
+   {
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   for(p = next_merged(sort); p != NULL; p = next_merged(sort))
+   {
+      if(!write_run_record(fp, p))
+      {
+         break;
+      }
+   }
+
+   if(sort->failed)
+   {
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   for(i = 0; i < MAX_MERGE_RUNS; i++)
+   {
+      fclose(sort->runs[i].fp);
+   }
+
+   sort->number_of_runs -= MAX_MERGE_RUNS;
+   memmove(sort->runs, sort->runs + MAX_MERGE_RUNS,
+      sizeof(struct sort_run) * (size_t) sort->number_of_runs);
+
+   /* There is always room, since runs were just taken out */
+   if(p != NULL || fflush(fp) != 0 || !add_run(sort, fp))
+   {
+      printf("\nThe transactions couldn't be written to a temporary file.\n");
+      fclose(fp);
+      return FILE_OPS_ERROR;
+   }
+
+   return 0;
+}
+
+
+
+/* rand() may only go up to 32767, so two of them make enough */
+long random_number(long limit)
+{
+   long r = (long) rand() * ((long) RAND_MAX + 1) + rand();
+
+   return r % limit;
+}
+
+
+
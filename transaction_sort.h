@@ -0,0 +1,121 @@
+/*
+ *
+ * Name:       transaction_sort.h
+ *
+ * Purpose:    Contains function prototypes for sorting transactions
+ *             by date, amount, or description, in memory or, when
+ *             there are too many, in sorted runs on the disk.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_SORT_H
+#define TRANSACTION_SORT_H
+#include <stdio.h>
+#include "transaction_store.h"
+#include "read_input.h"
+
+/* What the transactions are sorted by. Equal ones go in order of ID. */
+#define SORT_BY_DATE 1
+#define SORT_BY_AMOUNT 2
+#define SORT_BY_DESCRIPTION 3
+
+/* How much memory a sort may hold its transactions in, unless set */
+#define DEFAULT_SORT_MEMORY (64L * 1024 * 1024)
+
+/* The most --sort-memory can ask for, so the bytes fit in a 32-bit long */
+#define MAX_SORT_MEGABYTES 2047
+
+/* One run of sorted transactions saved in a temporary file */
+struct sort_run;
+
+/*
+ * A sort in progress. Transactions are copied in with add_to_sort(),
+ * and come back out in order from next_sorted() after finish_sort().
+ * The descriptions aren't copied until a run is written, so they
+ * must not change or go away before the sort is freed.
+ */
+struct transaction_sort
+{
+   int key;
+
+   /* The transactions that haven't been written to a run yet */
+   struct transaction *records;
+   long number_of_records;
+
+   /* records has room for number_of_slots, and grows up to max_records */
+   long number_of_slots;
+   long max_records;
+
+   /* Where next_sorted() is in records, when there are no runs */
+   long next_record;
+
+   struct sort_run *runs;
+   int number_of_runs;
+   int max_runs;
+
+   /* The runs being merged, smallest first transaction at the top */
+   int *heap;
+   int heap_size;
+
+   /* The last transaction merged from the runs, and its description */
+   struct transaction merged;
+   char merged_description[DESCRIPTION_LENGTH + 1];
+
+   BOOL failed;
+};
+
+/*
+ * Sets how many bytes of memory each sort may hold its transactions
+ * in. More than that are sorted in runs and merged from the disk.
+ */
+void set_sort_memory(long bytes);
+
+/* Returns FILE_OPS_ERROR if we run out of memory */
+int start_sort(struct transaction_sort *sort, int key);
+
+/*
+ * Copies a transaction into the sort. Returns FILE_OPS_ERROR if a run
+ * can't be written.
+ */
+int add_to_sort(struct transaction_sort *sort, const struct transaction *node);
+
+/*
+ * Sorts what is left in memory. If runs were written, the last one is
+ * too, and the runs are merged down to few enough to read at once.
+ * Returns FILE_OPS_ERROR if a run can't be written or read.
+ */
+int finish_sort(struct transaction_sort *sort);
+
+/*
+ * Returns the next transaction in order, or NULL after the last one,
+ * or if a run can't be read, and then sort->failed is TRUE. The
+ * transaction is only good until the next call.
+ */
+const struct transaction *next_sorted(struct transaction_sort *sort);
+
+/* Frees the memory and deletes the runs' temporary files */
+void free_sort(struct transaction_sort *sort);
+
+/*
+ * Sorts number_of_records made-up transactions by date with the memory
+ * set for sorts, checks that they come out in order, and prints how
+ * long it took
+ */
+int print_sort_benchmark(long number_of_records);
+
+#endif
+
+
+
@@ -0,0 +1,392 @@
+/*
+ *
+ * Name:       transaction_store.c
+ *
+ * Purpose:    Contains functions for keeping the budget in blocks of
+ *             records.
+ *
+ *             The budget used to be a linked list, so going through it
+ *             meant following one pointer per transaction, and the
+ *             next transaction could be anywhere in memory. Now it is
+ *             an unrolled list: each block holds STORE_BLOCK_RECORDS
+ *             transactions side by side, new ones are added to the
+ *             end of the last block, and a walk through the budget
+ *             reads each block from start to end.
+ *
+ *             Deleting a transaction only marks it as deleted. Once
+ *             enough of them are, the store is compacted in one pass,
+ *             so deleting costs O(1) on average.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include "transaction_store.h"
+#include "transaction_pool.h"
+#include "transaction_index.h"
+#include "description_pool.h"
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+void compact_store(struct transaction_store *store);
+void repack_descriptions(struct transaction_store *store);
+
+
+
+void init_store(struct transaction_store *store)
+{
+   store->first = NULL;
+   store->last = NULL;
+   store->number_of_transactions = 0;
+   store->number_of_deleted = 0;
+}
+
+
+
+struct transaction *add_to_store(struct transaction_store *store)
+{
+   struct store_block *block = store->last;
+   struct transaction *record;
+
+   if(block == NULL || block->used == STORE_BLOCK_RECORDS)
+   {
+      block = pool_allocate_block();
+      if(block == NULL)
+      {
+         return NULL;
+      }
+
+      block->next = NULL;
+      block->used = 0;
+
+      if(store->last == NULL)
+      {
+         store->first = block;
+      }
+      else
+      {
+         store->last->next = block;
+      }
+
+      store->last = block;
+   }
+
+   record = &block->records[block->used++];
+   store->number_of_transactions++;
+
+   record->shard = NO_SHARD;
+   record->id = NO_TRANSACTION_ID;
+   record->deleted = FALSE;
+
+   return record;
+}
+
+
+
+void delete_from_store(struct transaction_store *store,
+   struct transaction *record)
+{
+   struct store_block *last = store->last;
+
+   record->deleted = TRUE;
+   store->number_of_transactions--;
+   store->number_of_deleted++;
+
+   /* Deleted records at the very end can just be dropped */
+   while(last->used > 0 && last->records[last->used - 1].deleted)
+   {
+      last->used--;
+      store->number_of_deleted--;
+   }
+
+   if(store->number_of_deleted >= STORE_BLOCK_RECORDS
+      && store->number_of_deleted * 100 >= (store->number_of_transactions
+         + store->number_of_deleted) * STORE_COMPACT_PERCENT)
+   {
+      compact_store(store);
+
+      /* Deleted and changed descriptions leave gaps in the pool too */
+      if(description_pool_is_wasteful())
+      {
+         repack_descriptions(store);
+      }
+   }
+}
+
+
+
+void append_store(struct transaction_store *store,
+   struct transaction_store *other)
+{
+   if(other->first == NULL)
+   {
+      return;
+   }
+
+   if(store->last == NULL)
+   {
+      store->first = other->first;
+   }
+   else
+   {
+      store->last->next = other->first;
+   }
+
+   store->last = other->last;
+   store->number_of_transactions += other->number_of_transactions;
+   store->number_of_deleted += other->number_of_deleted;
+
+   init_store(other);
+}
+
+
+
+void free_store(struct transaction_store *store)
+{
+   struct store_block *next;
+
+   while(store->first != NULL)
+   {
+      next = store->first->next;
+      pool_free_block(store->first);
+      store->first = next;
+   }
+
+   init_store(store);
+}
+
+
+
+struct transaction *first_transaction(const struct transaction_store *store,
+   struct store_cursor *cursor)
+{
+   cursor->block = store->first;
+   cursor->record = -1;
+
+   return next_transaction(cursor);
+}
+
+
+
+struct transaction *next_transaction(struct store_cursor *cursor)
+{
+   struct store_block *block = cursor->block;
+   int i = cursor->record + 1;
+
+   while(block != NULL)
+   {
+      while(i < block->used && block->records[i].deleted)
+      {
+         i++;
+      }
+
+      if(i < block->used)
+      {
+         break;
+      }
+
+      block = block->next;
+      i = 0;
+   }
+
+   cursor->block = block;
+   cursor->record = i;
+
+   return block == NULL ? NULL : &block->records[i];
+}
+
+
+
+void seek_transaction(const struct transaction_store *store,
+   const struct transaction *record, struct store_cursor *cursor)
+{
+   struct store_block *block;
+
+   for(block = store->first; block != NULL; block = block->next)
+   {
+      if(record >= block->records && record < block->records + block->used)
+      {
+         break;
+      }
+   }
+
+   cursor->block = block;
+   cursor->record = block == NULL ? 0 : (int) (record - block->records);
+}
+
+
+
+struct transaction *previous_transaction(const struct transaction_store *store,
+   struct store_cursor *cursor)
+{
+   struct store_block *block = cursor->block;
+   struct store_block *before;
+   int i = cursor->record - 1;
+
+   /* Past the last record, the one before is the last one */
+   if(block == NULL)
+   {
+      block = store->last;
+      i = block == NULL ? -1 : block->used - 1;
+   }
+
+   while(block != NULL)
+   {
+      while(i >= 0 && block->records[i].deleted)
+      {
+         i--;
+      }
+
+      if(i >= 0)
+      {
+         cursor->block = block;
+         cursor->record = i;
+         return &block->records[i];
+      }
+
+      if(block == store->first)
+      {
+         break;
+      }
+
+      before = store->first;
+      while(before->next != block)
+      {
+         before = before->next;
+      }
+
+      block = before;
+      i = block->used - 1;
+   }
+
+   cursor->block = store->first;
+   cursor->record = -1;
+
+   return NULL;
+}
+
+
+
+/*
+ *
+ * Moves every record that isn't deleted down over the deleted ones,
+ * filling each block in turn, and gives the blocks that are left
+ * empty back to the pool
+ *
+ * The records are only ever moved toward the front, so a record is
+ * always read before its slot is written over.
+ *
+ */
+void compact_store(struct transaction_store *store)
+{
+   struct store_block *to = store->first;
+   struct store_block *from;
+   struct store_block *next;
+   int i;
+   int j = 0;
+
+   for(from = store->first; from != NULL; from = from->next)
+   {
+      for(i = 0; i < from->used; i++)
+      {
+         if(from->records[i].deleted)
+         {
+            continue;
+         }
+
+         if(j == STORE_BLOCK_RECORDS)
+         {
+            to->used = STORE_BLOCK_RECORDS;
+            to = to->next;
+            j = 0;
+         }
+
+         if(&to->records[j] != &from->records[i])
+         {
+            to->records[j] = from->records[i];
+            reindex_transaction(&to->records[j]);
+         }
+
+         j++;
+      }
+   }
+
+   if(to == NULL)
+   {
+      free_store(store);
+      return;
+   }
+
+   to->used = j;
+
+   next = to->next;
+   to->next = NULL;
+   store->last = to;
+
+   while(next != NULL)
+   {
+      from = next->next;
+      pool_free_block(next);
+      next = from;
+   }
+
+   store->number_of_deleted = 0;
+}
+
+
+
+/*
+ *
+ * Moves the descriptions still in use into a new block, and points
+ * every record at its new copy. If there isn't enough memory for the
+ * new block, the old copies are just kept.
+ *
+ */
+void repack_descriptions(struct transaction_store *store)
+{
+   struct store_block *block;
+   int i;
+
+   if(!start_description_repack())
+   {
+      return;
+   }
+
+   for(block = store->first; block != NULL; block = block->next)
+   {
+      for(i = 0; i < block->used; i++)
+      {
+         if(block->records[i].deleted)
+         {
+            continue;
+         }
+
+         block->records[i].description =
+            repacked_description(block->records[i].description);
+      }
+   }
+
+   finish_description_repack();
+}
+
+
+
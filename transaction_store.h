@@ -0,0 +1,147 @@
+/*
+ *
+ * Name:       transaction_store.h
+ *
+ * Purpose:    Contains the transaction record, and function prototypes
+ *             for keeping the budget in blocks of records.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_STORE_H
+#define TRANSACTION_STORE_H
+#include "conversions.h"
+#include "boolean.h"
+
+/* The shard of a transaction that hasn't been saved to one yet */
+#define NO_SHARD 0
+
+/* The ID of a transaction that was saved before IDs were */
+#define NO_TRANSACTION_ID 0
+
+/*
+ * The fields are kept as numbers, and only turned back into text to be
+ * shown or saved. The description is the description pool's copy, so
+ * transactions with the same description share it, and two of them
+ * have the same description when the pointers are equal.
+ */
+struct transaction
+{
+   CENTS amount;
+   const char *description;
+
+   /* Days since 1/1/1970, which always fits in 32 bits */
+   int day;
+
+   /* In sharded mode, the month of the file this transaction is saved in */
+   int shard;
+
+   /* Saved with the transaction, so it never changes */
+   int id;
+
+   /* 0 or 1 */
+   unsigned char type;
+
+   /* TRUE once the transaction is deleted, until the store is compacted */
+   unsigned char deleted;
+};
+
+/*
+ * The budget is a list of blocks, each holding up to STORE_BLOCK_RECORDS
+ * transactions side by side, so going through the budget reads memory
+ * in order instead of following a pointer per transaction.
+ */
+#define STORE_BLOCK_RECORDS 128
+
+/*
+ * The store is compacted once at least this many of every hundred
+ * records are deleted ones
+ */
+#define STORE_COMPACT_PERCENT 25
+
+struct store_block
+{
+   struct store_block *next;
+
+   /* records[0] to records[used - 1] are in use, and may be deleted */
+   int used;
+
+   struct transaction records[STORE_BLOCK_RECORDS];
+};
+
+struct transaction_store
+{
+   struct store_block *first;
+   struct store_block *last;
+   long number_of_transactions;
+   long number_of_deleted;
+};
+
+/* Where a walk through the store is */
+struct store_cursor
+{
+   struct store_block *block;
+   int record;
+};
+
+void init_store(struct transaction_store *store);
+
+/*
+ * Returns a new, empty record at the end of the store, or NULL if we
+ * run out of memory. Records never move, except when deleted ones are
+ * compacted away.
+ */
+struct transaction *add_to_store(struct transaction_store *store);
+
+/*
+ * Marks a record as deleted. Once enough of them are, the records
+ * after them are moved down over them, and the ID index is told where
+ * each one went, so no pointer to a record is good after this.
+ */
+void delete_from_store(struct transaction_store *store,
+   struct transaction *record);
+
+/* Moves every record of other onto the end of store, and empties other */
+void append_store(struct transaction_store *store,
+   struct transaction_store *other);
+
+void free_store(struct transaction_store *store);
+
+/*
+ * Walk the records that aren't deleted, in order:
+ *
+ *    for(p = first_transaction(store, &cursor); p != NULL;
+ *       p = next_transaction(&cursor))
+ */
+struct transaction *first_transaction(const struct transaction_store *store,
+   struct store_cursor *cursor);
+struct transaction *next_transaction(struct store_cursor *cursor);
+
+/*
+ * Move a cursor to any record, so a walk can start there, or back by
+ * one record. Blocks only link forward, so going back to the block
+ * before, or seeking, reads the list of blocks from the start, which
+ * is O(n / STORE_BLOCK_RECORDS). previous_transaction() returns NULL
+ * at the first record, and leaves the cursor where next_transaction()
+ * returns the first record again.
+ */
+void seek_transaction(const struct transaction_store *store,
+   const struct transaction *record, struct store_cursor *cursor);
+struct transaction *previous_transaction(const struct transaction_store *store,
+   struct store_cursor *cursor);
+
+#endif
+
+
+
@@ -0,0 +1,440 @@
+/*
+ *
+ * Name:       transaction_view.c
+ *
+ * Purpose:    Contains functions for showing transactions a page at a
+ *             time, and for writing many rows at once.
+ *
+ *             Each row is put together by hand in one large buffer
+ *             instead of with a printf() per row, and the buffer is
+ *             written with one fwrite() per page, or whenever it
+ *             fills. A page is remembered as a cursor into the store,
+ *             so going to the next page, the previous one, an ID, or
+ *             a date never reads the pages in between.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+/*
+ *
+ * Preprocessing directives
+ *
+ */
+#include <limits.h>
+#include <string.h>
+#include "transaction_view.h"
+#include "transaction_index.h"
+#include "date_index.h"
+#include "validation.h"
+#include "conversions.h"
+
+/* The longest row: every field at its widest, and the tabs */
+#define MAX_ROW_LENGTH (DESCRIPTION_LENGTH + 48)
+
+/*
+ *
+ * I'm declaring these here instead of in a
+ * header file because they are only used here (for now)
+ *
+ */
+char *write_padded(char *p, const char *text, size_t width,
+   BOOL right_aligned);
+char *format_id(int id, char *end);
+void go_to_transaction(const struct transaction_store *budget,
+   const struct transaction *record, struct store_cursor *page);
+BOOL go_to_id(const struct transaction_store *budget,
+   struct store_cursor *page);
+BOOL go_to_date(const struct transaction_store *budget,
+   struct store_cursor *page);
+
+static char view_buffer[VIEW_BUFFER_SIZE];
+static size_t view_length = 0;
+
+
+
+void buffer_row_heading(void)
+{
+   if(view_length > VIEW_BUFFER_SIZE - 2 * MAX_ROW_LENGTH)
+   {
+      flush_rows();
+   }
+
+   view_length += (size_t) sprintf(view_buffer + view_length,
+      "%-10s\t%-11s\t%-10s\t%-5s\t%-50s\n", "Id", "Date", "Amount", "Type",
+      "Description");
+   view_length += (size_t) sprintf(view_buffer + view_length,
+      "%10s\t%-11s\t%-10s\t%-5s\t%-50s\n", "----------", "-----------",
+      "----------", "-----",
+      "--------------------------------------------------");
+}
+
+
+
+/* The same as printf("%10d\t%-11s\t%10s\t%5s\t%-50s\n") of its fields */
+void buffer_transaction_row(const struct transaction *node)
+{
+   char date_string[DATE_LENGTH + 1];
+   char amount_string[AMOUNT_LENGTH + 1];
+   char id_string[12];
+   char type_string[2];
+   char *p;
+
+   if(view_length > VIEW_BUFFER_SIZE - MAX_ROW_LENGTH)
+   {
+      flush_rows();
+   }
+
+   day_number_to_date(node->day, date_string);
+   cents_to_amount(node->amount, amount_string);
+   type_string[0] = (char) ('0' + node->type);
+   type_string[1] = '\0';
+
+   p = view_buffer + view_length;
+   p = write_padded(p, format_id(node->id, id_string + sizeof(id_string) - 1),
+      10, TRUE);
+   *p++ = '\t';
+   p = write_padded(p, date_string, 11, FALSE);
+   *p++ = '\t';
+   p = write_padded(p, amount_string, 10, TRUE);
+   *p++ = '\t';
+   p = write_padded(p, type_string, 5, TRUE);
+   *p++ = '\t';
+   p = write_padded(p, node->description, 50, FALSE);
+   *p++ = '\n';
+
+   view_length = (size_t) (p - view_buffer);
+}
+
+
+
+void flush_rows(void)
+{
+   if(view_length > 0)
+   {
+      fwrite(view_buffer, 1, view_length, stdout);
+      view_length = 0;
+   }
+}
+
+
+
+int print_page(const struct store_cursor *page, struct store_cursor *end)
+{
+   struct transaction *p;
+   int number_shown = 0;
+
+   *end = *page;
+
+   buffer_row_heading();
+
+   while(number_shown < PAGE_ROWS && (p = next_transaction(end)) != NULL)
+   {
+      buffer_transaction_row(p);
+      number_shown++;
+   }
+
+   flush_rows();
+
+   return number_shown;
+}
+
+
+
+void print_first_page(const struct transaction_store *budget)
+{
+   struct store_cursor page;
+   struct store_cursor end;
+
+   page.block = budget->first;
+   page.record = -1;
+
+   (void) print_page(&page, &end);
+}
+
+
+
+void view_transactions(const struct transaction_store *budget)
+{
+   char menu_string[MENU_INPUT_LENGTH + 1];
+   struct store_cursor page;
+   struct store_cursor end;
+   struct store_cursor after;
+   int number_shown;
+   int i;
+
+   page.block = budget->first;
+   page.record = -1;
+
+   for( ;; )
+   {
+      printf("\n");
+      number_shown = print_page(&page, &end);
+
+      if(number_shown < PAGE_ROWS)
+      {
+         printf("\nThis is the last page.\n");
+      }
+
+      printf("\nEnter \"n\" for the next page, \"p\" for the previous page, \"i\" to go to an ID,\n");
+      printf("\"d\" to go to a date, or \"b\" to go back: ");
+      /* Treat the end of the input like "b", or we'd ask forever */
+      if(read_menu_input(menu_string) == FILE_OPS_ERROR
+         || *menu_string == 'b' || *menu_string == 'B')
+      {
+         return;
+      }
+      else if(*menu_string == 'n' || *menu_string == 'N')
+      {
+         after = end;
+         if(number_shown == PAGE_ROWS && next_transaction(&after) != NULL)
+         {
+            page = end;
+         }
+      }
+      else if(*menu_string == 'p' || *menu_string == 'P')
+      {
+         for(i = 0; i < PAGE_ROWS; i++)
+         {
+            if(previous_transaction(budget, &page) == NULL)
+            {
+               break;
+            }
+         }
+      }
+      else if(*menu_string == 'i' || *menu_string == 'I')
+      {
+         (void) go_to_id(budget, &page);
+      }
+      else if(*menu_string == 'd' || *menu_string == 'D')
+      {
+         (void) go_to_date(budget, &page);
+      }
+      else
+      {
+         printf("\nYou entered an invalid option. Please try again.\n");
+      }
+   }
+}
+
+
+
+BOOL ask_for_next_page(void)
+{
+   char menu_string[MENU_INPUT_LENGTH + 1];
+
+   for( ;; )
+   {
+      printf("\nEnter \"n\" for the next page, or \"b\" to go back: ");
+      if(read_menu_input(menu_string) == FILE_OPS_ERROR
+         || *menu_string == 'b' || *menu_string == 'B')
+      {
+         return FALSE;
+      }
+
+      if(*menu_string == 'n' || *menu_string == 'N')
+      {
+         printf("\n");
+         return TRUE;
+      }
+
+      printf("\nYou entered an invalid option. Please try again.\n");
+   }
+}
+
+
+
+void start_pages(struct row_pager *pager)
+{
+   pager->number_shown = 0;
+   pager->stopped = FALSE;
+
+   buffer_row_heading();
+}
+
+
+
+BOOL page_row(struct row_pager *pager, const struct transaction *node)
+{
+   if(pager->stopped)
+   {
+      return FALSE;
+   }
+
+   /* Each page is written at once, before asking for the next */
+   if(pager->number_shown == PAGE_ROWS)
+   {
+      flush_rows();
+      if(!ask_for_next_page())
+      {
+         pager->stopped = TRUE;
+         return FALSE;
+      }
+
+      buffer_row_heading();
+      pager->number_shown = 0;
+   }
+
+   buffer_transaction_row(node);
+   pager->number_shown++;
+
+   return TRUE;
+}
+
+
+
+/* Copies text, with spaces before or after it to make it width long */
+char *write_padded(char *p, const char *text, size_t width,
+   BOOL right_aligned)
+{
+   size_t length = strlen(text);
+
+   if(right_aligned)
+   {
+      while(width > length)
+      {
+         *p++ = ' ';
+         width--;
+      }
+   }
+
+   memcpy(p, text, length);
+   p += length;
+
+   while(width > length)
+   {
+      *p++ = ' ';
+      width--;
+   }
+
+   return p;
+}
+
+
+
+/*
+ *
+ * Writes the digits of id backwards from end, which gets the '\0',
+ * and returns where they start
+ *
+ */
+char *format_id(int id, char *end)
+{
+   unsigned long digits = id < 0 ? 0UL - (unsigned long) id
+      : (unsigned long) id;
+
+   *end = '\0';
+
+   do
+   {
+      *--end = (char) ('0' + digits % 10);
+      digits /= 10;
+   } while(digits > 0);
+
+   if(id < 0)
+   {
+      *--end = '-';
+   }
+
+   return end;
+}
+
+
+
+/* Makes record the first transaction of the page */
+void go_to_transaction(const struct transaction_store *budget,
+   const struct transaction *record, struct store_cursor *page)
+{
+   seek_transaction(budget, record, page);
+   (void) previous_transaction(budget, page);
+}
+
+
+
+BOOL go_to_id(const struct transaction_store *budget,
+   struct store_cursor *page)
+{
+   char id_string[ID_INPUT_LENGTH + 1];
+   struct transaction *record;
+
+   printf("\nType the ID to go to. Enter \"b\" to go back: ");
+   (void) read_id_input(id_string);
+
+   if(*id_string == 'b' || *id_string == 'B')
+   {
+      return FALSE;
+   }
+
+   record = find_transaction(atoi(id_string));
+   if(record == NULL)
+   {
+      printf("\nThe id you entered is invalid.\n");
+      return FALSE;
+   }
+
+   go_to_transaction(budget, record, page);
+
+   return TRUE;
+}
+
+
+
+/*
+ *
+ * Goes to the earliest transaction on or after a date, which the date
+ * index finds without reading the budget
+ *
+ */
+BOOL go_to_date(const struct transaction_store *budget,
+   struct store_cursor *page)
+{
+   char date_string[DATE_LENGTH + 1];
+   struct date_cursor cursor;
+   struct transaction *record;
+   long day;
+
+   printf("\nEnter the date to go to (mm/dd/yyyy). Enter \"b\" to go back: ");
+   read_date_input(date_string);
+
+   if(*date_string == 'b' || *date_string == 'B')
+   {
+      return FALSE;
+   }
+
+   day = is_valid_date(date_string) ? date_to_day_number(date_string)
+      : INVALID_DAY_NUMBER;
+   if(day == INVALID_DAY_NUMBER)
+   {
+      printf("\nThe date you entered was invalid.\n");
+      return FALSE;
+   }
+
+   if(build_date_index(budget) == FILE_OPS_ERROR)
+   {
+      return FALSE;
+   }
+
+   record = first_in_date_range((int) day, INT_MAX, &cursor);
+   if(record == NULL)
+   {
+      printf("\nNo transactions were found on or after %s.\n", date_string);
+      return FALSE;
+   }
+
+   go_to_transaction(budget, record, page);
+
+   return TRUE;
+}
+
+
+
@@ -0,0 +1,87 @@
+/*
+ *
+ * Name:       transaction_view.h
+ *
+ * Purpose:    Contains function prototypes for showing transactions a
+ *             page at a time, and for writing many rows at once.
+ *
+ *
+ * Author:     jjones4
+ *
+ * Copyright (c) 2022 Jerad Jones
+ * This file is part of c_budget_linked_lists.  c_budget_linked_lists
+ * may be freely distributed under the MIT license.  For all details and
+ * documentation, see
+ *
+ * https://github.com/jjones4/c_budget_linked_lists
+ *
+ */
+
+
+
+#ifndef TRANSACTION_VIEW_H
+#define TRANSACTION_VIEW_H
+#include "transaction_store.h"
+#include "read_input.h"
+#include "boolean.h"
+
+/* How many transactions are shown on each page */
+#define PAGE_ROWS 20
+
+/* Rows are written out once this much of them is waiting */
+#define VIEW_BUFFER_SIZE 65536
+
+/*
+ * The heading, and one row per transaction, are added to a buffer
+ * instead of being printed, and flush_rows() writes the buffer with a
+ * single call. A full buffer is written on its own. Anything printed
+ * in between must wait until the rows are flushed.
+ */
+void buffer_row_heading(void);
+void buffer_transaction_row(const struct transaction *node);
+void flush_rows(void);
+
+/*
+ * Shows the PAGE_ROWS transactions that come after page in the order
+ * they are stored, and leaves end on the last one shown, or past the
+ * end of the store if there weren't that many. Returns how many were
+ * shown.
+ */
+int print_page(const struct store_cursor *page, struct store_cursor *end);
+
+/* Shows the first page of the budget, without asking for more */
+void print_first_page(const struct transaction_store *budget);
+
+/*
+ * Shows the budget a page at a time, in the order it is stored, and
+ * asks for the next or previous page, an ID or a date to go to, or
+ * "b" to go back
+ */
+void view_transactions(const struct transaction_store *budget);
+
+/* Asks whether to show another page. Returns FALSE for "b". */
+BOOL ask_for_next_page(void);
+
+/*
+ * Shows rows that can only be read forward, like a sort or a search,
+ * a page at a time. page_row() adds a row, and once a page is full,
+ * writes it and asks for the next page before adding the row. It
+ * returns FALSE, and adds nothing more, once the user enters "b".
+ *
+ *    start_pages(&pager);
+ *    for(...; p != NULL && page_row(&pager, p); ...)
+ *    flush_rows();
+ */
+struct row_pager
+{
+   int number_shown;
+   BOOL stopped;
+};
+
+void start_pages(struct row_pager *pager);
+BOOL page_row(struct row_pager *pager, const struct transaction *node);
+
+#endif
+
+
+